@@ -0,0 +1,144 @@
+#ifndef ACCUMULATOR_H
+#define ACCUMULATOR_H
+#include <array>
+#include <cstdint>
+#include <cstdlib> // For std::aligned_alloc
+#include <cstring>
+#include <iostream>
+
+// The part of the network that changes as moves are made: the first layer output (accumulator) from each side's
+// perspective. The network weights themselves are read only and stay global in position_eval.cpp.
+//
+// Every BitPosition keeps a stack of these, one per ply (AccumulatorStack). Making a move only records which features it added
+// and removed, whatever the network, and the accumulator is computed from the nearest computed ancestor when the
+// position is evaluated (see NNUE::updateAccumulator and NNUEU::updateAccumulator). Unmaking a move then costs
+// nothing, and so do nodes that are never evaluated.
+struct Accumulator
+{
+    // Both nets: the first layer output from white's and black's perspective, as wide as the loaded network's
+    // accumulator. They point into the inputs of the AccumulatorStack holding this accumulator.
+    int16_t *inputWhiteTurn{nullptr};
+    int16_t *inputBlackTurn{nullptr};
+
+    // HalfKP NNUE only, it has a second first layer for the side not to move. The NNUEU looks its second layer
+    // weight blocks up by the kings' squares when evaluating instead.
+    int16_t inputWhiteNotTurn[8] = {0};
+    int16_t inputBlackNotTurn[8] = {0};
+
+    // Kings' squares the inputs were computed with. HalfKP features depend on them, so a king move means a refresh.
+    uint8_t whiteKingSquare{0};
+    uint8_t blackKingSquare{0};
+
+    // Whether the inputs are up to date, otherwise they are the parent's inputs plus the changes below
+    bool computed{false};
+
+    // Feature changes of the move that led to this position. A capturing promotion is the worst case:
+    // the pawn moves (1 added, 1 removed), becomes the promoted piece (1 added, 1 removed) and a piece is captured.
+    uint8_t numAdded{0};
+    uint8_t numRemoved{0};
+    uint16_t added[2] = {0};
+    uint16_t removed[3] = {0};
+
+    // Called when making a move, before recording its changes
+    void clearChanges()
+    {
+        computed = false;
+        numAdded = 0;
+        numRemoved = 0;
+    }
+    void addFeature(int subIndex) { added[numAdded++] = static_cast<uint16_t>(subIndex); }
+    void removeFeature(int subIndex) { removed[numRemoved++] = static_cast<uint16_t>(subIndex); }
+};
+
+// The accumulators of each ply of a position. Their inputs are allocated for the accumulator size of the network
+// that initialized them (see initializeNNUEInput), so that copying a position stays cheap with narrow networks.
+class AccumulatorStack
+{
+public:
+    static constexpr int MAX_PLY = 64;
+
+    AccumulatorStack() = default;
+    AccumulatorStack(const AccumulatorStack &other) { *this = other; }
+    AccumulatorStack &operator=(const AccumulatorStack &other)
+    {
+        if (this == &other)
+            return *this;
+        m_accumulators = other.m_accumulators;
+        allocate(other.m_size);
+        if (m_size > 0)
+            std::memcpy(m_inputs, other.m_inputs, inputBytes());
+        return *this;
+    }
+    ~AccumulatorStack() { std::free(m_inputs); }
+
+    Accumulator &operator[](int ply) { return m_accumulators[ply]; }
+    const Accumulator &operator[](int ply) const { return m_accumulators[ply]; }
+
+    int size() const { return m_size; }
+
+    // Sizes the inputs for a network of this accumulator size. Inputs of another size were computed by another
+    // network, so every accumulator is left to compute again.
+    void resize(int size)
+    {
+        if (size == m_size)
+            return;
+        allocate(size);
+        for (Accumulator &accumulator : m_accumulators)
+            accumulator.computed = false;
+    }
+
+    // Copies the accumulator of a ply, inputs included, into another ply
+    void copy(int fromPly, int toPly)
+    {
+        if (fromPly == toPly)
+            return;
+        Accumulator &to{m_accumulators[toPly]};
+        int16_t *inputWhiteTurn{to.inputWhiteTurn};
+        int16_t *inputBlackTurn{to.inputBlackTurn};
+        to = m_accumulators[fromPly];
+        to.inputWhiteTurn = inputWhiteTurn;
+        to.inputBlackTurn = inputBlackTurn;
+        if (m_size > 0)
+        {
+            std::memcpy(to.inputWhiteTurn, m_accumulators[fromPly].inputWhiteTurn, sizeof(int16_t) * m_size);
+            std::memcpy(to.inputBlackTurn, m_accumulators[fromPly].inputBlackTurn, sizeof(int16_t) * m_size);
+        }
+    }
+
+private:
+    // Inputs of one perspective, rounded up to whole cache lines so that every input is 64 byte aligned
+    size_t inputStride() const { return (static_cast<size_t>(m_size) + 31) / 32 * 32; }
+    size_t inputBytes() const { return sizeof(int16_t) * inputStride() * 2 * MAX_PLY; }
+
+    // Allocates the inputs of every ply unless they already have this size, and points the accumulators at them
+    void allocate(int size)
+    {
+        if (size != m_size)
+        {
+            std::free(m_inputs);
+            m_inputs = nullptr;
+            m_size = size;
+            if (m_size > 0)
+            {
+                m_inputs = static_cast<int16_t *>(std::aligned_alloc(64, inputBytes()));
+                if (m_inputs == nullptr)
+                {
+                    std::cerr << "Failed to allocate the accumulators\n";
+                    std::exit(EXIT_FAILURE);
+                }
+                std::memset(m_inputs, 0, inputBytes());
+            }
+        }
+        for (int ply = 0; ply < MAX_PLY; ++ply)
+        {
+            m_accumulators[ply].inputWhiteTurn = m_size > 0 ? m_inputs + 2 * ply * inputStride() : nullptr;
+            m_accumulators[ply].inputBlackTurn = m_size > 0 ? m_inputs + (2 * ply + 1) * inputStride() : nullptr;
+        }
+    }
+
+    std::array<Accumulator, MAX_PLY> m_accumulators{};
+    int16_t *m_inputs{nullptr};
+    int m_size{0};
+};
+
+#endif
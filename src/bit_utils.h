@@ -12,6 +12,20 @@ inline int invertIndex(int index)
     return newRow * 8 + (index % 8);
 }
 
+// NNUE features are pieceType * 64 + square, white pieces (0 to 4) before black pieces (5 to 9). The same feature
+// seen from the other side has the piece colour swapped and the board flipped (square ^ 56 is invertIndex(square)),
+// so the black perspective reads the weight row of the mirrored feature instead of a permuted copy of the weights.
+inline int mirrorFeature(int feature)
+{
+    return (feature + 320 - 640 * (feature >= 320)) ^ 56;
+}
+
+// HalfKP features also carry the king square: kingSquare * 640 + feature
+inline int mirrorHalfKPFeature(int kingSquare, int feature)
+{
+    return (kingSquare ^ 56) * 640 + mirrorFeature(feature);
+}
+
 inline unsigned short getLeastSignificantBitIndex(uint64_t bitboard)
 {
     if (bitboard == 0)
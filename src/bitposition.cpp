@@ -1,5 +1,6 @@
 #include <iostream>
 #include <vector>
+#include <algorithm> // For std::sort and std::max_element
 #include <cstdint> // For fixed sized integers
 #include "precomputed_moves.h" // Include the precomputed move constants
 #include "bitposition.h" // Where the BitPosition class is defined
@@ -8,7 +9,9 @@
 #include "magicmoves.h"
 #include "zobrist_keys.h"
 #include "position_eval.h" // Utility functions to update NNUE Input
+#include "ttable.h" // To prefetch the transposition table cluster of the new position
 
+extern TranspositionTable globalTT;
 
 template void BitPosition::makeMove<Move>(Move move);
 template void BitPosition::makeMove<ScoredMove>(ScoredMove move);
@@ -177,7 +180,7 @@ void BitPosition::setIsCheckOnInitialization()
 }
 
 // Functions we call before first move generation
-void BitPosition::setCheckInfoOnInitialization()
+void BitPosition::setCheckInfoOnInitialization() const
 {
     m_num_checks = 0;
     m_check_rays = 0;
@@ -502,6 +505,7 @@ void BitPosition::makeTTMove(Move move)
 
     m_blockers_set = false;
     BitPosition::storePlyInfoInTTMove(); // store current state for unmake move
+    m_accumulators[m_ply + 1].clearChanges(); // NNUE input changes are applied when evaluating
 
     m_last_origin_square = move.getOriginSquare();
     uint64_t origin_bit = (1ULL << m_last_origin_square);
@@ -566,9 +570,6 @@ void BitPosition::makeTTMove(Move move)
             m_white_king_bit = m_last_destination_bit;
             m_white_king_position = m_last_destination_square;
             m_moved_piece = 5;
-
-            // Update NNUE input (after moving the king)
-            NNUEU::moveWhiteKingNNUEInput(*this);
             m_is_check = isDiscoverCheckForBlack(m_last_origin_square, m_last_destination_square);
         }
         // Moving any piece except king
@@ -576,8 +577,8 @@ void BitPosition::makeTTMove(Move move)
         {
             BitPosition::setPiece(origin_bit, m_last_destination_bit);
             // Set NNUE input
-            NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * m_moved_piece + m_last_origin_square);
-            NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * m_moved_piece + m_last_destination_square);
+            m_accumulators[m_ply + 1].removeFeature(64 * m_moved_piece + m_last_origin_square);
+            m_accumulators[m_ply + 1].addFeature(64 * m_moved_piece + m_last_destination_square);
         }
         // Captures (Non passant)
         if ((m_last_destination_bit & m_black_pawns_bit) != 0)
@@ -585,35 +586,35 @@ void BitPosition::makeTTMove(Move move)
             m_black_pawns_bit &= ~m_last_destination_bit;
             m_captured_piece = 0;
             // Set NNUE input
-            NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 5 + m_last_destination_square);
+            m_accumulators[m_ply + 1].removeFeature(64 * 5 + m_last_destination_square);
         }
         else if ((m_last_destination_bit & m_black_knights_bit) != 0)
         {
             m_black_knights_bit &= ~m_last_destination_bit;
             m_captured_piece = 1;
             // Set NNUE input
-            NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 6 + m_last_destination_square);
+            m_accumulators[m_ply + 1].removeFeature(64 * 6 + m_last_destination_square);
         }
         else if ((m_last_destination_bit & m_black_bishops_bit) != 0)
         {
             m_black_bishops_bit &= ~m_last_destination_bit;
             m_captured_piece = 2;
             // Set NNUE input
-            NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 7 + m_last_destination_square);
+            m_accumulators[m_ply + 1].removeFeature(64 * 7 + m_last_destination_square);
         }
         else if ((m_last_destination_bit & m_black_rooks_bit) != 0)
         {
             m_black_rooks_bit &= ~m_last_destination_bit;
             m_captured_piece = 3;
             // Set NNUE input
-            NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 8 + m_last_destination_square);
+            m_accumulators[m_ply + 1].removeFeature(64 * 8 + m_last_destination_square);
         }
         else if ((m_last_destination_bit & m_black_queens_bit) != 0)
         {
             m_black_queens_bit &= ~m_last_destination_bit;
             m_captured_piece = 4;
             // Set NNUE input
-            NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 9 + m_last_destination_square);
+            m_accumulators[m_ply + 1].removeFeature(64 * 9 + m_last_destination_square);
         }
 
         // Promotions, castling and passant
@@ -629,8 +630,8 @@ void BitPosition::makeTTMove(Move move)
                 m_is_check = isRookCheckOrDiscoverForBlack(7, 5);
 
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 3 + 7);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 3 + 5);
+                m_accumulators[m_ply + 1].removeFeature(64 * 3 + 7);
+                m_accumulators[m_ply + 1].addFeature(64 * 3 + 5);
             }
             else if (move.getData() == 16516) // White queenside castling
             {
@@ -642,15 +643,15 @@ void BitPosition::makeTTMove(Move move)
                 m_is_check = isRookCheckOrDiscoverForBlack(0, 3);
 
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 3);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 3 + 3);
+                m_accumulators[m_ply + 1].removeFeature(64 * 3);
+                m_accumulators[m_ply + 1].addFeature(64 * 3 + 3);
             }
             else if ((m_last_destination_bit & EIGHT_ROW_BITBOARD) != 0) // Promotions
             {
                 m_all_pieces_bit &= ~origin_bit;
                 m_white_pawns_bit &= ~m_last_destination_bit;
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, m_last_destination_square);
+                m_accumulators[m_ply + 1].removeFeature(m_last_destination_square);
 
                 m_promoted_piece = move.getPromotingPiece() + 1;
                 if (m_promoted_piece == 4) // Queen promotion
@@ -658,28 +659,28 @@ void BitPosition::makeTTMove(Move move)
                     m_white_queens_bit |= m_last_destination_bit;
                     m_is_check = isQueenCheckOrDiscoverForBlack(m_last_origin_square, m_last_destination_square);
                     // Set NNUE input
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 4 + m_last_destination_square);
+                    m_accumulators[m_ply + 1].addFeature(64 * 4 + m_last_destination_square);
                 }
                 else if (m_promoted_piece == 3) // Rook promotion
                 {
                     m_white_rooks_bit |= m_last_destination_bit;
                     m_is_check = isRookCheckOrDiscoverForBlack(m_last_origin_square, m_last_destination_square);
                     // Set NNUE input
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 3 + m_last_destination_square);
+                    m_accumulators[m_ply + 1].addFeature(64 * 3 + m_last_destination_square);
                 }
                 else if (m_promoted_piece == 2) // Bishop promotion
                 {
                     m_white_bishops_bit |= m_last_destination_bit;
                     m_is_check = isBishopCheckOrDiscoverForBlack(m_last_origin_square, m_last_destination_square);
                     // Set NNUE input
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 2 + m_last_destination_square);
+                    m_accumulators[m_ply + 1].addFeature(64 * 2 + m_last_destination_square);
                 }
                 else // Knight promotion
                 {
                     m_white_knights_bit |= m_last_destination_bit;
                     m_is_check = isKnightCheckOrDiscoverForBlack(m_last_origin_square, m_last_destination_square);
                     // Set NNUE input
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 + m_last_destination_square);
+                    m_accumulators[m_ply + 1].addFeature(64 + m_last_destination_square);
                 }
             }
             else // Passant
@@ -687,7 +688,7 @@ void BitPosition::makeTTMove(Move move)
                 m_black_pawns_bit &= ~shift_down(m_last_destination_bit);
                 m_captured_piece = 0;
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 5 + m_last_destination_square - 8);
+                m_accumulators[m_ply + 1].removeFeature(64 * 5 + m_last_destination_square - 8);
             }
         }
         m_zobrist_key ^= zobrist_keys::passantSquaresZobristNumbers[m_psquare];
@@ -752,17 +753,14 @@ void BitPosition::makeTTMove(Move move)
             m_moved_piece = 5;
 
             m_is_check = isDiscoverCheckForWhite(m_last_origin_square, m_last_destination_square);
-
-            // Update NNUE input (after moving the king)
-            NNUEU::moveBlackKingNNUEInput(*this);
         }
         // Moving any piece except the king
         else
         {
             BitPosition::setPiece(origin_bit, m_last_destination_bit);
             // Set NNUE input
-            NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * (5 + m_moved_piece) + m_last_origin_square);
-            NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * (5 + m_moved_piece) + m_last_destination_square);
+            m_accumulators[m_ply + 1].removeFeature(64 * (5 + m_moved_piece) + m_last_origin_square);
+            m_accumulators[m_ply + 1].addFeature(64 * (5 + m_moved_piece) + m_last_destination_square);
         }
 
         // Captures (Non passant)
@@ -771,35 +769,35 @@ void BitPosition::makeTTMove(Move move)
             m_white_pawns_bit &= ~m_last_destination_bit;
             m_captured_piece = 0;
             // Set NNUE input
-            NNUEU::removeOnInput(m_white_king_position, m_black_king_position, m_last_destination_square);
+            m_accumulators[m_ply + 1].removeFeature(m_last_destination_square);
         }
         else if ((m_last_destination_bit & m_white_knights_bit) != 0)
         {
             m_white_knights_bit &= ~m_last_destination_bit;
             m_captured_piece = 1;
             // Set NNUE input
-            NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 + m_last_destination_square);
+            m_accumulators[m_ply + 1].removeFeature(64 + m_last_destination_square);
         }
         else if ((m_last_destination_bit & m_white_bishops_bit) != 0)
         {
             m_white_bishops_bit &= ~m_last_destination_bit;
             m_captured_piece = 2;
             // Set NNUE input
-            NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 2 + m_last_destination_square);
+            m_accumulators[m_ply + 1].removeFeature(64 * 2 + m_last_destination_square);
         }
         else if ((m_last_destination_bit & m_white_rooks_bit) != 0)
         {
             m_white_rooks_bit &= ~m_last_destination_bit;
             m_captured_piece = 3;
             // Set NNUE input
-            NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 3 + m_last_destination_square);
+            m_accumulators[m_ply + 1].removeFeature(64 * 3 + m_last_destination_square);
         }
         else if ((m_last_destination_bit & m_white_queens_bit) != 0)
         {
             m_white_queens_bit &= ~m_last_destination_bit;
             m_captured_piece = 4;
             // Set NNUE input
-            NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 4 + m_last_destination_square);
+            m_accumulators[m_ply + 1].removeFeature(64 * 4 + m_last_destination_square);
         }
 
         // Promotions, passant and Castling
@@ -814,8 +812,8 @@ void BitPosition::makeTTMove(Move move)
 
                 m_moved_piece = 3; // Moved rook so we need to recompute the rook attacked squares
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 8 + 63);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 8 + 61);
+                m_accumulators[m_ply + 1].removeFeature(64 * 8 + 63);
+                m_accumulators[m_ply + 1].addFeature(64 * 8 + 61);
             }
             else if (move.getData() == 20156) // Black queenside castling
             {
@@ -826,15 +824,15 @@ void BitPosition::makeTTMove(Move move)
 
                 m_moved_piece = 3; // Moved rook so we need to recompute the rook attacked squares
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 8 + 56);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 8 + 59);
+                m_accumulators[m_ply + 1].removeFeature(64 * 8 + 56);
+                m_accumulators[m_ply + 1].addFeature(64 * 8 + 59);
             }
             else if ((m_last_destination_bit & FIRST_ROW_BITBOARD) != 0) // Promotions
             {
                 m_all_pieces_bit &= ~origin_bit;
                 m_black_pawns_bit &= ~m_last_destination_bit;
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 5 + m_last_destination_square);
+                m_accumulators[m_ply + 1].removeFeature(64 * 5 + m_last_destination_square);
 
                 m_promoted_piece = move.getPromotingPiece() + 1;
                 if (m_promoted_piece == 4) // Queen promotion
@@ -842,28 +840,28 @@ void BitPosition::makeTTMove(Move move)
                     m_black_queens_bit |= m_last_destination_bit;
                     m_is_check = isQueenCheckOrDiscoverForWhite(m_last_origin_square, m_last_destination_square);
                     // Set NNUE input
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 9 + m_last_destination_square);
+                    m_accumulators[m_ply + 1].addFeature(64 * 9 + m_last_destination_square);
                 }
                 else if (m_promoted_piece == 3) // Rook promotion
                 {
                     m_black_rooks_bit |= m_last_destination_bit;
                     m_is_check = isRookCheckOrDiscoverForWhite(m_last_origin_square, m_last_destination_square);
                     // Set NNUE input
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 8 + m_last_destination_square);
+                    m_accumulators[m_ply + 1].addFeature(64 * 8 + m_last_destination_square);
                 }
                 else if (m_promoted_piece == 2) // Bishop promotion
                 {
                     m_black_bishops_bit |= m_last_destination_bit;
                     m_is_check = isBishopCheckOrDiscoverForWhite(m_last_origin_square, m_last_destination_square);
                     // Set NNUE input
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 7 + m_last_destination_square);
+                    m_accumulators[m_ply + 1].addFeature(64 * 7 + m_last_destination_square);
                 }
                 else // Knight promotion
                 {
                     m_black_knights_bit |= m_last_destination_bit;
                     m_is_check = isKnightCheckOrDiscoverForWhite(m_last_origin_square, m_last_destination_square);
                     // Set NNUE input
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 6 + m_last_destination_square);
+                    m_accumulators[m_ply + 1].addFeature(64 * 6 + m_last_destination_square);
                 }
             }
             else // Passant
@@ -872,7 +870,7 @@ void BitPosition::makeTTMove(Move move)
                 m_white_pawns_bit &= ~shift_up(m_last_destination_bit);
                 m_captured_piece = 0;
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, m_last_destination_square + 8);
+                m_accumulators[m_ply + 1].removeFeature(m_last_destination_square + 8);
             }
         }
         m_zobrist_key ^= zobrist_keys::passantSquaresZobristNumbers[m_psquare];
@@ -891,6 +889,8 @@ void BitPosition::makeTTMove(Move move)
     m_turn = not m_turn;
     BitPosition::updateZobristKeyPiecePartAfterMove(m_last_origin_square, m_last_destination_square);
     m_zobrist_key ^= zobrist_keys::blackToMoveZobristNumber;
+    // The new key is known, so we start loading its ttable cluster while we finish making the move
+    globalTT.prefetch(m_zobrist_key);
     // Note, we store the zobrist key in it's array when making the move. However the rest of the ply info
     // is stored when making the next move to be able to go back.
     // So we store it in the m_ply+1 position because the initial position (or position after capture) is the m_ply 0.
@@ -910,9 +910,9 @@ void BitPosition::makeTTMove(Move move)
     //     std::exit(EXIT_FAILURE);
     // }
     // Debugging purposes
-    // int16_t eval_1{NNUEU::evaluationFunction(true)};
+    // int16_t eval_1{NNUEU::evaluationFunction(*this, true)};
     // NNUEU::initializeNNUEInput(*this);
-    // int16_t eval_2{NNUEU::evaluationFunction(true)};
+    // int16_t eval_2{NNUEU::evaluationFunction(*this, true)};
     // bool special{(move.getData() & 0b0100000000000000) == 0b0100000000000000};
     // if (eval_1 != eval_2)
     // {
@@ -980,10 +980,6 @@ void BitPosition::unmakeTTMove(Move move)
                 m_black_rooks_bit |= (1ULL << 63);
                 m_black_rooks_bit &= ~(1ULL << 61);
                 m_black_king_position = 60;
-
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 8 + 63);
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 8 + 61);
-                NNUEU::moveBlackKingNNUEInput(*this);
             }
 
             // Unmake queenside castling
@@ -993,10 +989,6 @@ void BitPosition::unmakeTTMove(Move move)
                 m_black_rooks_bit |= (1ULL << 56);
                 m_black_rooks_bit &= ~(1ULL << 59);
                 m_black_king_position = 60;
-
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 8 + 56);
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 8 + 59);
-                NNUEU::moveBlackKingNNUEInput(*this);
             }
 
             // Unmaking black promotions
@@ -1005,27 +997,22 @@ void BitPosition::unmakeTTMove(Move move)
                 uint16_t promoting_piece{static_cast<uint16_t>(move.getData() & 12288)};
 
                 m_black_pawns_bit |= origin_bit;
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 5 + origin_square);
 
                 if (promoting_piece == 12288) // Unpromote queen
                 {
                     m_black_queens_bit &= ~destination_bit;
-                    NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 9 + destination_square);
                 }
                 else if (promoting_piece == 8192) // Unpromote rook
                 {
                     m_black_rooks_bit &= ~destination_bit;
-                    NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 8 + destination_square);
                 }
                 else if (promoting_piece == 4096) // Unpromote bishop
                 {
                     m_black_bishops_bit &= ~destination_bit;
-                    NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 7 + destination_square);
                 }
                 else // Unpromote knight
                 {
                     m_black_knights_bit &= ~destination_bit;
-                    NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 6 + destination_square);
                 }
                 // Unmaking captures in promotions
                 if (previous_captured_piece != 7)
@@ -1033,22 +1020,18 @@ void BitPosition::unmakeTTMove(Move move)
                     if (previous_captured_piece == 1) // Uncapture knight
                     {
                         m_white_knights_bit |= destination_bit;
-                        NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 + destination_square);
                     }
                     else if (previous_captured_piece == 2) // Uncapture bishop
                     {
                         m_white_bishops_bit |= destination_bit;
-                        NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 2 + destination_square);
                     }
                     else if (previous_captured_piece == 3) // Uncapture rook
                     {
                         m_white_rooks_bit |= destination_bit;
-                        NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 3 + destination_square);
                     }
                     else // Uncapture queen
                     {
                         m_white_queens_bit |= destination_bit;
-                        NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 4 + destination_square);
                     }
                 }
             }
@@ -1056,10 +1039,7 @@ void BitPosition::unmakeTTMove(Move move)
             {
                 m_black_pawns_bit |= origin_bit;
                 m_black_pawns_bit &= ~destination_bit;
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 5 + origin_square);
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 5 + destination_square);
                 m_white_pawns_bit |= shift_up(destination_bit);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, destination_square + 8);
             }
         }
 
@@ -1070,42 +1050,31 @@ void BitPosition::unmakeTTMove(Move move)
             {
                 m_black_pawns_bit |= origin_bit;
                 m_black_pawns_bit &= ~destination_bit;
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 5 + destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 5 + origin_square);
             }
             else if ((destination_bit & m_black_knights_bit) != 0) // Unmove knight
             {
                 m_black_knights_bit |= origin_bit;
                 m_black_knights_bit &= ~destination_bit;
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 6 + destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 6 + origin_square);
             }
             else if ((destination_bit & m_black_bishops_bit) != 0) // Unmove bishop
             {
                 m_black_bishops_bit |= origin_bit;
                 m_black_bishops_bit &= ~destination_bit;
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 7 + destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 7 + origin_square);
             }
             else if ((destination_bit & m_black_rooks_bit) != 0) // Unmove rook
             {
                 m_black_rooks_bit |= origin_bit;
                 m_black_rooks_bit &= ~destination_bit;
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 8 + destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 8 + origin_square);
             }
             else if ((destination_bit & m_black_queens_bit) != 0) // Unmove queen
             {
                 m_black_queens_bit |= origin_bit;
                 m_black_queens_bit &= ~destination_bit;
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 9 + destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 9 + origin_square);
             }
             else // Unmove king
             {
                 m_black_king_bit = origin_bit;
                 m_black_king_position = origin_square;
-                NNUEU::moveBlackKingNNUEInput(*this);
             }
             // Unmaking captures
             if (previous_captured_piece != 7)
@@ -1113,27 +1082,22 @@ void BitPosition::unmakeTTMove(Move move)
                 if (previous_captured_piece == 0) // Uncapture pawn
                 {
                     m_white_pawns_bit |= destination_bit;
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, destination_square);
                 }
                 else if (previous_captured_piece == 1) // Uncapture knight
                 {
                     m_white_knights_bit |= destination_bit;
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 + destination_square);
                 }
                 else if (previous_captured_piece == 2) // Uncapture bishop
                 {
                     m_white_bishops_bit |= destination_bit;
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 2 + destination_square);
                 }
                 else if (previous_captured_piece == 3) // Uncapture rook
                 {
                     m_white_rooks_bit |= destination_bit;
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 3 + destination_square);
                 }
                 else // Uncapture queen
                 {
                     m_white_queens_bit |= destination_bit;
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 4 + destination_square);
                 }
             }
         }
@@ -1150,10 +1114,6 @@ void BitPosition::unmakeTTMove(Move move)
                 m_white_rooks_bit |= (1ULL << 7);
                 m_white_rooks_bit &= ~(1ULL << 5);
                 m_white_king_position = 4;
-
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 3 + 7);
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 3 + 5);
-                NNUEU::moveWhiteKingNNUEInput(*this);
             }
 
             // Unmake queenside castling
@@ -1163,10 +1123,6 @@ void BitPosition::unmakeTTMove(Move move)
                 m_white_rooks_bit |= 1ULL;
                 m_white_rooks_bit &= ~(1ULL << 3);
                 m_white_king_position = 4;
-
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 3);
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 3 + 3);
-                NNUEU::moveWhiteKingNNUEInput(*this);
             }
 
             // Unmaking promotions
@@ -1175,27 +1131,22 @@ void BitPosition::unmakeTTMove(Move move)
                 uint16_t promoting_piece{static_cast<uint16_t>(move.getData() & 12288)};
 
                 m_white_pawns_bit |= origin_bit;
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, origin_square);
 
                 if (promoting_piece == 12288) // Unpromote queen
                 {
                     m_white_queens_bit &= ~destination_bit;
-                    NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 4 + destination_square);
                 }
                 else if (promoting_piece == 8192) // Unpromote rook
                 {
                     m_white_rooks_bit &= ~destination_bit;
-                    NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 3 + destination_square);
                 }
                 else if (promoting_piece == 4096) // Unpromote bishop
                 {
                     m_white_bishops_bit &= ~destination_bit;
-                    NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 2 + destination_square);
                 }
                 else // Unpromote knight
                 {
                     m_white_knights_bit &= ~destination_bit;
-                    NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 + destination_square);
                 }
                 // Unmaking captures in promotions
                 if (previous_captured_piece != 7)
@@ -1203,22 +1154,18 @@ void BitPosition::unmakeTTMove(Move move)
                     if (previous_captured_piece == 1) // Uncapture knight
                     {
                         m_black_knights_bit |= destination_bit;
-                        NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 6 + destination_square);
                     }
                     else if (previous_captured_piece == 2) // Uncapture bishop
                     {
                         m_black_bishops_bit |= destination_bit;
-                        NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 7 + destination_square);
                     }
                     else if (previous_captured_piece == 3) // Uncapture rook
                     {
                         m_black_rooks_bit |= destination_bit;
-                        NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 8 + destination_square);
                     }
                     else // Uncapture queen
                     {
                         m_black_queens_bit |= destination_bit;
-                        NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 9 + destination_square);
                     }
                 }
             }
@@ -1227,11 +1174,8 @@ void BitPosition::unmakeTTMove(Move move)
                 m_white_pawns_bit |= origin_bit;
                 m_white_pawns_bit &= ~destination_bit;
 
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, origin_square);
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, destination_square);
 
                 m_black_pawns_bit |= shift_down(destination_bit);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 5 + destination_square - 8);
             }
         }
 
@@ -1242,47 +1186,31 @@ void BitPosition::unmakeTTMove(Move move)
             {
                 m_white_pawns_bit |= origin_bit;
                 m_white_pawns_bit &= ~destination_bit;
-
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, origin_square);
             }
             else if ((destination_bit & m_white_knights_bit) != 0) // Unmove knight
             {
                 m_white_knights_bit |= origin_bit;
                 m_white_knights_bit &= ~destination_bit;
-
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 + destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 + origin_square);
             }
             else if ((destination_bit & m_white_bishops_bit) != 0) // Unmove bishop
             {
                 m_white_bishops_bit |= origin_bit;
                 m_white_bishops_bit &= ~destination_bit;
-
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 2 + destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 2 + origin_square);
             }
             else if ((destination_bit & m_white_rooks_bit) != 0) // Unmove rook
             {
                 m_white_rooks_bit |= origin_bit;
                 m_white_rooks_bit &= ~destination_bit;
-
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 3 + destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 3 + origin_square);
             }
             else if ((destination_bit & m_white_queens_bit) != 0) // Unmove queen
             {
                 m_white_queens_bit |= origin_bit;
                 m_white_queens_bit &= ~destination_bit;
-
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 4 + destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 4 + origin_square);
             }
             else // Unmove king
             {
                 m_white_king_bit = origin_bit;
                 m_white_king_position = origin_square;
-                NNUEU::moveWhiteKingNNUEInput(*this);
             }
 
             // Unmaking captures
@@ -1291,27 +1219,22 @@ void BitPosition::unmakeTTMove(Move move)
                 if (previous_captured_piece == 0) // Uncapture pawn
                 {
                     m_black_pawns_bit |= destination_bit;
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 5 + destination_square);
                 }
                 else if (previous_captured_piece == 1) // Uncapture knight
                 {
                     m_black_knights_bit |= destination_bit;
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 6 + destination_square);
                 }
                 else if (previous_captured_piece == 2) // Uncapture bishop
                 {
                     m_black_bishops_bit |= destination_bit;
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 7 + destination_square);
                 }
                 else if (previous_captured_piece == 3) // Uncapture rook
                 {
                     m_black_rooks_bit |= destination_bit;
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 8 + destination_square);
                 }
                 else // Uncapture queen
                 {
                     m_black_queens_bit |= destination_bit;
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 9 + destination_square);
                 }
             }
         }
@@ -1320,9 +1243,9 @@ void BitPosition::unmakeTTMove(Move move)
     m_turn = not m_turn;
 
     // Debugging purposes
-    // int16_t eval_1{NNUEU::evaluationFunction(true)};
+    // int16_t eval_1{NNUEU::evaluationFunction(*this, true)};
     // NNUEU::initializeNNUEInput(*this);
-    // int16_t eval_2{NNUEU::evaluationFunction(true)};
+    // int16_t eval_2{NNUEU::evaluationFunction(*this, true)};
     // bool special{(move.getData() & 0b0100000000000000) == 0b0100000000000000};
     // if (eval_1 != eval_2)
     // {
@@ -1337,6 +1260,71 @@ void BitPosition::unmakeTTMove(Move move)
     //     std::exit(EXIT_FAILURE);
     // }
 }
+void BitPosition::makeNullMove()
+// Passes the turn, for null move pruning. No piece moves, so the NNUE input records no changes and the accumulators
+// only switch perspective (the side to move). Only made when not in check, so the opponent can't be in check either.
+{
+    m_blockers_set = false;
+    BitPosition::storePlyInfo(); // store current state for unmake move
+    // The last move info stays as it was, but is also lost when making the moves after the null move
+    m_last_origin_square_array[m_ply] = m_last_origin_square;
+    m_last_destination_square_array[m_ply] = m_last_destination_square;
+    m_moved_piece_array[m_ply] = m_moved_piece;
+    m_promoted_piece_array[m_ply] = m_promoted_piece;
+    // Nothing is captured by a null move, so its slot keeps the last captured piece instead
+    m_captured_piece_array[m_ply] = m_captured_piece;
+    m_null_move_ply_array[m_ply] = m_null_move_ply;
+    m_accumulators[m_ply + 1].clearChanges(); // NNUE input changes are applied when evaluating
+    m_50_move_count++;
+
+    // There is no last move to refute (see isAfterNullMove), so no capture is left out as a refutation
+    m_last_destination_bit = 0;
+    m_captured_piece = 7;
+    m_promoted_piece = 7;
+    m_is_check = false;
+
+    m_zobrist_key ^= zobrist_keys::passantSquaresZobristNumbers[m_psquare];
+    m_psquare = 0;
+    m_zobrist_key ^= zobrist_keys::passantSquaresZobristNumbers[m_psquare];
+
+    m_turn = not m_turn;
+    m_zobrist_key ^= zobrist_keys::blackToMoveZobristNumber;
+    globalTT.prefetch(m_zobrist_key);
+
+    m_ply++;
+    m_null_move_ply = m_ply;
+
+    m_zobrist_keys_array[63 - m_ply] = m_zobrist_key;
+}
+void BitPosition::unmakeNullMove()
+{
+    m_blockers_set = false;
+
+    m_zobrist_keys_array[63 - m_ply] = 0;
+
+    m_ply--;
+
+    m_diagonal_pins = m_diagonal_pins_array[m_ply];
+    m_straight_pins = m_straight_pins_array[m_ply];
+    m_blockers = m_blockers_array[m_ply];
+    m_unsafe_squares = m_unsafe_squares_array[m_ply];
+    m_psquare = m_psquare_array[m_ply];
+
+    m_50_move_count = m_50_move_count_array[m_ply];
+
+    m_last_origin_square = m_last_origin_square_array[m_ply];
+    m_last_destination_square = m_last_destination_square_array[m_ply];
+    m_last_destination_bit = m_last_destination_bit_array[m_ply];
+    m_moved_piece = m_moved_piece_array[m_ply];
+    m_promoted_piece = m_promoted_piece_array[m_ply];
+    m_captured_piece = m_captured_piece_array[m_ply];
+    m_null_move_ply = m_null_move_ply_array[m_ply];
+    m_is_check = false;
+
+    m_zobrist_key = m_zobrist_keys_array[63 - m_ply];
+
+    m_turn = not m_turn;
+}
 
 // Functions we call before move generation
 void BitPosition::setDiscoverCheckForWhite()
@@ -1652,7 +1640,7 @@ void BitPosition::setCheckInfoAfterMove()
         }
     }
 }
-void BitPosition::setPins()
+void BitPosition::setPins() const
 // Set m_straight_pins, m_diagonal_pins. Called in all move generators: setMovesAndScores, setMovesInCheck, setCapturesAndScores, setCapturesInCheck.
 {
     m_diagonal_pins = 0;
@@ -1705,7 +1693,7 @@ void BitPosition::setPins()
         }
     }
 }
-void BitPosition::setAttackedSquares()
+void BitPosition::setAttackedSquares() const
 // These are set for move ordering. Called only in setMovesAndScores, to penalize unsafe moves.
 // They are also for moving king safely in normal moves.
 {
@@ -1777,7 +1765,7 @@ void BitPosition::setAttackedSquares()
         }
     }
 }
-void BitPosition::setBlockers()
+void BitPosition::setBlockers() const
 // This is the only one called before ttable moves, since we need ot determine if move gives check or not.
 // It is also called in nextMove, nextCapture, nextMoveInCheck and nextCaptureInCheck, when a legal move is found.
 {
@@ -2124,8 +2112,58 @@ bool BitPosition::isQueenCheckOrDiscoverForBlack(unsigned short origin_square, u
     return false;
 }
 
+bool BitPosition::isQuietMove(Move move) const
+// Whether the move is neither a capture, a promotion nor a check, decided before making it
+// Castling and passant are never considered quiet
+{
+    if ((move.getData() & 0x4000) != 0)
+        return false;
+
+    unsigned short origin_square{move.getOriginSquare()};
+    unsigned short destination_square{move.getDestinationSquare()};
+    uint64_t origin_bit{1ULL << origin_square};
+    uint64_t destination_bit{1ULL << destination_square};
+
+    // Discovered checks need the blockers
+    if (not m_blockers_set)
+        BitPosition::setBlockers();
+
+    if (m_turn) // White's move
+    {
+        if ((destination_bit & m_black_pieces_bit) != 0)
+            return false;
+        if ((origin_bit & m_white_pawns_bit) != 0)
+            return not isPawnCheckOrDiscoverForBlack(origin_square, destination_square);
+        if ((origin_bit & m_white_knights_bit) != 0)
+            return not isKnightCheckOrDiscoverForBlack(origin_square, destination_square);
+        if ((origin_bit & m_white_bishops_bit) != 0)
+            return not isBishopCheckOrDiscoverForBlack(origin_square, destination_square);
+        if ((origin_bit & m_white_rooks_bit) != 0)
+            return not isRookCheckOrDiscoverForBlack(origin_square, destination_square);
+        if ((origin_bit & m_white_queens_bit) != 0)
+            return not isQueenCheckOrDiscoverForBlack(origin_square, destination_square);
+        return not isDiscoverCheckForBlack(origin_square, destination_square);
+    }
+    else // Black's move
+    {
+        if ((destination_bit & m_white_pieces_bit) != 0)
+            return false;
+        if ((origin_bit & m_black_pawns_bit) != 0)
+            return not isPawnCheckOrDiscoverForWhite(origin_square, destination_square);
+        if ((origin_bit & m_black_knights_bit) != 0)
+            return not isKnightCheckOrDiscoverForWhite(origin_square, destination_square);
+        if ((origin_bit & m_black_bishops_bit) != 0)
+            return not isBishopCheckOrDiscoverForWhite(origin_square, destination_square);
+        if ((origin_bit & m_black_rooks_bit) != 0)
+            return not isRookCheckOrDiscoverForWhite(origin_square, destination_square);
+        if ((origin_bit & m_black_queens_bit) != 0)
+            return not isQueenCheckOrDiscoverForWhite(origin_square, destination_square);
+        return not isDiscoverCheckForWhite(origin_square, destination_square);
+    }
+}
+
 // First move generations
-std::vector<Move> BitPosition::inCheckAllMoves()
+std::vector<Move> BitPosition::inCheckAllMoves() const
 // For first move search, we have to initialize check info
 {
     setCheckInfoOnInitialization();
@@ -2344,7 +2382,7 @@ std::vector<Move> BitPosition::inCheckAllMoves()
     }
     return moves;
 }
-std::vector<Move> BitPosition::allMoves()
+std::vector<Move> BitPosition::allMoves() const
 // For first move search
 {
     setPins();
@@ -2754,6 +2792,9 @@ std::pair<std::vector<Move>, std::vector<int16_t>> BitPosition::orderAllMovesOnF
 Move BitPosition::getBestRefutation()
 {
     setPins();
+    // There is no last move to refute after a null move
+    if (isAfterNullMove())
+        return Move(0);
     if (m_turn)
     {
         // Right shift captures
@@ -4352,6 +4393,9 @@ Move *BitPosition::setRefutationMovesOrdered(Move *&move_list_start)
 {
     setPins();
     Move *move_list_end = move_list_start; // Initially, end points to start
+    // There is no last move to refute after a null move, the good captures include every capture then
+    if (isAfterNullMove())
+        return move_list_end;
     if (m_turn)
     {
         // Capturing with king
@@ -5045,7 +5089,12 @@ void BitPosition::resetPlyInfo()
 // To make the ply info smaller. For a faster 3 fold repetition check.
 // It isn't used when making a move in search!
 {
+    // The current accumulator becomes the bottom of the stack
+    Evaluation::updateAccumulator(*this);
+    m_accumulators.copy(m_ply, 0);
+
     m_ply = 0;
+    m_null_move_ply = -1;
     m_wkcastling_array.fill(false);
     m_wqcastling_array.fill(false);
     m_bkcastling_array.fill(false);
@@ -5111,6 +5160,7 @@ void BitPosition::makeMove(T move)
     // std::string fen_before{(*this).toFenString()}; // Debugging purpose
     m_blockers_set = false;
     BitPosition::storePlyInfo(); // store current state for unmake move
+    m_accumulators[m_ply + 1].clearChanges(); // NNUE input changes are applied when evaluating
     m_50_move_count++;
 
     m_last_origin_square = move.getOriginSquare();
@@ -5176,9 +5226,6 @@ void BitPosition::makeMove(T move)
             m_white_king_bit = m_last_destination_bit;
             m_white_king_position = m_last_destination_square;
             m_moved_piece = 5;
-
-            // Update NNUE input (after moving the king)
-            NNUEU::moveWhiteKingNNUEInput(*this);
             m_is_check = isDiscoverCheckForBlack(m_last_origin_square, m_last_destination_square);
         }
         // Moving any piece except king
@@ -5186,8 +5233,8 @@ void BitPosition::makeMove(T move)
         {
             BitPosition::setPiece(origin_bit, m_last_destination_bit);
             // Set NNUE input
-            NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * m_moved_piece + m_last_origin_square);
-            NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * m_moved_piece + m_last_destination_square);
+            m_accumulators[m_ply + 1].removeFeature(64 * m_moved_piece + m_last_origin_square);
+            m_accumulators[m_ply + 1].addFeature(64 * m_moved_piece + m_last_destination_square);
         }
         // Captures (Non passant)
         if ((m_last_destination_bit & m_black_pawns_bit) != 0)
@@ -5196,7 +5243,7 @@ void BitPosition::makeMove(T move)
             m_black_pawns_bit &= ~m_last_destination_bit;
             m_captured_piece = 0;
             // Set NNUE input
-            NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 5 + m_last_destination_square);
+            m_accumulators[m_ply + 1].removeFeature(64 * 5 + m_last_destination_square);
         }
         else if ((m_last_destination_bit & m_black_knights_bit) != 0)
         {
@@ -5204,7 +5251,7 @@ void BitPosition::makeMove(T move)
             m_black_knights_bit &= ~m_last_destination_bit;
             m_captured_piece = 1;
             // Set NNUE input
-            NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 6 + m_last_destination_square);
+            m_accumulators[m_ply + 1].removeFeature(64 * 6 + m_last_destination_square);
         }
         else if ((m_last_destination_bit & m_black_bishops_bit) != 0)
         {
@@ -5212,7 +5259,7 @@ void BitPosition::makeMove(T move)
             m_black_bishops_bit &= ~m_last_destination_bit;
             m_captured_piece = 2;
             // Set NNUE input
-            NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 7 + m_last_destination_square);
+            m_accumulators[m_ply + 1].removeFeature(64 * 7 + m_last_destination_square);
         }
         else if ((m_last_destination_bit & m_black_rooks_bit) != 0)
         {
@@ -5220,7 +5267,7 @@ void BitPosition::makeMove(T move)
             m_black_rooks_bit &= ~m_last_destination_bit;
             m_captured_piece = 3;
             // Set NNUE input
-            NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 8 + m_last_destination_square);
+            m_accumulators[m_ply + 1].removeFeature(64 * 8 + m_last_destination_square);
         }
         else if ((m_last_destination_bit & m_black_queens_bit) != 0)
         {
@@ -5228,7 +5275,7 @@ void BitPosition::makeMove(T move)
             m_black_queens_bit &= ~m_last_destination_bit;
             m_captured_piece = 4;
             // Set NNUE input
-            NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 9 + m_last_destination_square);
+            m_accumulators[m_ply + 1].removeFeature(64 * 9 + m_last_destination_square);
         }
 
         // Promotions, castling and passant
@@ -5244,8 +5291,8 @@ void BitPosition::makeMove(T move)
                 m_is_check = isRookCheckOrDiscoverForBlack(7, 5);
 
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 3 + 7);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 3 + 5);
+                m_accumulators[m_ply + 1].removeFeature(64 * 3 + 7);
+                m_accumulators[m_ply + 1].addFeature(64 * 3 + 5);
             }
             else if (move.getData() == 16516) // White queenside castling
             {
@@ -5257,15 +5304,15 @@ void BitPosition::makeMove(T move)
                 m_is_check = isRookCheckOrDiscoverForBlack(0, 3);
 
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 3);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 3 + 3);
+                m_accumulators[m_ply + 1].removeFeature(64 * 3);
+                m_accumulators[m_ply + 1].addFeature(64 * 3 + 3);
             }
             else if ((m_last_destination_bit & EIGHT_ROW_BITBOARD) != 0) // Promotions
             {
                 m_all_pieces_bit &= ~origin_bit;
                 m_white_pawns_bit &= ~m_last_destination_bit;
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, m_last_destination_square);
+                m_accumulators[m_ply + 1].removeFeature(m_last_destination_square);
 
                 m_promoted_piece = move.getPromotingPiece() + 1;
                 if (m_promoted_piece == 4) // Queen promotion
@@ -5273,28 +5320,28 @@ void BitPosition::makeMove(T move)
                     m_white_queens_bit |= m_last_destination_bit;
                     m_is_check = isQueenCheckOrDiscoverForBlack(m_last_origin_square, m_last_destination_square);
                     // Set NNUE input
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 4 + m_last_destination_square);
+                    m_accumulators[m_ply + 1].addFeature(64 * 4 + m_last_destination_square);
                 }
                 else if (m_promoted_piece == 3) // Rook promotion
                 {
                     m_white_rooks_bit |= m_last_destination_bit;
                     m_is_check = isRookCheckOrDiscoverForBlack(m_last_origin_square, m_last_destination_square);
                     // Set NNUE input
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 3 + m_last_destination_square);
+                    m_accumulators[m_ply + 1].addFeature(64 * 3 + m_last_destination_square);
                 }
                 else if (m_promoted_piece == 2) // Bishop promotion
                 {
                     m_white_bishops_bit |= m_last_destination_bit;
                     m_is_check = isBishopCheckOrDiscoverForBlack(m_last_origin_square, m_last_destination_square);
                     // Set NNUE input
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 2 + m_last_destination_square);
+                    m_accumulators[m_ply + 1].addFeature(64 * 2 + m_last_destination_square);
                 }
                 else // Knight promotion
                 {
                     m_white_knights_bit |= m_last_destination_bit;
                     m_is_check = isKnightCheckOrDiscoverForBlack(m_last_origin_square, m_last_destination_square);
                     // Set NNUE input
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 + m_last_destination_square);
+                    m_accumulators[m_ply + 1].addFeature(64 + m_last_destination_square);
                 }
             }
             else // Passant
@@ -5305,7 +5352,7 @@ void BitPosition::makeMove(T move)
                 if (not m_is_check)
                     m_is_check = isDiscoverCheckForBlackAfterPassant(m_last_origin_square, m_last_destination_square);
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 5 + m_last_destination_square - 8);
+                m_accumulators[m_ply + 1].removeFeature(64 * 5 + m_last_destination_square - 8);
             }
         }
         m_zobrist_key ^= zobrist_keys::passantSquaresZobristNumbers[m_psquare];
@@ -5370,17 +5417,14 @@ void BitPosition::makeMove(T move)
             m_moved_piece = 5;
 
             m_is_check = isDiscoverCheckForWhite(m_last_origin_square, m_last_destination_square);
-
-            // Update NNUE input (after moving the king)
-            NNUEU::moveBlackKingNNUEInput(*this);
         }
         // Moving any piece except the king
         else
         {
             BitPosition::setPiece(origin_bit, m_last_destination_bit);
             // Set NNUE input
-            NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * (5 + m_moved_piece) + m_last_origin_square);
-            NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * (5 + m_moved_piece) + m_last_destination_square);
+            m_accumulators[m_ply + 1].removeFeature(64 * (5 + m_moved_piece) + m_last_origin_square);
+            m_accumulators[m_ply + 1].addFeature(64 * (5 + m_moved_piece) + m_last_destination_square);
         }
 
         // Captures (Non passant)
@@ -5390,7 +5434,7 @@ void BitPosition::makeMove(T move)
             m_white_pawns_bit &= ~m_last_destination_bit;
             m_captured_piece = 0;
             // Set NNUE input
-            NNUEU::removeOnInput(m_white_king_position, m_black_king_position, m_last_destination_square);
+            m_accumulators[m_ply + 1].removeFeature(m_last_destination_square);
         }
         else if ((m_last_destination_bit & m_white_knights_bit) != 0)
         {
@@ -5398,7 +5442,7 @@ void BitPosition::makeMove(T move)
             m_white_knights_bit &= ~m_last_destination_bit;
             m_captured_piece = 1;
             // Set NNUE input
-            NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 + m_last_destination_square);
+            m_accumulators[m_ply + 1].removeFeature(64 + m_last_destination_square);
         }
         else if ((m_last_destination_bit & m_white_bishops_bit) != 0)
         {
@@ -5406,7 +5450,7 @@ void BitPosition::makeMove(T move)
             m_white_bishops_bit &= ~m_last_destination_bit;
             m_captured_piece = 2;
             // Set NNUE input
-            NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 2 + m_last_destination_square);
+            m_accumulators[m_ply + 1].removeFeature(64 * 2 + m_last_destination_square);
         }
         else if ((m_last_destination_bit & m_white_rooks_bit) != 0)
         {
@@ -5414,7 +5458,7 @@ void BitPosition::makeMove(T move)
             m_white_rooks_bit &= ~m_last_destination_bit;
             m_captured_piece = 3;
             // Set NNUE input
-            NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 3 + m_last_destination_square);
+            m_accumulators[m_ply + 1].removeFeature(64 * 3 + m_last_destination_square);
         }
         else if ((m_last_destination_bit & m_white_queens_bit) != 0)
         {
@@ -5422,7 +5466,7 @@ void BitPosition::makeMove(T move)
             m_white_queens_bit &= ~m_last_destination_bit;
             m_captured_piece = 4;
             // Set NNUE input
-            NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 4 + m_last_destination_square);
+            m_accumulators[m_ply + 1].removeFeature(64 * 4 + m_last_destination_square);
         }
 
         // Promotions, passant and Castling
@@ -5437,8 +5481,8 @@ void BitPosition::makeMove(T move)
 
                 m_moved_piece = 3; // Moved rook so we need to recompute the rook attacked squares
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 8 + 63);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 8 + 61);
+                m_accumulators[m_ply + 1].removeFeature(64 * 8 + 63);
+                m_accumulators[m_ply + 1].addFeature(64 * 8 + 61);
             }
             else if (move.getData() == 20156) // Black queenside castling
             {
@@ -5449,15 +5493,15 @@ void BitPosition::makeMove(T move)
 
                 m_moved_piece = 3; // Moved rook so we need to recompute the rook attacked squares
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 8 + 56);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 8 + 59);
+                m_accumulators[m_ply + 1].removeFeature(64 * 8 + 56);
+                m_accumulators[m_ply + 1].addFeature(64 * 8 + 59);
             }
             else if ((m_last_destination_bit & FIRST_ROW_BITBOARD) != 0) // Promotions
             {
                 m_all_pieces_bit &= ~origin_bit;
                 m_black_pawns_bit &= ~m_last_destination_bit;
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 5 + m_last_destination_square);
+                m_accumulators[m_ply + 1].removeFeature(64 * 5 + m_last_destination_square);
 
                 m_promoted_piece = move.getPromotingPiece() + 1;
                 if (m_promoted_piece == 4) // Queen promotion
@@ -5465,28 +5509,28 @@ void BitPosition::makeMove(T move)
                     m_black_queens_bit |= m_last_destination_bit;
                     m_is_check = isQueenCheckOrDiscoverForWhite(m_last_origin_square, m_last_destination_square);
                     // Set NNUE input
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 9 + m_last_destination_square);
+                    m_accumulators[m_ply + 1].addFeature(64 * 9 + m_last_destination_square);
                 }
                 else if (m_promoted_piece == 3) // Rook promotion
                 {
                     m_black_rooks_bit |= m_last_destination_bit;
                     m_is_check = isRookCheckOrDiscoverForWhite(m_last_origin_square, m_last_destination_square);
                     // Set NNUE input
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 8 + m_last_destination_square);
+                    m_accumulators[m_ply + 1].addFeature(64 * 8 + m_last_destination_square);
                 }
                 else if (m_promoted_piece == 2) // Bishop promotion
                 {
                     m_black_bishops_bit |= m_last_destination_bit;
                     m_is_check = isBishopCheckOrDiscoverForWhite(m_last_origin_square, m_last_destination_square);
                     // Set NNUE input
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 7 + m_last_destination_square);
+                    m_accumulators[m_ply + 1].addFeature(64 * 7 + m_last_destination_square);
                 }
                 else // Knight promotion
                 {
                     m_black_knights_bit |= m_last_destination_bit;
                     m_is_check = isKnightCheckOrDiscoverForWhite(m_last_origin_square, m_last_destination_square);
                     // Set NNUE input
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 6 + m_last_destination_square);
+                    m_accumulators[m_ply + 1].addFeature(64 * 6 + m_last_destination_square);
                 }
             }
             else // Passant
@@ -5496,7 +5540,7 @@ void BitPosition::makeMove(T move)
                 m_white_pawns_bit &= ~shift_up(m_last_destination_bit);
                 m_captured_piece = 0;
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, m_last_destination_square + 8);
+                m_accumulators[m_ply + 1].removeFeature(m_last_destination_square + 8);
                 if (not m_is_check)
                     m_is_check = isDiscoverCheckForWhiteAfterPassant(m_last_origin_square, m_last_destination_square);
             }
@@ -5517,6 +5561,8 @@ void BitPosition::makeMove(T move)
     m_turn = not m_turn;
     BitPosition::updateZobristKeyPiecePartAfterMove(m_last_origin_square, m_last_destination_square);
     m_zobrist_key ^= zobrist_keys::blackToMoveZobristNumber;
+    // The new key is known, so we start loading its ttable cluster while we finish making the move
+    globalTT.prefetch(m_zobrist_key);
     // Note, we store the zobrist key in it's array when making the move. However the rest of the ply info
     // is stored when making the next move to be able to go back.
     // So we store it in the m_ply+1 position because the initial position (or position after capture) is the m_ply 0.
@@ -5537,9 +5583,9 @@ void BitPosition::makeMove(T move)
     // }
 
     // Debugging purposes
-    // int16_t eval_1{NNUEU::evaluationFunction(true)};
+    // int16_t eval_1{NNUEU::evaluationFunction(*this, true)};
     // NNUEU::initializeNNUEInput(*this);
-    // int16_t eval_2{NNUEU::evaluationFunction(true)};
+    // int16_t eval_2{NNUEU::evaluationFunction(*this, true)};
     // bool special{(move.getData() & 0b0100000000000000) == 0b0100000000000000};
     // if (eval_1 != eval_2)
     // {
@@ -5607,10 +5653,6 @@ void BitPosition::unmakeMove(T move)
                 m_black_rooks_bit |= (1ULL << 63);
                 m_black_rooks_bit &= ~(1ULL << 61);
                 m_black_king_position = 60;
-
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 8 + 63);
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 8 + 61);
-                NNUEU::moveBlackKingNNUEInput(*this);
             }
 
             // Unmake queenside castling
@@ -5620,10 +5662,6 @@ void BitPosition::unmakeMove(T move)
                 m_black_rooks_bit |= (1ULL << 56);
                 m_black_rooks_bit &= ~(1ULL << 59);
                 m_black_king_position = 60;
-
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 8 + 56);
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 8 + 59);
-                NNUEU::moveBlackKingNNUEInput(*this);
             }
 
             // Unmaking black promotions
@@ -5632,27 +5670,22 @@ void BitPosition::unmakeMove(T move)
                 uint16_t promoting_piece{static_cast<uint16_t>(move.getData() & 12288)};
 
                 m_black_pawns_bit |= origin_bit;
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 5 + origin_square);
 
                 if (promoting_piece == 12288) // Unpromote queen
                 {
                     m_black_queens_bit &= ~destination_bit;
-                    NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 9 + destination_square);
                 }
                 else if (promoting_piece == 8192) // Unpromote rook
                 {
                     m_black_rooks_bit &= ~destination_bit;
-                    NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 8 + destination_square);
                 }
                 else if (promoting_piece == 4096) // Unpromote bishop
                 {
                     m_black_bishops_bit &= ~destination_bit;
-                    NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 7 + destination_square);
                 }
                 else // Unpromote knight
                 {
                     m_black_knights_bit &= ~destination_bit;
-                    NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 6 + destination_square);
                 }
                 // Unmaking captures in promotions
                 if (previous_captured_piece != 7)
@@ -5660,22 +5693,18 @@ void BitPosition::unmakeMove(T move)
                     if (previous_captured_piece == 1) // Uncapture knight
                     {
                         m_white_knights_bit |= destination_bit;
-                        NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 + destination_square);
                     }
                     else if (previous_captured_piece == 2) // Uncapture bishop
                     {
                         m_white_bishops_bit |= destination_bit;
-                        NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 2 + destination_square);
                     }
                     else if (previous_captured_piece == 3) // Uncapture rook
                     {
                         m_white_rooks_bit |= destination_bit;
-                        NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 3 + destination_square);
                     }
                     else // Uncapture queen
                     {
                         m_white_queens_bit |= destination_bit;
-                        NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 4 + destination_square);
                     }
                 }
             }
@@ -5683,10 +5712,7 @@ void BitPosition::unmakeMove(T move)
             {
                 m_black_pawns_bit |= origin_bit;
                 m_black_pawns_bit &= ~destination_bit;
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 5 + origin_square);
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 5 + destination_square);
                 m_white_pawns_bit |= shift_up(destination_bit);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, destination_square + 8);
             }
         }
 
@@ -5697,42 +5723,31 @@ void BitPosition::unmakeMove(T move)
             {
                 m_black_pawns_bit |= origin_bit;
                 m_black_pawns_bit &= ~destination_bit;
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 5 + destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 5 + origin_square);
             }
             else if ((destination_bit & m_black_knights_bit) != 0) // Unmove knight
             {
                 m_black_knights_bit |= origin_bit;
                 m_black_knights_bit &= ~destination_bit;
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 6 + destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 6 + origin_square);
             }
             else if ((destination_bit & m_black_bishops_bit) != 0) // Unmove bishop
             {
                 m_black_bishops_bit |= origin_bit;
                 m_black_bishops_bit &= ~destination_bit;
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 7 + destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 7 + origin_square);
             }
             else if ((destination_bit & m_black_rooks_bit) != 0) // Unmove rook
             {
                 m_black_rooks_bit |= origin_bit;
                 m_black_rooks_bit &= ~destination_bit;
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 8 + destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 8 + origin_square);
             }
             else if ((destination_bit & m_black_queens_bit) != 0) // Unmove queen
             {
                 m_black_queens_bit |= origin_bit;
                 m_black_queens_bit &= ~destination_bit;
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 9 + destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 9 + origin_square);
             }
             else // Unmove king
             {
                 m_black_king_bit = origin_bit;
                 m_black_king_position = origin_square;
-                NNUEU::moveBlackKingNNUEInput(*this);
             }
             // Unmaking captures
             if (previous_captured_piece != 7)
@@ -5740,27 +5755,22 @@ void BitPosition::unmakeMove(T move)
                 if (previous_captured_piece == 0) // Uncapture pawn
                 {
                     m_white_pawns_bit |= destination_bit;
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, destination_square);
                 }
                 else if (previous_captured_piece == 1) // Uncapture knight
                 {
                     m_white_knights_bit |= destination_bit;
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 + destination_square);
                 }
                 else if (previous_captured_piece == 2) // Uncapture bishop
                 {
                     m_white_bishops_bit |= destination_bit;
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 2 + destination_square);
                 }
                 else if (previous_captured_piece == 3) // Uncapture rook
                 {
                     m_white_rooks_bit |= destination_bit;
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 3 + destination_square);
                 }
                 else // Uncapture queen
                 {
                     m_white_queens_bit |= destination_bit;
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 4 + destination_square);
                 }
             }
         }
@@ -5777,10 +5787,6 @@ void BitPosition::unmakeMove(T move)
                 m_white_rooks_bit |= (1ULL << 7);
                 m_white_rooks_bit &= ~(1ULL << 5);
                 m_white_king_position = 4;
-
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 3 + 7);
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 3 + 5);
-                NNUEU::moveWhiteKingNNUEInput(*this);
             }
 
             // Unmake queenside castling
@@ -5790,10 +5796,6 @@ void BitPosition::unmakeMove(T move)
                 m_white_rooks_bit |= 1ULL;
                 m_white_rooks_bit &= ~(1ULL << 3);
                 m_white_king_position = 4;
-
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 3);
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 3 + 3);
-                NNUEU::moveWhiteKingNNUEInput(*this);
             }
 
             // Unmaking promotions
@@ -5802,27 +5804,22 @@ void BitPosition::unmakeMove(T move)
                 uint16_t promoting_piece{static_cast<uint16_t>(move.getData() & 12288)};
 
                 m_white_pawns_bit |= origin_bit;
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, origin_square);
 
                 if (promoting_piece == 12288) // Unpromote queen
                 {
                     m_white_queens_bit &= ~destination_bit;
-                    NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 4 + destination_square);
                 }
                 else if (promoting_piece == 8192) // Unpromote rook
                 {
                     m_white_rooks_bit &= ~destination_bit;
-                    NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 3 + destination_square);
                 }
                 else if (promoting_piece == 4096) // Unpromote bishop
                 {
                     m_white_bishops_bit &= ~destination_bit;
-                    NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 2 + destination_square);
                 }
                 else // Unpromote knight
                 {
                     m_white_knights_bit &= ~destination_bit;
-                    NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 + destination_square);
                 }
                 // Unmaking captures in promotions
                 if (previous_captured_piece != 7)
@@ -5830,22 +5827,18 @@ void BitPosition::unmakeMove(T move)
                     if (previous_captured_piece == 1) // Uncapture knight
                     {
                         m_black_knights_bit |= destination_bit;
-                        NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 6 + destination_square);
                     }
                     else if (previous_captured_piece == 2) // Uncapture bishop
                     {
                         m_black_bishops_bit |= destination_bit;
-                        NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 7 + destination_square);
                     }
                     else if (previous_captured_piece == 3) // Uncapture rook
                     {
                         m_black_rooks_bit |= destination_bit;
-                        NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 8 + destination_square);
                     }
                     else // Uncapture queen
                     {
                         m_black_queens_bit |= destination_bit;
-                        NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 9 + destination_square);
                     }
                 }
             }
@@ -5854,11 +5847,8 @@ void BitPosition::unmakeMove(T move)
                 m_white_pawns_bit |= origin_bit;
                 m_white_pawns_bit &= ~destination_bit;
 
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, origin_square);
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, destination_square);
 
                 m_black_pawns_bit |= shift_down(destination_bit);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 5 + destination_square - 8);
             }
         }
 
@@ -5869,47 +5859,31 @@ void BitPosition::unmakeMove(T move)
             {
                 m_white_pawns_bit |= origin_bit;
                 m_white_pawns_bit &= ~destination_bit;
-
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, origin_square);
             }
             else if ((destination_bit & m_white_knights_bit) != 0) // Unmove knight
             {
                 m_white_knights_bit |= origin_bit;
                 m_white_knights_bit &= ~destination_bit;
-
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 + destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 + origin_square);
             }
             else if ((destination_bit & m_white_bishops_bit) != 0) // Unmove bishop
             {
                 m_white_bishops_bit |= origin_bit;
                 m_white_bishops_bit &= ~destination_bit;
-
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 2 + destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 2 + origin_square);
             }
             else if ((destination_bit & m_white_rooks_bit) != 0) // Unmove rook
             {
                 m_white_rooks_bit |= origin_bit;
                 m_white_rooks_bit &= ~destination_bit;
-
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 3 + destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 3 + origin_square);
             }
             else if ((destination_bit & m_white_queens_bit) != 0) // Unmove queen
             {
                 m_white_queens_bit |= origin_bit;
                 m_white_queens_bit &= ~destination_bit;
-
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 4 + destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 4 + origin_square);
             }
             else // Unmove king
             {
                 m_white_king_bit = origin_bit;
                 m_white_king_position = origin_square;
-                NNUEU::moveWhiteKingNNUEInput(*this);
             }
 
             // Unmaking captures
@@ -5918,27 +5892,22 @@ void BitPosition::unmakeMove(T move)
                 if (previous_captured_piece == 0) // Uncapture pawn
                 {
                     m_black_pawns_bit |= destination_bit;
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 5 + destination_square);
                 }
                 else if (previous_captured_piece == 1) // Uncapture knight
                 {
                     m_black_knights_bit |= destination_bit;
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 6 + destination_square);
                 }
                 else if (previous_captured_piece == 2) // Uncapture bishop
                 {
                     m_black_bishops_bit |= destination_bit;
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 7 + destination_square);
                 }
                 else if (previous_captured_piece == 3) // Uncapture rook
                 {
                     m_black_rooks_bit |= destination_bit;
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 8 + destination_square);
                 }
                 else // Uncapture queen
                 {
                     m_black_queens_bit |= destination_bit;
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 9 + destination_square);
                 }
             }
         }
@@ -5947,9 +5916,9 @@ void BitPosition::unmakeMove(T move)
     m_turn = not m_turn;
 
     // Debugging purposes
-    // int16_t eval_1{NNUEU::evaluationFunction(true)};
+    // int16_t eval_1{NNUEU::evaluationFunction(*this, true)};
     // NNUEU::initializeNNUEInput(*this);
-    // int16_t eval_2{NNUEU::evaluationFunction(true)};
+    // int16_t eval_2{NNUEU::evaluationFunction(*this, true)};
     // bool special{(move.getData() & 0b0100000000000000) == 0b0100000000000000};
     // if (eval_1 != eval_2)
     // {
@@ -5973,12 +5942,14 @@ void BitPosition::makeCapture(T move)
     // std::string fen_before{(*this).toFenString()}; // Debugging purposes
     m_blockers_set = false;
     BitPosition::storePlyInfoInCaptures(); // store current state for unmake move
+    m_accumulators[m_ply + 1].clearChanges(); // NNUE input changes are applied when evaluating
     m_last_origin_square = move.getOriginSquare();
     uint64_t origin_bit = (1ULL << m_last_origin_square);
     m_last_destination_square = move.getDestinationSquare();
     m_last_destination_bit = (1ULL << m_last_destination_square);
     m_captured_piece = 7; // Representing no capture
     m_promoted_piece = 7; // Representing no promotion (Used for updating check info)
+    m_zobrist_key ^= zobrist_keys::passantSquaresZobristNumbers[m_psquare] ^ zobrist_keys::passantSquaresZobristNumbers[0];
     m_psquare = 0;
     m_is_check = false;
 
@@ -5995,8 +5966,8 @@ void BitPosition::makeCapture(T move)
             m_white_queens_bit |= m_last_destination_bit;
             m_is_check = isQueenCheckOrDiscoverForBlack(m_last_origin_square, m_last_destination_square);
             // Set NNUE input
-            NNUEU::removeOnInput(m_white_king_position, m_black_king_position, m_last_origin_square);
-            NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 4 + m_last_destination_square);
+            m_accumulators[m_ply + 1].removeFeature(m_last_origin_square);
+            m_accumulators[m_ply + 1].addFeature(64 * 4 + m_last_destination_square);
 
             // Captures (Non passant)
             if ((m_last_destination_bit & m_black_pawns_bit) != 0)
@@ -6004,35 +5975,35 @@ void BitPosition::makeCapture(T move)
                 m_black_pawns_bit &= ~m_last_destination_bit;
                 m_captured_piece = 0;
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 5 + m_last_destination_square);
+                m_accumulators[m_ply + 1].removeFeature(64 * 5 + m_last_destination_square);
             }
             else if ((m_last_destination_bit & m_black_knights_bit) != 0)
             {
                 m_black_knights_bit &= ~m_last_destination_bit;
                 m_captured_piece = 1;
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 6 + m_last_destination_square);
+                m_accumulators[m_ply + 1].removeFeature(64 * 6 + m_last_destination_square);
             }
             else if ((m_last_destination_bit & m_black_bishops_bit) != 0)
             {
                 m_black_bishops_bit &= ~m_last_destination_bit;
                 m_captured_piece = 2;
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 7 + m_last_destination_square);
+                m_accumulators[m_ply + 1].removeFeature(64 * 7 + m_last_destination_square);
             }
             else if ((m_last_destination_bit & m_black_rooks_bit) != 0)
             {
                 m_black_rooks_bit &= ~m_last_destination_bit;
                 m_captured_piece = 3;
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 8 + m_last_destination_square);
+                m_accumulators[m_ply + 1].removeFeature(64 * 8 + m_last_destination_square);
             }
             else if ((m_last_destination_bit & m_black_queens_bit) != 0)
             {
                 m_black_queens_bit &= ~m_last_destination_bit;
                 m_captured_piece = 4;
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 9 + m_last_destination_square);
+                m_accumulators[m_ply + 1].removeFeature(64 * 9 + m_last_destination_square);
             }
         }
         else
@@ -6043,9 +6014,6 @@ void BitPosition::makeCapture(T move)
                 m_white_king_bit = m_last_destination_bit;
                 m_white_king_position = m_last_destination_square;
                 m_moved_piece = 5;
-
-                // Update NNUE input (after moving the king)
-                NNUEU::moveWhiteKingNNUEInput(*this);
                 m_is_check = isDiscoverCheckForBlack(m_last_origin_square, m_last_destination_square);
             }
             // Moving any piece except king
@@ -6053,8 +6021,8 @@ void BitPosition::makeCapture(T move)
             {
                 BitPosition::setPiece(origin_bit, m_last_destination_bit);
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * m_moved_piece + m_last_origin_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * m_moved_piece + m_last_destination_square);
+                m_accumulators[m_ply + 1].removeFeature(64 * m_moved_piece + m_last_origin_square);
+                m_accumulators[m_ply + 1].addFeature(64 * m_moved_piece + m_last_destination_square);
             }
             // Captures (Non passant)
             if ((m_last_destination_bit & m_black_pawns_bit) != 0)
@@ -6062,35 +6030,35 @@ void BitPosition::makeCapture(T move)
                 m_black_pawns_bit &= ~m_last_destination_bit;
                 m_captured_piece = 0;
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 5 + m_last_destination_square);
+                m_accumulators[m_ply + 1].removeFeature(64 * 5 + m_last_destination_square);
             }
             else if ((m_last_destination_bit & m_black_knights_bit) != 0)
             {
                 m_black_knights_bit &= ~m_last_destination_bit;
                 m_captured_piece = 1;
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 6 + m_last_destination_square);
+                m_accumulators[m_ply + 1].removeFeature(64 * 6 + m_last_destination_square);
             }
             else if ((m_last_destination_bit & m_black_bishops_bit) != 0)
             {
                 m_black_bishops_bit &= ~m_last_destination_bit;
                 m_captured_piece = 2;
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 7 + m_last_destination_square);
+                m_accumulators[m_ply + 1].removeFeature(64 * 7 + m_last_destination_square);
             }
             else if ((m_last_destination_bit & m_black_rooks_bit) != 0)
             {
                 m_black_rooks_bit &= ~m_last_destination_bit;
                 m_captured_piece = 3;
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 8 + m_last_destination_square);
+                m_accumulators[m_ply + 1].removeFeature(64 * 8 + m_last_destination_square);
             }
             else
             {
                 m_black_queens_bit &= ~m_last_destination_bit;
                 m_captured_piece = 4;
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 9 + m_last_destination_square);
+                m_accumulators[m_ply + 1].removeFeature(64 * 9 + m_last_destination_square);
             }
         }
     }
@@ -6107,8 +6075,8 @@ void BitPosition::makeCapture(T move)
             m_all_pieces_bit &= ~origin_bit;
             m_is_check = isQueenCheckOrDiscoverForWhite(m_last_origin_square, m_last_destination_square);
             // Set NNUE input
-            NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 5 + m_last_origin_square);
-            NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 9 + m_last_destination_square);
+            m_accumulators[m_ply + 1].removeFeature(64 * 5 + m_last_origin_square);
+            m_accumulators[m_ply + 1].addFeature(64 * 9 + m_last_destination_square);
 
             // Captures (Non passant)
             if ((m_last_destination_bit & m_white_pawns_bit) != 0)
@@ -6116,35 +6084,35 @@ void BitPosition::makeCapture(T move)
                 m_white_pawns_bit &= ~m_last_destination_bit;
                 m_captured_piece = 0;
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, m_last_destination_square);
+                m_accumulators[m_ply + 1].removeFeature(m_last_destination_square);
             }
             else if ((m_last_destination_bit & m_white_knights_bit) != 0)
             {
                 m_white_knights_bit &= ~m_last_destination_bit;
                 m_captured_piece = 1;
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 + m_last_destination_square);
+                m_accumulators[m_ply + 1].removeFeature(64 + m_last_destination_square);
             }
             else if ((m_last_destination_bit & m_white_bishops_bit) != 0)
             {
                 m_white_bishops_bit &= ~m_last_destination_bit;
                 m_captured_piece = 2;
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 2 + m_last_destination_square);
+                m_accumulators[m_ply + 1].removeFeature(64 * 2 + m_last_destination_square);
             }
             else if ((m_last_destination_bit & m_white_rooks_bit) != 0)
             {
                 m_white_rooks_bit &= ~m_last_destination_bit;
                 m_captured_piece = 3;
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 3 + m_last_destination_square);
+                m_accumulators[m_ply + 1].removeFeature(64 * 3 + m_last_destination_square);
             }
             else if ((m_last_destination_bit & m_white_queens_bit) != 0)
             {
                 m_white_queens_bit &= ~m_last_destination_bit;
                 m_captured_piece = 4;
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 4 + m_last_destination_square);
+                m_accumulators[m_ply + 1].removeFeature(64 * 4 + m_last_destination_square);
             }
         }
         // Non promotions
@@ -6156,17 +6124,14 @@ void BitPosition::makeCapture(T move)
                 m_black_king_position = m_last_destination_square;
                 m_moved_piece = 5;
                 m_is_check = isDiscoverCheckForWhite(m_last_origin_square, m_last_destination_square);
-
-                // Update NNUE input (after moving the king)
-                NNUEU::moveBlackKingNNUEInput(*this);
             }
             // Moving any piece except the king
             else
             {
                 BitPosition::setPiece(origin_bit, m_last_destination_bit);
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * (5 + m_moved_piece) + m_last_origin_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * (5 + m_moved_piece) + m_last_destination_square);
+                m_accumulators[m_ply + 1].removeFeature(64 * (5 + m_moved_piece) + m_last_origin_square);
+                m_accumulators[m_ply + 1].addFeature(64 * (5 + m_moved_piece) + m_last_destination_square);
             }
 
             // Captures (Non passant)
@@ -6175,35 +6140,35 @@ void BitPosition::makeCapture(T move)
                 m_white_pawns_bit &= ~m_last_destination_bit;
                 m_captured_piece = 0;
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, m_last_destination_square);
+                m_accumulators[m_ply + 1].removeFeature(m_last_destination_square);
             }
             else if ((m_last_destination_bit & m_white_knights_bit) != 0)
             {
                 m_white_knights_bit &= ~m_last_destination_bit;
                 m_captured_piece = 1;
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 + m_last_destination_square);
+                m_accumulators[m_ply + 1].removeFeature(64 + m_last_destination_square);
             }
             else if ((m_last_destination_bit & m_white_bishops_bit) != 0)
             {
                 m_white_bishops_bit &= ~m_last_destination_bit;
                 m_captured_piece = 2;
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 2 + m_last_destination_square);
+                m_accumulators[m_ply + 1].removeFeature(64 * 2 + m_last_destination_square);
             }
             else if ((m_last_destination_bit & m_white_rooks_bit) != 0)
             {
                 m_white_rooks_bit &= ~m_last_destination_bit;
                 m_captured_piece = 3;
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 3 + m_last_destination_square);
+                m_accumulators[m_ply + 1].removeFeature(64 * 3 + m_last_destination_square);
             }
             else
             {
                 m_white_queens_bit &= ~m_last_destination_bit;
                 m_captured_piece = 4;
                 // Set NNUE input
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 4 + m_last_destination_square);
+                m_accumulators[m_ply + 1].removeFeature(64 * 4 + m_last_destination_square);
             }
         }
     }
@@ -6212,8 +6177,13 @@ void BitPosition::makeCapture(T move)
     m_blockers_set = false;
 
     m_turn = not m_turn;
+    // Quiescence search evaluates the new position, so its key is needed to look the evaluation cache up.
+    // Castling rights are not updated by captures, the key only has to tell apart the evaluated positions.
+    BitPosition::updateZobristKeyPiecePartAfterMove(m_last_origin_square, m_last_destination_square);
+    m_zobrist_key ^= zobrist_keys::blackToMoveZobristNumber;
     m_captured_piece_array[m_ply] = m_captured_piece;
     m_ply++;
+    m_zobrist_keys_array[63 - m_ply] = m_zobrist_key;
 
     // bool isCheck{m_is_check};
     // setCheckInfoOnInitialization();
@@ -6225,9 +6195,9 @@ void BitPosition::makeCapture(T move)
     // }
 
     // Debugging purposes
-    // int16_t eval_1{NNUEU::evaluationFunction(true)};
+    // int16_t eval_1{NNUEU::evaluationFunction(*this, true)};
     // NNUEU::initializeNNUEInput(*this);
-    // int16_t eval_2{NNUEU::evaluationFunction(true)};
+    // int16_t eval_2{NNUEU::evaluationFunction(*this, true)};
     // bool special{(move.getData() & 0b0100000000000000) == 0b0100000000000000};
     // if (eval_1 != eval_2)
     // {
@@ -6256,8 +6226,12 @@ void BitPosition::unmakeCapture(T move)
     // If a move was made before, that means previous position had blockers set (which we restore from ply info)
     m_blockers_set = true;
 
+    m_zobrist_keys_array[63 - m_ply] = 0;
+
     m_ply--;
 
+    m_zobrist_key = m_zobrist_keys_array[63 - m_ply];
+
     // Update irreversible aspects
     m_diagonal_pins = m_diagonal_pins_array[m_ply];
     m_straight_pins = m_straight_pins_array[m_ply];
@@ -6279,10 +6253,8 @@ void BitPosition::unmakeCapture(T move)
         if ((move.getData() & 0b0100000000000000) == 0b0100000000000000)
         {
             m_black_pawns_bit |= origin_bit;
-            NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 5 + origin_square);
 
             m_black_queens_bit &= ~destination_bit;
-            NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 9 + destination_square);
 
             // Unmaking captures in promotions
             if (previous_captured_piece != 7)
@@ -6290,22 +6262,18 @@ void BitPosition::unmakeCapture(T move)
                 if (previous_captured_piece == 1) // Uncapture knight
                 {
                     m_white_knights_bit |= destination_bit;
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 + destination_square);
                 }
                 else if (previous_captured_piece == 2) // Uncapture bishop
                 {
                     m_white_bishops_bit |= destination_bit;
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 2 + destination_square);
                 }
                 else if (previous_captured_piece == 3) // Uncapture rook
                 {
                     m_white_rooks_bit |= destination_bit;
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 3 + destination_square);
                 }
                 else // Uncapture queen
                 {
                     m_white_queens_bit |= destination_bit;
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 4 + destination_square);
                 }
             }
         }
@@ -6316,68 +6284,52 @@ void BitPosition::unmakeCapture(T move)
             {
                 m_black_pawns_bit |= origin_bit;
                 m_black_pawns_bit &= ~destination_bit;
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 5 + destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 5 + origin_square);
             }
             else if ((destination_bit & m_black_knights_bit) != 0) // Unmove knight
             {
                 m_black_knights_bit |= origin_bit;
                 m_black_knights_bit &= ~destination_bit;
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 6 + destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 6 + origin_square);
             }
             else if ((destination_bit & m_black_bishops_bit) != 0) // Unmove bishop
             {
                 m_black_bishops_bit |= origin_bit;
                 m_black_bishops_bit &= ~destination_bit;
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 7 + destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 7 + origin_square);
             }
             else if ((destination_bit & m_black_rooks_bit) != 0) // Unmove rook
             {
                 m_black_rooks_bit |= origin_bit;
                 m_black_rooks_bit &= ~destination_bit;
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 8 + destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 8 + origin_square);
             }
             else if ((destination_bit & m_black_queens_bit) != 0) // Unmove queen
             {
                 m_black_queens_bit |= origin_bit;
                 m_black_queens_bit &= ~destination_bit;
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 9 + destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 9 + origin_square);
             }
             else // Unmove king
             {
                 m_black_king_bit = origin_bit;
                 m_black_king_position = origin_square;
-                NNUEU::moveBlackKingNNUEInput(*this);
             }
             // Unmaking captures
             if (previous_captured_piece == 0) // Uncapture pawn
             {
                 m_white_pawns_bit |= destination_bit;
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, destination_square);
             }
             else if (previous_captured_piece == 1) // Uncapture knight
             {
                 m_white_knights_bit |= destination_bit;
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 + destination_square);
             }
             else if (previous_captured_piece == 2) // Uncapture bishop
             {
                 m_white_bishops_bit |= destination_bit;
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 2 + destination_square);
             }
             else if (previous_captured_piece == 3) // Uncapture rook
             {
                 m_white_rooks_bit |= destination_bit;
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 3 + destination_square);
             }
             else // Uncapture queen
             {
                 m_white_queens_bit |= destination_bit;
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 4 + destination_square);
             }
         }
     }
@@ -6387,32 +6339,26 @@ void BitPosition::unmakeCapture(T move)
         if ((move.getData() & 0b0100000000000000) == 0b0100000000000000)
         {
             m_white_pawns_bit |= origin_bit;
-            NNUEU::addOnInput(m_white_king_position, m_black_king_position, origin_square);
 
             m_white_queens_bit &= ~destination_bit;
-            NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 4 + destination_square);
             // Unmaking captures in promotions
             if (previous_captured_piece != 7)
             {
                 if (previous_captured_piece == 1) // Uncapture knight
                 {
                     m_black_knights_bit |= destination_bit;
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 6 + destination_square);
                 }
                 else if (previous_captured_piece == 2) // Uncapture bishop
                 {
                     m_black_bishops_bit |= destination_bit;
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 7 + destination_square);
                 }
                 else if (previous_captured_piece == 3) // Uncapture rook
                 {
                     m_black_rooks_bit |= destination_bit;
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 8 + destination_square);
                 }
                 else // Uncapture queen
                 {
                     m_black_queens_bit |= destination_bit;
-                    NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 9 + destination_square);
                 }
             }
         }
@@ -6424,74 +6370,53 @@ void BitPosition::unmakeCapture(T move)
             {
                 m_white_pawns_bit |= origin_bit;
                 m_white_pawns_bit &= ~destination_bit;
-
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, origin_square);
             }
             else if ((destination_bit & m_white_knights_bit) != 0) // Unmove knight
             {
                 m_white_knights_bit |= origin_bit;
                 m_white_knights_bit &= ~destination_bit;
-
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 + destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 + origin_square);
             }
             else if ((destination_bit & m_white_bishops_bit) != 0) // Unmove bishop
             {
                 m_white_bishops_bit |= origin_bit;
                 m_white_bishops_bit &= ~destination_bit;
-
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 2 + destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 2 + origin_square);
             }
             else if ((destination_bit & m_white_rooks_bit) != 0) // Unmove rook
             {
                 m_white_rooks_bit |= origin_bit;
                 m_white_rooks_bit &= ~destination_bit;
-
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 3 + destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 3 + origin_square);
             }
             else if ((destination_bit & m_white_queens_bit) != 0) // Unmove queen
             {
                 m_white_queens_bit |= origin_bit;
                 m_white_queens_bit &= ~destination_bit;
-
-                NNUEU::removeOnInput(m_white_king_position, m_black_king_position, 64 * 4 + destination_square);
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 4 + origin_square);
             }
             else // Unmove king
             {
                 m_white_king_bit = origin_bit;
                 m_white_king_position = origin_square;
-                NNUEU::moveWhiteKingNNUEInput(*this);
             }
 
             // Unmaking captures
             if (previous_captured_piece == 0) // Uncapture pawn
             {
                 m_black_pawns_bit |= destination_bit;
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 5 + destination_square);
             }
             else if (previous_captured_piece == 1) // Uncapture knight
             {
                 m_black_knights_bit |= destination_bit;
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 6 + destination_square);
             }
             else if (previous_captured_piece == 2) // Uncapture bishop
             {
                 m_black_bishops_bit |= destination_bit;
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 7 + destination_square);
             }
             else if (previous_captured_piece == 3) // Uncapture rook
             {
                 m_black_rooks_bit |= destination_bit;
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 8 + destination_square);
             }
             else // Uncapture queen
             {
                 m_black_queens_bit |= destination_bit;
-                NNUEU::addOnInput(m_white_king_position, m_black_king_position, 64 * 9 + destination_square);
             }
         }
     }
@@ -6499,9 +6424,9 @@ void BitPosition::unmakeCapture(T move)
     m_turn = not m_turn;
 
     // Debugging purposes
-    // int16_t eval_1{NNUEU::evaluationFunction(true)};
+    // int16_t eval_1{NNUEU::evaluationFunction(*this, true)};
     // NNUEU::initializeNNUEInput(*this);
-    // int16_t eval_2{NNUEU::evaluationFunction(true)};
+    // int16_t eval_2{NNUEU::evaluationFunction(*this, true)};
     // bool special{(move.getData() & 0b0100000000000000) == 0b0100000000000000};
     // if (eval_1 != eval_2)
     // {
@@ -6783,12 +6708,15 @@ bool BitPosition::isThreeFoldOr50MoveRule() const
 {
     if (m_50_move_count >= 50)
         return true;
-    // Find the last non-zero key in the array
+    // Find the last non-zero key in the array. Positions before a null move (keys stored at higher indices) can't
+    // be reached again, so the scan stops there.
     uint64_t lastKey = 0;
     int countFifty = 0;
     int count = 0;
-    for (uint64_t key : m_zobrist_keys_array)
+    std::size_t end{m_null_move_ply < 0 ? m_zobrist_keys_array.size() : static_cast<std::size_t>(64 - m_null_move_ply)};
+    for (std::size_t i = 0; i < end; ++i)
     {
+        uint64_t key{m_zobrist_keys_array[i]};
         if (key != 0)
         {
             if (lastKey == 0)
@@ -4,6 +4,7 @@
 #include <cstdint> // For fixed sized integers
 #include "bit_utils.h" // Bit utility functions
 #include "move.h"
+#include "accumulator.h" // Network accumulators of the position
 #include <iostream>
 #include <sstream> 
 #include <vector>
@@ -45,23 +46,26 @@ private:
     unsigned short m_white_king_position{};
     unsigned short m_black_king_position{};
 
+    // Pins, attacked squares, blockers and check info are computed from the pieces when needed, so they are mutable
+    // and move generation works on const positions (e.g. allMoves)
+
     // For ilegal moves
-    uint64_t m_straight_pins{};
-    uint64_t m_diagonal_pins{};
+    mutable uint64_t m_straight_pins{};
+    mutable uint64_t m_diagonal_pins{};
 
-    uint64_t m_unsafe_squares{};
+    mutable uint64_t m_unsafe_squares{};
 
-    uint64_t m_king_unsafe_squares{};
+    mutable uint64_t m_king_unsafe_squares{};
 
     // For discovered checks
-    uint64_t m_blockers{};
-    bool m_blockers_set{false};
+    mutable uint64_t m_blockers{};
+    mutable bool m_blockers_set{false};
 
     // Bits representing check info
     bool m_is_check{false};
-    unsigned short m_check_square{65};
-    uint64_t m_check_rays{0};
-    unsigned short m_num_checks{0};
+    mutable unsigned short m_check_square{65};
+    mutable uint64_t m_check_rays{0};
+    mutable unsigned short m_num_checks{0};
 
     // For check info after move
     unsigned short m_last_origin_square{};
@@ -97,8 +101,13 @@ private:
     std::array<uint64_t, 64> m_zobrist_keys_array{};
 
     std::array<unsigned short, 64> m_captured_piece_array{}; // For unmakeMove
+    int m_null_move_ply{-1}; // Ply of the position reached by the last null move made, -1 if none
+    std::array<int, 64> m_null_move_ply_array{}; // For unmakeNullMove
     std::array<uint64_t, 64> m_unsafe_squares_array{};
 
+    // Network accumulator of each ply, m_accumulators[m_ply] is the current position's
+    AccumulatorStack m_accumulators{};
+
     std::array<uint64_t, 64> m_last_destination_bit_array{};
 
     // std::array<std::string, 64> m_fen_array{}; // For debugging purposes
@@ -234,7 +243,7 @@ public:
     }
     
     void setIsCheckOnInitialization();
-    void setCheckInfoOnInitialization();
+    void setCheckInfoOnInitialization() const;
 
     void initializeZobristKey();
     void updateZobristKeyPiecePartAfterMove(unsigned short origin_square, unsigned short destination_square);
@@ -243,10 +252,12 @@ public:
     void storePlyInfoInTTMove();
     void makeTTMove(Move tt_move);
     void unmakeTTMove(Move move);
+    void makeNullMove();
+    void unmakeNullMove();
 
-    void setPins();
-    void setBlockers();
-    void setAttackedSquares();
+    void setPins() const;
+    void setBlockers() const;
+    void setAttackedSquares() const;
 
     template <typename T>
     bool isLegal(const T &move) const;
@@ -378,8 +389,8 @@ public:
     template <typename T>
     void unmakeCaptureWithoutNNUE(T move);
 
-    std::vector<Move> inCheckAllMoves();
-    std::vector<Move> allMoves();
+    std::vector<Move> inCheckAllMoves() const;
+    std::vector<Move> allMoves() const;
 
     bool isEndgame() const
     {
@@ -443,6 +454,19 @@ public:
     }
 
     uint64_t getZobristKey() const { return m_zobrist_key; }
+
+    unsigned short getPly() const { return m_ply; }
+    // Whether the last move was a null move, which has nothing to refute
+    bool isAfterNullMove() const { return m_ply == m_null_move_ply; }
+    // Whether a legal move is neither a capture, a promotion nor a check, without making it
+    bool isQuietMove(Move move) const;
+    // Accumulators may be behind the position, Evaluation::updateAccumulator brings them up to date
+    Accumulator &getAccumulator() { return m_accumulators[m_ply]; }
+    const Accumulator &getAccumulator() const { return m_accumulators[m_ply]; }
+    Accumulator &getAccumulator(int ply) { return m_accumulators[ply]; }
+    // Accumulator size the inputs are allocated for, set by the network initializing them
+    int getAccumulatorSize() const { return m_accumulators.size(); }
+    void setAccumulatorSize(int size) { m_accumulators.resize(size); }
     std::array<uint64_t, 64> getZobristKeysArray() const { return m_zobrist_keys_array; }
     void printZobristKeys() const
     {
@@ -8,20 +8,19 @@
 #include <algorithm> // For std::max
 #include "ttable.h"
 #include <memory>
+#include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <cmath>
+#include <iostream>
 #include "position_eval.h"
 #include "engine.h"
+#include "nnue_ttable.h"
 
 extern TranspositionTable globalTT;
-extern int OURTIME;
-extern int OURINC;
-extern std::chrono::time_point<std::chrono::high_resolution_clock> STARTTIME;
+extern EvalCache globalEvalCache;
 
-int DEPTH;
-Move ourMoveMade;
-
-std::unordered_map<Move, std::vector<int16_t>> moveDepthValues;
-
-bool stopSearch(const std::vector<int16_t> &values, int streak, int depth, BitPosition position)
+bool stopSearch(const std::vector<int16_t> &values, int streak, int depth, const BitPosition &position)
 {
     // If not endgame
     if (not position.isEndgame())
@@ -56,11 +55,39 @@ bool stopSearch(const std::vector<int16_t> &values, int streak, int depth, BitPo
     return false;
 }
 
-int16_t quiesenceSearch(BitPosition &position, int16_t alpha, int16_t beta, bool our_turn)
+template <typename Evaluator>
+int16_t cachedEvaluation(SearchContext &context, bool our_turn)
+// Network evaluation of the position, looked up in the evaluation cache first for the networks that use it. The
+// cache stores it for the side to move, so both sides' searches share it.
+{
+    BitPosition &position{context.position};
+    if constexpr (not Evaluator::USE_EVAL_CACHE)
+        return Evaluator::evaluationFunction(position, our_turn);
+
+    int16_t value;
+    context.evalCacheProbes++;
+    if (globalEvalCache.probe(position.getZobristKey(), value))
+        context.evalCacheHits++;
+    else
+    {
+        value = Evaluator::evaluationFunction(position, true);
+        globalEvalCache.save(position.getZobristKey(), value);
+    }
+    if (our_turn)
+        return value;
+
+    return 64 * 64 - value;
+}
+
+template <typename Evaluator>
+int16_t quiesenceSearch(SearchContext &context, int16_t alpha, int16_t beta, bool our_turn)
 // This search is done when depth is less than or equal to 0 and considers only captures and promotions
 {
+    BitPosition &position{context.position};
+    context.nodes++;
+
     // If we are in quiescence, we have a baseline evaluation as if no captures happened
-    int16_t value{NNUEU::evaluationFunction(our_turn)};
+    int16_t value{cachedEvaluation<Evaluator>(context, our_turn)};
     Move best_move;
     bool no_captures{true};
     bool cutoff{false};
@@ -76,7 +103,7 @@ int16_t quiesenceSearch(BitPosition &position, int16_t alpha, int16_t beta, bool
             if (our_turn) // Maximize
             {
                 position.makeCapture(refutation);
-                int16_t child_value{quiesenceSearch(position, alpha, beta, false)};
+                int16_t child_value{quiesenceSearch<Evaluator>(context, alpha, beta, false)};
                 if (child_value > value)
                 {
                     value = child_value;
@@ -91,7 +118,7 @@ int16_t quiesenceSearch(BitPosition &position, int16_t alpha, int16_t beta, bool
             else // Minimize
             {
                 position.makeCapture(refutation);
-                int16_t child_value{quiesenceSearch(position, alpha, beta, true)};
+                int16_t child_value{quiesenceSearch<Evaluator>(context, alpha, beta, true)};
                 if (child_value < value)
                 {
                     value = child_value;
@@ -120,7 +147,7 @@ int16_t quiesenceSearch(BitPosition &position, int16_t alpha, int16_t beta, bool
                 while (capture.getData() != 0)
                 {
                     position.makeCapture(capture);
-                    int16_t child_value{quiesenceSearch(position, alpha, beta, false)};
+                    int16_t child_value{quiesenceSearch<Evaluator>(context, alpha, beta, false)};
                     if (child_value > value)
                     {
                         value = child_value;
@@ -139,7 +166,7 @@ int16_t quiesenceSearch(BitPosition &position, int16_t alpha, int16_t beta, bool
                 while (capture.getData() != 0)
                 {
                     position.makeCapture(capture);
-                    int16_t child_value{quiesenceSearch(position, alpha, beta, true)};
+                    int16_t child_value{quiesenceSearch<Evaluator>(context, alpha, beta, true)};
                     if (child_value < value)
                     {
                         value = child_value;
@@ -171,7 +198,7 @@ int16_t quiesenceSearch(BitPosition &position, int16_t alpha, int16_t beta, bool
             while (capture.getData() != 0)
             {
                 position.makeCapture(capture);
-                int16_t child_value{quiesenceSearch(position, alpha, beta, false)};
+                int16_t child_value{quiesenceSearch<Evaluator>(context, alpha, beta, false)};
                 if (child_value > value)
                 {
                     value = child_value;
@@ -190,7 +217,7 @@ int16_t quiesenceSearch(BitPosition &position, int16_t alpha, int16_t beta, bool
             while (capture.getData() != 0)
             {
                 position.makeCapture(capture);
-                int16_t child_value{quiesenceSearch(position, alpha, beta, true)};
+                int16_t child_value{quiesenceSearch<Evaluator>(context, alpha, beta, true)};
                 if (child_value < value)
                 {
                     value = child_value;
@@ -220,9 +247,9 @@ int16_t quiesenceSearch(BitPosition &position, int16_t alpha, int16_t beta, bool
                 else
                     return 30000;
             }
-            // In check quiet position
+            // In check quiet position, evaluated on entry
             else
-                return NNUEU::evaluationFunction(our_turn);
+                return value;
         }
         // If there is no check we check for bad captures
         else
@@ -230,215 +257,463 @@ int16_t quiesenceSearch(BitPosition &position, int16_t alpha, int16_t beta, bool
             // Stalemate
             if (position.isStalemate())
                 return 2048;
-            // Quiet position
+            // Quiet position, evaluated on entry
             else
-                return NNUEU::evaluationFunction(our_turn);
+                return value;
         }
     }
     return value;
 }
 
-int16_t alphaBetaSearch(BitPosition &position, int8_t depth, int16_t alpha, int16_t beta, bool our_turn)
-// This search is done when depth is more than 0 and considers all moves and stores positions in the transposition table
+// The main search is a negamax: every node maximizes the value for its side to move. The rest of the engine
+// (quiesence search, transposition table, evaluation) works with values good for the engine, so the values of the
+// opponent's nodes are mirrored around the draw value 2048. Mirroring reverses the order of values and is its own
+// inverse, so a move's value is the mirror of its child's value, and the child's window is the mirrored window.
+constexpr int MIRROR{64 * 64};
+
+// Null move pruning: depth reduction of the null move search (plus a ply for every 4 of depth), the minimum depth
+// to try it, and the minimum depth from which its cutoffs are verified
+constexpr int NULL_MOVE_REDUCTION{2};
+constexpr int NULL_MOVE_MIN_DEPTH{3};
+constexpr int NULL_MOVE_VERIFICATION_DEPTH{6};
+
+// Maximum depth of the shallow depth pruning (reverse futility, futility and razoring), whose margins grow with the
+// depth and are search parameters
+constexpr int SHALLOW_PRUNING_DEPTH{3};
+
+namespace SearchParameters
+{
+    int lmrBase{50};
+    int lmrDivisor{250};
+    int lmrMinDepth{3};
+    int lmrMinMoves{3};
+    int reverseFutilityMargin{300};
+    int futilityMargin{350};
+    int razoringMargin{500};
+
+    // Late move reductions by depth and move index, from lmrBase and lmrDivisor
+    static std::array<std::array<int8_t, 64>, 64> computeLateMoveReductions()
+    {
+        std::array<std::array<int8_t, 64>, 64> reductions;
+        for (int depth = 0; depth < 64; ++depth)
+            for (int index = 0; index < 64; ++index)
+            {
+                double reduction{lmrBase / 100.0};
+                if (depth > 0 && index > 0)
+                    reduction += std::log(depth) * std::log(index) * 100.0 / lmrDivisor;
+                reductions[depth][index] = static_cast<int8_t>(reduction);
+            }
+        return reductions;
+    }
+    std::array<std::array<int8_t, 64>, 64> lateMoveReductions{computeLateMoveReductions()};
+
+    struct UCIOption
+    {
+        const char *name;
+        int *value;
+        int defaultValue;
+        int min;
+        int max;
+    };
+    static const UCIOption uciOptions[]{
+        {"LMRBase", &lmrBase, 50, 0, 300},
+        {"LMRDivisor", &lmrDivisor, 250, 50, 1000},
+        {"LMRMinDepth", &lmrMinDepth, 3, 2, 64},
+        {"LMRMinMoves", &lmrMinMoves, 3, 1, 64},
+        {"ReverseFutilityMargin", &reverseFutilityMargin, 300, 0, 4096},
+        {"FutilityMargin", &futilityMargin, 350, 0, 4096},
+        {"RazoringMargin", &razoringMargin, 500, 0, 4096},
+    };
+
+    void printUCIOptions()
+    {
+        for (const UCIOption &option : uciOptions)
+            std::cout << "option name " << option.name << " type spin default " << option.defaultValue
+                      << " min " << option.min << " max " << option.max << "\n";
+        std::cout << std::flush;
+    }
+
+    bool setUCIOption(const std::string &name, const std::string &value)
+    {
+        for (const UCIOption &option : uciOptions)
+            if (name == option.name)
+            {
+                *option.value = std::clamp(std::stoi(value), option.min, option.max);
+                lateMoveReductions = computeLateMoveReductions();
+                return true;
+            }
+        return false;
+    }
+}
+
+static inline int8_t lateMoveReduction(int8_t depth, int moves_searched)
+// Plies a late quiet move is searched with less, leaving at least one ply
 {
-    // Threefold repetition
-    if (position.isThreeFoldOr50MoveRule())
-        return 2048;
+    int reduction{SearchParameters::lateMoveReductions[std::min<int>(depth, 63)][std::min(moves_searched, 63)]};
+    return static_cast<int8_t>(std::min(reduction, depth - 2));
+}
+
+static inline int sideToMoveValue(int value, bool our_turn)
+// Converts a value good for the engine into a value good for the side to move, and back
+{
+    return our_turn ? value : MIRROR - value;
+}
+
+// Node types, known at compile time so that root and PV only logic compiles out of the other nodes. PV nodes are
+// the first child of the root and of other PV nodes, any other node is a non PV node.
+enum NodeType
+{
+    ROOT,
+    PV,
+    NON_PV
+};
+
+template <typename Evaluator, NodeType Node>
+int negamax(SearchContext &context, int8_t depth, int alpha, int beta, bool our_turn);
+
+template <typename Evaluator>
+static inline int quiesenceValue(SearchContext &context, int alpha, int beta, bool our_turn)
+// Quiesence search value for the side to move, the quiesence search window and value are good for the engine
+{
+    if (our_turn)
+        return quiesenceSearch<Evaluator>(context, alpha, beta, true);
+    return MIRROR - quiesenceSearch<Evaluator>(context, MIRROR - beta, MIRROR - alpha, false);
+}
+
+template <typename Evaluator, NodeType Node, typename Make, typename Unmake>
+static inline int searchMove(SearchContext &context, int8_t depth, int alpha, int beta, bool our_turn, bool first_move,
+                             Make make, Unmake unmake, int8_t reduction = 0)
+// Value of a move for the side that makes it, make and unmake play it on the position.
+// Principal variation search: the first move of a PV node is expected to be the best one and is searched with the
+// full window. The other moves are searched with a null window, which only proves them no better than alpha, and
+// are searched again with the full window when that proof fails. Non PV nodes already have a null window.
+// Late move reductions: a late quiet move is searched reduction plies less, and searched again at full depth when
+// it beats alpha. Only quiet moves are given a reduction (see negamax).
+// A re-search makes the move again, since unmaking a move doesn't restore the check info of the position it leads to.
+{
+    int value;
+    make();
+    if (Node != NON_PV && first_move)
+        value = MIRROR - negamax<Evaluator, PV>(context, depth - 1, MIRROR - beta, MIRROR - alpha, not our_turn);
+    else
+        value = MIRROR - negamax<Evaluator, NON_PV>(context, depth - 1 - reduction, MIRROR - alpha - 1, MIRROR - alpha, not our_turn);
+    unmake();
+
+    if (reduction > 0 && value > alpha)
+    {
+        make();
+        value = MIRROR - negamax<Evaluator, NON_PV>(context, depth - 1, MIRROR - alpha - 1, MIRROR - alpha, not our_turn);
+        unmake();
+    }
+
+    if (Node != NON_PV && not first_move && value > alpha && value < beta)
+    {
+        make();
+        value = MIRROR - negamax<Evaluator, PV>(context, depth - 1, MIRROR - beta, MIRROR - alpha, not our_turn);
+        unmake();
+    }
+    return value;
+}
+
+template <typename Evaluator, NodeType Node>
+int negamax(SearchContext &context, int8_t depth, int alpha, int beta, bool our_turn)
+// This search is done when depth is more than 0 and considers all moves and stores positions in the transposition table.
+// At the root the moves are context.rootMoves, and the best one is left in context.rootBestMove.
+{
+    BitPosition &position{context.position};
+
+    if constexpr (Node != ROOT)
+    {
+        // Helper thread whose search is no longer needed (the value is never used)
+        if (context.stop->load(std::memory_order_relaxed))
+            return 2048;
+
+        // Threefold repetition
+        if (position.isThreeFoldOr50MoveRule())
+            return 2048;
+
+        // At depths <= 0 we enter quiesence search
+        if (depth <= 0)
+            return quiesenceValue<Evaluator>(context, alpha, beta, our_turn);
+
+        context.nodes++;
+    }
 
-    bool no_moves{true};
     bool cutoff{false};
-    bool is_check{position.getIsCheck()};
+    int moves_searched{0};
 
-    // Baseline evaluation
-    int16_t value{our_turn ? static_cast<int16_t>(-31000) : static_cast<int16_t>(31000)};
+    // Baseline evaluation (any move improves it)
+    int value{Node == ROOT ? -30001 : -31000};
     Move best_move;
 
-    // At depths <= 0 we enter quiesence search
-    if (depth <= 0)
-        return quiesenceSearch(position, alpha, beta, our_turn);
-
     // Check if we have stored this position in ttable
-    TTEntry *ttEntry = globalTT.probe(position.getZobristKey());
+    TTEntry ttEntry;
     Move tt_move{0};
-    bool is_pv_node{false};
+    bool was_pv_node{false};
+    if constexpr (Node == ROOT)
+    {
+        // If position is stored in transposition table
+        if (globalTT.probe(position.getZobristKey(), ttEntry))
+        {
+            // If depth in ttable is lower than the one we are going to search, we just use the tt_move
+            if (ttEntry.getDepth() < depth)
+                tt_move = ttEntry.getMove();
+
+            // If depth in ttable is higher or equal than the one we are going to search:
+            // 1) Exact value, we just return it (no need to search at a lower depth)
+            else if (ttEntry.getIsExact() &&
+                     std::find(context.rootMoves.begin(), context.rootMoves.end(), ttEntry.getMove()) != context.rootMoves.end())
+            {
+                context.rootBestMove = ttEntry.getMove();
+                return ttEntry.getValue();
+            }
+            // 2) Bound at deeper depth, we only use its move. The root window isn't narrowed with a lower bound,
+            // if every move failed low against it the root value and best move would be bounds, not exact.
+            else
+                tt_move = ttEntry.getMove();
+        }
+    }
     // If position is stored in ttable
-    if (ttEntry != nullptr)
+    else if (globalTT.probe(position.getZobristKey(), ttEntry))
     {
-        // We are in a PV-Node
-        if (ttEntry->getIsExact())
+        // The position was a PV-Node when it was stored
+        if (ttEntry.getIsExact())
         {
-            if (ttEntry->getDepth() >= depth)
-                return ttEntry->getValue();
-                
-            is_pv_node = true;
-            tt_move = ttEntry->getMove();
+            if (ttEntry.getDepth() >= depth)
+                return sideToMoveValue(ttEntry.getValue(), our_turn);
+
+            was_pv_node = true;
+            tt_move = ttEntry.getMove();
         }
-        // We are not in a PV-Node
+        // No move was better than alpha, so the value is an upper bound for the side to move
+        else if (ttEntry.getIsUpperBound())
+        {
+            tt_move = ttEntry.getMove();
+            int tt_value{sideToMoveValue(ttEntry.getValue(), our_turn)};
+            if (ttEntry.getDepth() >= depth && tt_value <= alpha)
+                return tt_value;
+        }
+        // A cutoff happened, so the value is a lower bound for the side to move
         else
         {
-            tt_move = ttEntry->getMove();
-            if (ttEntry->getDepth() >= depth)
+            tt_move = ttEntry.getMove();
+            if (ttEntry.getDepth() >= depth)
             {
-                // Lower bound at deeper depth
-                if (our_turn)
-                    alpha = ttEntry->getValue();
-                // Upper bound at deeper depth
-                else
-                    beta = ttEntry->getValue();
+                alpha = std::max(alpha, sideToMoveValue(ttEntry.getValue(), our_turn));
+                if (alpha >= beta)
+                    return alpha;
             }
         }
     }
-
-    // Transposition table move search
-    if (tt_move.getData() != 0)
+    // Moves no better than this leave the value an upper bound
+    const int original_alpha{alpha};
+
+    // Futility pruning: at shallow non PV nodes whose static evaluation is far below alpha, quiet moves are unlikely
+    // to raise it, so they are skipped and counted as worth futility_value (set below)
+    bool futility_pruning{false};
+    int futility_value{0};
+
+    // Searches the moves of a stage, from move on in the order given by next, until one produces a cutoff. Late
+    // quiet moves of the quiet stages are reduced (see searchMove), less in PV nodes. Captures, promotions and checks
+    // are neither pruned nor reduced, which is decided before making the move.
+    auto searchStage = [&](auto move, auto next, bool quiet_stage = false)
     {
-        no_moves = false;
-
-        position.setBlockers(); // For discovered checks
-        if (our_turn) // Maximize
+        while (move.getData() != 0)
         {
-            position.makeTTMove(tt_move);
-            int16_t child_value{alphaBetaSearch(position, depth - 1, alpha, beta, false)};
+            bool prunable{quiet_stage && futility_pruning && moves_searched > 0};
+            bool reducible{quiet_stage && depth >= SearchParameters::lmrMinDepth && moves_searched >= SearchParameters::lmrMinMoves};
+            bool quiet_move{(prunable || reducible) && position.isQuietMove(move)};
+
+            // Pruned moves only bound the value, they never become the best move
+            if (prunable && quiet_move)
+            {
+                moves_searched++;
+                value = std::max(value, futility_value);
+                move = next();
+                continue;
+            }
+
+            int8_t reduction{0};
+            if (reducible && quiet_move)
+                reduction = std::max(0, lateMoveReduction(depth, moves_searched) - (Node == PV));
+            int child_value{searchMove<Evaluator, Node>(context, depth, alpha, beta, our_turn, moves_searched++ == 0,
+                                                        [&]() { position.makeMove(move); },
+                                                        [&]() { position.unmakeMove(move); }, reduction)};
             if (child_value > value)
             {
                 value = child_value;
-                best_move = tt_move;
+                best_move = move;
             }
-            position.unmakeTTMove(tt_move);
             if (value >= beta)
+            {
                 cutoff = true;
+                return;
+            }
+
             alpha = std::max(alpha, value);
+            move = next();
         }
-        else // Minimize
+    };
+
+    if constexpr (Node == ROOT)
+    {
+        // Order the moves based on scores
+        std::vector<Move> &first_moves{context.rootMoves};
+        std::vector<int16_t> &first_moves_scores{context.rootMoveScores};
+        if (first_moves_scores.empty())
+        {
+            first_moves = position.orderAllMovesOnFirstIterationFirstTime(first_moves, tt_move);
+            first_moves_scores.assign(first_moves.size(), std::numeric_limits<int16_t>::max()); // No score yet
+        }
+        else
+        {
+            std::pair<std::vector<Move>, std::vector<int16_t>> result = position.orderAllMovesOnFirstIteration(first_moves, first_moves_scores);
+            first_moves = result.first;
+            first_moves_scores = result.second;
+        }
+
+        std::chrono::time_point<std::chrono::high_resolution_clock> first_move_start_time{std::chrono::high_resolution_clock::now()};
+        // Note that here we have no alpha/beta cutoffs, since we are only applying the first move. Moves after the
+        // first are only searched in full when their null window search says they improve alpha (see searchMove).
+        for (std::size_t i = 0; i < first_moves.size(); ++i)
         {
-            position.makeTTMove(tt_move);
-            int16_t child_value{alphaBetaSearch(position, depth - 1, alpha, beta, true)};
-            if (child_value < value)
+            Move &ourMoveMade{context.ourMoveMade};
+            ourMoveMade = first_moves[i];
+            int child_value{searchMove<Evaluator, ROOT>(context, depth, alpha, beta, true, i == 0,
+                                                        [&]() { position.makeMove(ourMoveMade); },
+                                                        [&]() { position.unmakeMove(ourMoveMade); })};
+            // The first move and the moves that beat alpha have exact values. The others failed low in their null
+            // window search, which only gives an upper bound, so it caps the score of the last iteration.
+            if (i == 0 || child_value > alpha)
+                first_moves_scores[i] = static_cast<int16_t>(child_value);
+            else
+                first_moves_scores[i] = static_cast<int16_t>(std::min<int>(first_moves_scores[i], child_value));
+            if (child_value > value)
             {
                 value = child_value;
-                best_move = tt_move;
+                best_move = ourMoveMade;
             }
-            position.unmakeTTMove(tt_move);
-            if (value <= alpha)
-                cutoff = true;
-            beta = std::min(beta, value);
+            alpha = std::max(alpha, value);
+            context.moveDepthValues[ourMoveMade].emplace_back(value);
+            // Calculate the elapsed time in milliseconds
+            std::chrono::duration<double, std::milli> duration = std::chrono::high_resolution_clock::now() - context.startTime;
+            // Check if the duration has been exceeded
+            if (duration >= context.timeForMoveMS)
+                break;
         }
-    }
 
-    // We only search if tt_move didn't produce a cutoff in the search tree
-    if (not cutoff)
+        // Find the time taken (milliseconds) to perform search at this depth, to predict the depth + 1 search time taken
+        context.lastRootSearchTimeMS = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                           std::chrono::high_resolution_clock::now() - first_move_start_time)
+                                           .count() + 1;
+        context.rootBestMove = best_move;
+    }
+    else
     {
-        if (not is_check) // Not in check
+        bool is_check{position.getIsCheck()};
+
+        if constexpr (Node == NON_PV)
         {
-            if (is_pv_node) // PV Nodes usually dont produce cutoffs so we generate all moves in one
+            // Static evaluation for the side to move, not used in check where the position isn't quiet
+            int static_value{is_check ? 0 : sideToMoveValue(cachedEvaluation<Evaluator>(context, our_turn), our_turn)};
+
+            // Shallow depth pruning, away from mate values (from 0 to MIRROR are evaluations)
+            if (not is_check && depth <= SHALLOW_PRUNING_DEPTH)
             {
-                if (not cutoff)
+                // Reverse futility pruning: the static evaluation is so far above beta that the opponent is unlikely
+                // to bring it back below in the remaining plies
+                if (beta > 0 && static_value - SearchParameters::reverseFutilityMargin * depth >= beta)
+                    return static_value;
+
+                // Razoring: the static evaluation is so far below alpha that only captures may raise it, so the
+                // quiesence search decides whether the node fails low
+                if (alpha < MIRROR && static_value + SearchParameters::razoringMargin * depth < alpha)
                 {
-                    // Refutation moves ordered
-                    Move refutationMoves[64];
-                    Move *current_move = refutationMoves;
-                    Move *end_move = position.setRefutationMovesOrdered(current_move);
-                    Move move = position.nextMove(current_move, end_move, tt_move);
-                    if (move.getData() != 0)
-                        no_moves = false;
-                    if (our_turn) // Maximize
-                    {
-                        while (move.getData() != 0)
-                        {
-                            position.makeMove(move);
-                            int16_t child_value{alphaBetaSearch(position, depth - 1, alpha, beta, false)};
-                            if (child_value > value)
-                            {
-                                value = child_value;
-                                best_move = move;
-                            }
-                            position.unmakeMove(move);
-                            if (value >= beta)
-                            {
-                                cutoff = true;
-                                break;
-                            }
-
-                            alpha = std::max(alpha, value);
-                            move = position.nextMove(current_move, end_move, tt_move);
-                        }
-                    }
-                    else // Minimize
-                    {
-                        while (move.getData() != 0)
-                        {
-                            position.makeMove(move);
-                            int16_t child_value{alphaBetaSearch(position, depth - 1, alpha, beta, true)};
-                            if (child_value < value)
-                            {
-                                value = child_value;
-                                best_move = move;
-                            }
-                            position.unmakeMove(move);
-                            if (value <= alpha)
-                            {
-                                cutoff = true;
-                                break;
-                            }
-
-                            beta = std::min(beta, value);
-                            move = position.nextMove(current_move, end_move, tt_move);
-                        }
-                    }
+                    int razor_value{quiesenceValue<Evaluator>(context, alpha, beta, our_turn)};
+                    if (razor_value <= alpha)
+                        return razor_value;
+                }
+
+                futility_value = static_value + SearchParameters::futilityMargin * depth;
+                futility_pruning = alpha < MIRROR && futility_value <= alpha;
+            }
+
+            // Null move pruning: if passing the turn still fails high in a reduced search, so would our best move. Not
+            // in check, where passing is illegal, and not in endgames, where zugzwang (passing would be the best
+            // move) is common. Not right after a null move either, which would search this position again. Cutoffs
+            // at high depths are verified by a reduced search of this node, in which our side doesn't pass.
+            if (not is_check && depth >= NULL_MOVE_MIN_DEPTH && not position.isAfterNullMove() &&
+                not context.verifyingNullMove[our_turn] &&
+                not position.isEndgame() && static_value >= beta)
+            {
+                int8_t null_depth{static_cast<int8_t>(depth - 1 - NULL_MOVE_REDUCTION - depth / 4)};
+
+                position.makeNullMove();
+                int null_value{MIRROR - negamax<Evaluator, NON_PV>(context, null_depth, MIRROR - beta, MIRROR - alpha, not our_turn)};
+                position.unmakeNullMove();
+
+                if (null_value >= beta)
+                {
+                    // Mates found after passing the turn may not exist
+                    if (null_value >= MIRROR)
+                        null_value = beta;
+                    if (depth < NULL_MOVE_VERIFICATION_DEPTH)
+                        return null_value;
+
+                    context.verifyingNullMove[our_turn] = true;
+                    int verified_value{negamax<Evaluator, NON_PV>(context, null_depth + 1, alpha, beta, our_turn)};
+                    context.verifyingNullMove[our_turn] = false;
+                    if (verified_value >= beta)
+                        return null_value;
                 }
+            }
+        }
+
+        // Transposition table move search (the 16 bit key check can give a false match, so we check legality)
+        if (tt_move.getData() != 0 && position.ttMoveIsLegal(tt_move))
+        {
+            position.setBlockers(); // For discovered checks
+            int child_value{searchMove<Evaluator, Node>(context, depth, alpha, beta, our_turn, moves_searched++ == 0,
+                                                        [&]() { position.makeTTMove(tt_move); },
+                                                        [&]() { position.unmakeTTMove(tt_move); })};
+            if (child_value > value)
+            {
+                value = child_value;
+                best_move = tt_move;
+            }
+            if (value >= beta)
+                cutoff = true;
+            alpha = std::max(alpha, value);
+        }
+
+        // We only search if tt_move didn't produce a cutoff in the search tree
+        if (not cutoff)
+        {
+            if (is_check)
+            {
+                // Before generating in check moves we need the checks info
+                Move moves[64];
+                Move *current_move = moves;
+                Move *end_move = position.setMovesInCheck(current_move);
+                searchStage(position.nextMove(current_move, end_move, tt_move),
+                            [&]() { return position.nextMove(current_move, end_move, tt_move); });
+            }
+            else if (was_pv_node) // PV Nodes usually dont produce cutoffs so we generate the moves in stages
+            {
+                // Refutation moves ordered
+                Move refutationMoves[64];
+                Move *current_move = refutationMoves;
+                Move *end_move = position.setRefutationMovesOrdered(current_move);
+                searchStage(position.nextMove(current_move, end_move, tt_move),
+                            [&]() { return position.nextMove(current_move, end_move, tt_move); });
                 if (not cutoff)
                 {
                     // Good captures ordered
                     Move goodCaptures[64];
-                    Move *current_move = goodCaptures;
-                    Move *end_move = position.setGoodCapturesOrdered(current_move);
-                    Move move = position.nextMove(current_move, end_move);
-                    if (move.getData() != 0)
-                        no_moves = false;
-                    if (our_turn) // Maximize
-                    {
-                        while (move.getData() != 0)
-                        {
-                            position.makeMove(move);
-                            int16_t child_value{alphaBetaSearch(position, depth - 1, alpha, beta, false)};
-                            if (child_value > value)
-                            {
-                                value = child_value;
-                                best_move = move;
-                            }
-                            position.unmakeMove(move);
-                            if (value >= beta)
-                            {
-                                cutoff = true;
-                                break;
-                            }
-
-                            alpha = std::max(alpha, value);
-                            move = position.nextMove(current_move, end_move, tt_move);
-                        }
-                    }
-                    else // Minimize
-                    {
-                        while (move.getData() != 0)
-                        {
-                            position.makeMove(move);
-                            int16_t child_value{alphaBetaSearch(position, depth - 1, alpha, beta, true)};
-                            if (child_value < value)
-                            {
-                                value = child_value;
-                                best_move = move;
-                            }
-                            position.unmakeMove(move);
-                            if (value <= alpha)
-                            {
-                                cutoff = true;
-                                break;
-                            }
-
-                            beta = std::min(beta, value);
-                            move = position.nextMove(current_move, end_move, tt_move);
-                        }
-                    }
+                    current_move = goodCaptures;
+                    end_move = position.setGoodCapturesOrdered(current_move);
+                    searchStage(position.nextMove(current_move, end_move),
+                                [&]() { return position.nextMove(current_move, end_move, tt_move); });
                 }
                 if (not cutoff)
                 {
@@ -446,107 +721,17 @@ int16_t alphaBetaSearch(BitPosition &position, int8_t depth, int16_t alpha, int1
                     ScoredMove safeMoves[128];
                     ScoredMove *currSafeMove = safeMoves;
                     ScoredMove *endSafeMove = position.setSafeMovesAndScores(currSafeMove);
-                    ScoredMove safe_move = position.nextScoredMove(currSafeMove, endSafeMove);
-                    if (safe_move.getData() != 0)
-                        no_moves = false;
-                    if (our_turn) // Maximize
-                    {
-                        while (safe_move.getData() != 0)
-                        {
-                            position.makeMove(safe_move);
-                            int16_t child_value{alphaBetaSearch(position, depth - 1, alpha, beta, false)};
-                            if (child_value > value)
-                            {
-                                value = child_value;
-                                best_move = safe_move;
-                            }
-                            position.unmakeMove(safe_move);
-                            if (value >= beta)
-                            {
-                                cutoff = true;
-                                break;
-                            }
-
-                            alpha = std::max(alpha, value);
-                            safe_move = position.nextScoredMove(currSafeMove, endSafeMove, tt_move);
-                        }
-                    }
-                    else // Minimize
-                    {
-                        while (safe_move.getData() != 0)
-                        {
-                            position.makeMove(safe_move);
-                            int16_t child_value{alphaBetaSearch(position, depth - 1, alpha, beta, true)};
-                            if (child_value < value)
-                            {
-                                value = child_value;
-                                best_move = safe_move;
-                            }
-                            position.unmakeMove(safe_move);
-                            if (value <= alpha)
-                            {
-                                cutoff = true;
-                                break;
-                            }
-
-                            beta = std::min(beta, value);
-                            safe_move = position.nextScoredMove(currSafeMove, endSafeMove, tt_move);
-                        }
-                    }
+                    searchStage(position.nextScoredMove(currSafeMove, endSafeMove),
+                                [&]() { return position.nextScoredMove(currSafeMove, endSafeMove, tt_move); }, true);
                 }
                 if (not cutoff)
                 {
                     // Bad captures
                     Move badCaptures[64];
-                    Move *current_move = badCaptures;
-                    Move *end_move = position.setBadCapturesOrUnsafeMoves(current_move);
-                    Move move = position.nextMove(current_move, end_move);
-                    if (move.getData() != 0)
-                        no_moves = false;
-                    if (our_turn) // Maximize
-                    {
-                        while (move.getData() != 0)
-                        {
-                            position.makeMove(move);
-                            int16_t child_value{alphaBetaSearch(position, depth - 1, alpha, beta, false)};
-                            if (child_value > value)
-                            {
-                                value = child_value;
-                                best_move = move;
-                            }
-                            position.unmakeMove(move);
-                            if (value >= beta)
-                            {
-                                cutoff = true;
-                                break;
-                            }
-
-                            alpha = std::max(alpha, value);
-                            move = position.nextMove(current_move, end_move, tt_move);
-                        }
-                    }
-                    else // Minimize
-                    {
-                        while (move.getData() != 0)
-                        {
-                            position.makeMove(move);
-                            int16_t child_value{alphaBetaSearch(position, depth - 1, alpha, beta, true)};
-                            if (child_value < value)
-                            {
-                                value = child_value;
-                                best_move = move;
-                            }
-                            position.unmakeMove(move);
-                            if (value <= alpha)
-                            {
-                                cutoff = true;
-                                break;
-                            }
-
-                            beta = std::min(beta, value);
-                            move = position.nextMove(current_move, end_move, tt_move);
-                        }
-                    }
+                    current_move = badCaptures;
+                    end_move = position.setBadCapturesOrUnsafeMoves(current_move);
+                    searchStage(position.nextMove(current_move, end_move),
+                                [&]() { return position.nextMove(current_move, end_move, tt_move); }, true);
                 }
             }
             else // Non PV nodes
@@ -554,212 +739,56 @@ int16_t alphaBetaSearch(BitPosition &position, int8_t depth, int16_t alpha, int1
                 ScoredMove moves[256];
                 ScoredMove *current_move = moves;
                 ScoredMove *end_move = position.setMovesAndScores(current_move);
-                ScoredMove move = position.nextScoredMove(current_move, end_move, tt_move);
-                if (move.getData() != 0)
-                    no_moves = false;
-                if (our_turn) // Maximize
-                {
-                    while (move.getData() != 0)
-                    {
-                        position.makeMove(move);
-                        int16_t child_value{alphaBetaSearch(position, depth - 1, alpha, beta, false)};
-                        if (child_value > value)
-                        {
-                            value = child_value;
-                            best_move = move;
-                        }
-                        position.unmakeMove(move);
-                        if (value >= beta)
-                        {
-                            cutoff = true;
-                            break;
-                        }
-
-                        alpha = std::max(alpha, value);
-                        move = position.nextScoredMove(current_move, end_move, tt_move);
-                    }
-                }
-                else // Minimize
-                {
-                    while (move.getData() != 0)
-                    {
-                        position.makeMove(move);
-                        int16_t child_value{alphaBetaSearch(position, depth - 1, alpha, beta, true)};
-                        if (child_value < value)
-                        {
-                            value = child_value;
-                            best_move = move;
-                        }
-                        position.unmakeMove(move);
-                        if (value <= alpha)
-                        {
-                            cutoff = true;
-                            break;
-                        }
-
-                        beta = std::min(beta, value);
-                        move = position.nextScoredMove(current_move, end_move, tt_move);
-                    }
-                }
+                searchStage(position.nextScoredMove(current_move, end_move, tt_move),
+                            [&]() { return position.nextScoredMove(current_move, end_move, tt_move); }, true);
             }
         }
-        else // In check
-        {
-            // Before generating in check moves we need the checks info
-            Move moves[64];
-            Move *current_move = moves;
-            Move *end_move = position.setMovesInCheck(current_move);
-            Move move = position.nextMove(current_move, end_move, tt_move);
-            if (move.getData() != 0)
-                no_moves = false;
-            if (our_turn) // Maximize
-            {
-                while (move.getData() != 0)
-                {
-                    position.makeMove(move);
-                    int16_t child_value{alphaBetaSearch(position, depth - 1, alpha, beta, false)};
-                    if (child_value > value)
-                    {
-                        value = child_value;
-                        best_move = move;
-                    }
-                    position.unmakeMove(move);
-                    if (value >= beta)
-                    {
-                        cutoff = true;
-                        break;
-                    }
-
-                    alpha = std::max(alpha, value);
-                    move = position.nextMove(current_move, end_move, tt_move);
-                }
-            }
-            else // Minimize
-            {
-                while (move.getData() != 0)
-                {
-                    position.makeMove(move);
-                    int16_t child_value{alphaBetaSearch(position, depth - 1, alpha, beta, true)};
-                    if (child_value < value)
-                    {
-                        value = child_value;
-                        best_move = move;
-                    }
-                    position.unmakeMove(move);
-                    if (value <= alpha)
-                    {
-                        cutoff = true;
-                        break;
-                    }
 
-                    beta = std::min(beta, value);
-                    move = position.nextMove(current_move, end_move, tt_move);
-                }
-            }
+        // Game finished since there are no legal moves
+        if (moves_searched == 0)
+        {
+            // Stalemate
+            if (not is_check)
+                return 2048;
+            // Checkmate, against us or against the opponent
+            return sideToMoveValue(our_turn ? -depth : 30000 + depth, our_turn);
         }
     }
-    // Game finished since there are no legal moves
-    if (no_moves)
-    {
-        // Stalemate
-        if (not is_check)
-            return 2048;
-        // Checkmate against us
-        else if (our_turn)
-            return - depth;
-        // Checkmate against opponent
-        else
-            return 30000 + depth;
-    }
-    // Saving a tt value
-    globalTT.save(position.getZobristKey(), value, depth, best_move, not cutoff);
+
+    // An abandoned search has unreliable values, so we don't store them
+    if (context.stop->load(std::memory_order_relaxed))
+        return value;
+
+    // Saving a tt value, the root value is always exact
+    bool fail_low{Node != ROOT && not cutoff && value <= original_alpha};
+    globalTT.save(position.getZobristKey(), static_cast<int16_t>(sideToMoveValue(value, our_turn)), depth, best_move,
+                  Node == ROOT || (not cutoff && not fail_low), fail_low);
 
     return value;
 }
 
-std::tuple<Move, int16_t, std::vector<int16_t>> firstMoveSearch(BitPosition &position, int8_t depth, int16_t alpha, int16_t beta, std::vector<Move> &first_moves, std::vector<int16_t> &first_moves_scores, std::chrono::milliseconds timeForMoveMS, std::chrono::milliseconds predictedTimeTakenMs, int &lastFirstMoveTimeTakenMS)
-// This search is done when depth is more than 0 and considers all moves
-// Note that here we have no alpha/beta cutoffs, since we are only applying the first move.
+template <typename Evaluator>
+void helperSearch(SearchContext &context, int8_t start_depth, int8_t fixed_max_depth)
+// Lazy SMP helper: searches the same root as the main thread until it is told to stop. Its results only reach the
+// main thread through the shared transposition table, which fills it with deeper entries and better tt moves.
 {
-    TTEntry *ttEntry = globalTT.probe(position.getZobristKey());
-    Move tt_move;
-    // If position is stored in transposition table
-    if (ttEntry != nullptr)
+    // Odd helpers search one ply ahead of the main thread, so that threads don't all search the same depth at once
+    for (int8_t depth = start_depth + (context.threadId & 1); depth <= fixed_max_depth; ++depth)
     {
-        // If depth in ttable is lower than the one we are going to search, we just use the tt_move
-        if (ttEntry->getDepth() < depth)
-            tt_move = ttEntry->getMove();
-
-        // If depth in ttable is higher or equal than the one we are going to search:
-        // 1) Exact value, we just return it (no need to search at a lower depth)
-        else if (ttEntry->getDepth() >= depth && ttEntry->getIsExact())
-            return std::tuple<Move, int16_t, std::vector<int16_t>>(ttEntry->getMove(), ttEntry->getValue(), first_moves_scores);
-        // 2) Lower bound at deeper depth and best move found
-        else if (ttEntry->getDepth() >= depth)
-        {
-            tt_move = ttEntry->getMove();
-            alpha = ttEntry->getValue();
-        }
-    }
-    // Order the moves based on scores
-    if (first_moves_scores.empty())
-    {
-        first_moves = position.orderAllMovesOnFirstIterationFirstTime(first_moves, tt_move);
-        first_moves_scores.reserve(first_moves.size());
-    }
-    else
-    {
-        std::pair<std::vector<Move>, std::vector<int16_t>> result = position.orderAllMovesOnFirstIteration(first_moves, first_moves_scores);
-        first_moves = result.first;
-        first_moves_scores = result.second;
-    }
-
-    // Baseline evaluation
-    int16_t value{static_cast<int16_t>(-30001)};
-    Move best_move{0};
-
-    std::chrono::time_point<std::chrono::high_resolution_clock> first_move_start_time{std::chrono::high_resolution_clock::now()};
-    Move newKiller{};
-    // Maximize (it's our move)
-    for (std::size_t i = 0; i < first_moves.size(); ++i)
-    {
-        ourMoveMade = first_moves[i];
-        position.makeMove(ourMoveMade);
-        int16_t child_value{alphaBetaSearch(position, depth - 1, alpha, beta, false)};
-        first_moves_scores[i] = child_value;
-        if (child_value > value)
-        {
-            value = child_value;
-            best_move = ourMoveMade;
-        }
-        
-        position.unmakeMove(ourMoveMade);
-        alpha = std::max(alpha, value);
-        moveDepthValues[ourMoveMade].emplace_back(value);
-        // Calculate the elapsed time in milliseconds
-        std::chrono::duration<double, std::milli> duration = std::chrono::high_resolution_clock::now() - STARTTIME;
-        // Check if the duration has been exceeded
-        if (duration >= timeForMoveMS)
+        negamax<Evaluator, ROOT>(context, depth, -31001, 31001, true);
+        if (context.stop->load(std::memory_order_relaxed))
             break;
     }
-
-    // Find the time taken (milliseconds) to perform search at this depth, to predict the depth + 1 search time taken (lastFirstMoveTimeTaken is an int)
-    lastFirstMoveTimeTakenMS = std::chrono::duration_cast<std::chrono::milliseconds>(
-                                   std::chrono::high_resolution_clock::now() - first_move_start_time)
-                                   .count() + 1;
-
-    // Saving an exact value
-    globalTT.save(position.getZobristKey(), value, depth, best_move, true);
-
-    return std::tuple<Move, int16_t, std::vector<int16_t>>(best_move, value, first_moves_scores);
 }
 
-std::pair<Move, int16_t> iterativeSearch(BitPosition position, int8_t start_depth, int8_t fixed_max_depth)
+template <typename Evaluator>
+std::pair<Move, int16_t> iterativeSearch(SearchContext &context, int8_t start_depth, int8_t fixed_max_depth)
 {
-    moveDepthValues = {};
-    std::vector<Move> first_moves;
-    int lastFirstMoveTimeTakenMS {1};
-    std::chrono::milliseconds timeForMoveMS{(OURTIME + OURINC) / 6};
+    BitPosition &position{context.position};
+    globalTT.newSearch();
+    std::vector<Move> &first_moves{context.rootMoves};
+    context.rootMoveScores.clear();
+    context.lastRootSearchTimeMS = 1;
 
     if (position.getIsCheck())
         first_moves = position.inCheckAllMoves();
@@ -767,25 +796,44 @@ std::pair<Move, int16_t> iterativeSearch(BitPosition position, int8_t start_dept
         first_moves = position.allMoves();
 
     // If there is only one move in the position, we make it
-    if (first_moves.size() == 1) 
+    if (first_moves.size() == 1)
         return std::pair<Move, int16_t>(first_moves[0], 0);
 
-    Move bestMove{};
+    // Lazy SMP: each helper thread searches its own copy of the context, sharing only the transposition table
+    std::atomic<bool> stop{false};
+    context.stop = &stop;
+    std::vector<std::unique_ptr<SearchContext>> helperContexts;
+    std::vector<std::thread> helpers;
+    for (int i = 1; i < context.numThreads; ++i)
+    {
+        helperContexts.emplace_back(std::make_unique<SearchContext>(context));
+        helperContexts.back()->threadId = i;
+        helpers.emplace_back(helperSearch<Evaluator>, std::ref(*helperContexts.back()), start_depth, fixed_max_depth);
+    }
+
+    // If no iteration completes (too little time), the move and value stored for the root are returned, or the
+    // first legal move (if any) with the root's baseline value
+    Move bestMove{first_moves.empty() ? Move() : first_moves[0]};
+    int16_t bestValue{-30001};
+    TTEntry rootEntry;
+    if (globalTT.probe(position.getZobristKey(), rootEntry) &&
+        std::find(first_moves.begin(), first_moves.end(), rootEntry.getMove()) != first_moves.end())
+    {
+        bestMove = rootEntry.getMove();
+        bestValue = rootEntry.getValue();
+    }
     Move bestMovePreviousDepth{};
-    int16_t bestValue;
-    std::tuple<Move, int16_t, std::vector<int16_t>> tuple;
-    std::vector<int16_t> first_moves_scores; // For first move ordering
     int streak = 1;                          // To keep track of the improvement streak
 
     // Iterative deepening
     for (int8_t depth = start_depth; depth <= fixed_max_depth; ++depth)
     {
         // We are going to perform N searches of time T, where:
-        // N is first_moves.size() and T is lastFirstMoveTimeTakenMS
+        // N is first_moves.size() and T is lastRootSearchTimeMS
         // Hence we can predict the time taken of this new search to be N * T
-        std::chrono::milliseconds predictedTimeTakenMs{first_moves.size() * lastFirstMoveTimeTakenMS};
-        
-        if (predictedTimeTakenMs >= timeForMoveMS)
+        std::chrono::milliseconds predictedTimeTakenMs{first_moves.size() * context.lastRootSearchTimeMS};
+
+        if (predictedTimeTakenMs >= context.timeForMoveMS)
             break;
 
         // Set best current values to worse possible ones (so that we try to improve them)
@@ -793,13 +841,11 @@ std::pair<Move, int16_t> iterativeSearch(BitPosition position, int8_t start_dept
         int16_t beta{31001};
 
         // Search
-        tuple = firstMoveSearch(position, depth, alpha, beta, first_moves, first_moves_scores, timeForMoveMS, predictedTimeTakenMs, lastFirstMoveTimeTakenMS);
-        bestMove = std::get<0>(tuple);
-        bestValue = std::get<1>(tuple);
-        first_moves_scores = std::get<2>(tuple);
+        bestValue = static_cast<int16_t>(negamax<Evaluator, ROOT>(context, depth, alpha, beta, true));
+        bestMove = context.rootBestMove;
+
+        context.depth = static_cast<int>(depth);
 
-        DEPTH = static_cast<int>(depth);
-        
         if (bestMove.getData() == bestMovePreviousDepth.getData())
             streak++;
         else
@@ -808,17 +854,36 @@ std::pair<Move, int16_t> iterativeSearch(BitPosition position, int8_t start_dept
             streak = 1;
         }
         // Check stop condition based on streak and improvement pattern
-        if (stopSearch(moveDepthValues[bestMove], streak, depth, position))
+        if (stopSearch(context.moveDepthValues[bestMove], streak, depth, position))
             break;
 
         // Calculate the elapsed time in milliseconds
-        std::chrono::duration<double, std::milli> duration = std::chrono::high_resolution_clock::now() - STARTTIME;
+        std::chrono::duration<double, std::milli> duration = std::chrono::high_resolution_clock::now() - context.startTime;
         // Check if the duration has been exceeded
-        if (duration >= timeForMoveMS)
+        if (duration >= context.timeForMoveMS)
             break;
 
     }
 
-    //std::cout << "Depth: " << DEPTH << "\n";
+    // The main thread decides the move, so the helpers can stop
+    stop = true;
+    for (std::thread &helper : helpers)
+        helper.join();
+    for (const std::unique_ptr<SearchContext> &helperContext : helperContexts)
+    {
+        context.nodes += helperContext->nodes;
+        context.evalCacheProbes += helperContext->evalCacheProbes;
+        context.evalCacheHits += helperContext->evalCacheHits;
+    }
+    context.stop = nullptr;
+
+    //std::cout << "Depth: " << context.depth << "\n";
     return std::pair<Move, int16_t>(bestMove, bestValue);
 }
+
+std::pair<Move, int16_t> iterativeSearch(SearchContext &context, int8_t start_depth, int8_t fixed_max_depth)
+// The search is instantiated for each evaluator, the loaded network picks one once per search
+{
+    return Evaluation::withEvaluator([&](auto evaluator)
+                                     { return iterativeSearch<decltype(evaluator)>(context, start_depth, fixed_max_depth); });
+}
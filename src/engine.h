@@ -10,13 +10,64 @@
 #include <algorithm> // For std::max
 #include "ttable.h"
 #include <memory>
+#include <unordered_map>
+#include <atomic>
+#include <string>
 #include "position_eval.h"
+#include "nnue_ttable.h"
 
 
 extern TranspositionTable globalTT;
-extern int OURTIME;
-extern int OURINC;
-extern std::chrono::time_point<std::chrono::high_resolution_clock> STARTTIME;
+extern EvalCache globalEvalCache;
 
-std::pair<Move, int16_t> iterativeSearch(BitPosition position, int8_t start_depth, int8_t fixed_max_depth = 100);
+// Everything a search thread reads and writes while searching, apart from the shared transposition table
+// and evaluation cache.
+// The main thread and each Lazy SMP helper own one, so threads never share a position or its accumulators.
+struct SearchContext
+{
+    SearchContext(const BitPosition &root, int ourTime, int ourInc, int threads = 1)
+        : position(root), startTime(std::chrono::high_resolution_clock::now()),
+          timeForMoveMS((ourTime + ourInc) / 6), numThreads(threads) {}
+
+    BitPosition position; // Searched in place, made and unmade moves restore it
+    std::chrono::time_point<std::chrono::high_resolution_clock> startTime;
+    std::chrono::milliseconds timeForMoveMS;
+    int numThreads;
+    int threadId{0};
+    std::atomic<bool> *stop{nullptr}; // Set by the main thread once it has chosen its move
+
+    uint64_t nodes{0}; // Nodes visited by negamax and quiesenceSearch
+    uint64_t evalCacheProbes{0}; // Evaluations asked by quiesenceSearch
+    uint64_t evalCacheHits{0};   // Of which were found in the evaluation cache
+    int depth{0};      // Last depth completed by iterative deepening
+    Move ourMoveMade;  // Root move being searched
+    std::array<bool, 2> verifyingNullMove{}; // For each side (our_turn), whether its null move cutoff is being verified
+    std::vector<Move> rootMoves;          // Legal root moves, in the order of the last iteration
+    std::vector<int16_t> rootMoveScores;  // Their values in the last iteration (for move ordering)
+    Move rootBestMove;                    // Best root move of the last iteration
+    int lastRootSearchTimeMS{1};          // Time taken by the last iteration, to predict the next one
+    std::unordered_map<Move, std::vector<int16_t>> moveDepthValues;
+};
+
+// Search parameters tuned offline (e.g. with SPSA), each one a UCI spin option of the name in its comment
+namespace SearchParameters
+{
+    // Late move reductions (see negamax) of LMRBase + log(depth) * log(move index) / LMRDivisor plies, both in
+    // hundredths of a ply
+    extern int lmrBase;     // LMRBase
+    extern int lmrDivisor;  // LMRDivisor
+    extern int lmrMinDepth; // LMRMinDepth, depth from which moves are reduced
+    extern int lmrMinMoves; // LMRMinMoves, moves searched before the rest are reduced
+
+    // Shallow depth pruning margins (see negamax), multiplied by the depth and in evaluation units
+    extern int reverseFutilityMargin; // ReverseFutilityMargin, static evaluation excess over beta to return it
+    extern int futilityMargin;        // FutilityMargin, static evaluation gain a quiet move is assumed to reach
+    extern int razoringMargin;        // RazoringMargin, static evaluation deficit to alpha to drop into quiesence
+
+    // Print the UCI option lines, and set an option returning whether it is a search parameter
+    void printUCIOptions();
+    bool setUCIOption(const std::string &name, const std::string &value);
+}
+
+std::pair<Move, int16_t> iterativeSearch(SearchContext &context, int8_t start_depth, int8_t fixed_max_depth = 100);
 #endif
@@ -16,17 +16,22 @@
 #include <fstream>
 #include <vector>
 #include <cstdlib>
+#include <algorithm>
+#include <stdexcept>
 #include "memory.h"
+#include "simd.h"
 
 
 
 TranspositionTable globalTT;
 TranspositionTableNNUE nnueTT; // For position generator
+EvalCache globalEvalCache;
 bool ENGINEISWHITE; 
 int OURTIME{1200}; // Talhands time left
 int OURINC{1200}; // Increment per move
-std::chrono::time_point<std::chrono::high_resolution_clock> STARTTIME; // Starting thinking time point
-int TTSIZE{23};
+int HASHSIZEMB{128}; // Transposition table size, set with the UCI Hash option
+int THREADS{1}; // Number of search threads, set with the UCI Threads option
+const int EVALCACHEMB{16}; // Evaluation cache size
 
 void printArray(const char *name, const int16_t *array, size_t size)
 {
@@ -38,7 +43,7 @@ void printArray(const char *name, const int16_t *array, size_t size)
     std::cout << std::endl;
 }
 
-Move findNormalMoveFromString(std::string moveString, BitPosition position)
+Move findNormalMoveFromString(const std::string &moveString, const BitPosition &position)
 {
     if (position.getIsCheck())
     {
@@ -131,8 +136,9 @@ int main()
 {
     int startDepth{0};
 
-    // Initialize std::vectors of NNUEInput layers as global variables
-    NNUEU::initNNUEParameters();
+    // Load the network used by the evaluation
+    if (not Evaluation::loadDefaultNetwork())
+        return 1;
 
     // Initialize magic numbers and zobrist numbers
     initmagicmoves();
@@ -145,7 +151,8 @@ int main()
     std::string lastFen; // Variable to store the last FEN string
     BitPosition position {BitPosition("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1")};
 
-    globalTT.resize(1 << TTSIZE);
+    globalTT.resize(HASHSIZEMB);
+    globalEvalCache.resize(EVALCACHEMB);
     // Simple loop to read commands from the Python GUI following UCI communication protocol
     while (std::getline(std::cin, inputLine))
     {
@@ -155,10 +162,61 @@ int main()
         iss >> command;
         if (command == "uci")
         {
-            std::cout << "id name La_Mano_de_Tahl\n" << std::flush;
+            std::cout << "id name La_Mano_de_Tahl (" << getSimdBackend() << ")\n" << std::flush;
             std::cout << "id author Miguel_Cordoba\n" << std::flush;
+            std::cout << "option name Hash type spin default 128 min 1 max 262144\n" << std::flush;
+            std::cout << "option name Threads type spin default 1 min 1 max 256\n" << std::flush;
+            std::cout << "option name EvalFile type string default <default>\n" << std::flush;
+            SearchParameters::printUCIOptions();
             std::cout << "uciok\n" << std::flush;
         }
+        // setoption name <id> value <x>
+        else if (command == "setoption")
+        {
+            std::string name, value;
+            iss >> command >> name >> command;
+            std::getline(iss >> std::ws, value); // Values may contain spaces (file paths)
+            // Numeric options throw on values that aren't numbers, which are ignored
+            try
+            {
+                if (name == "Hash")
+                {
+                    int megaBytes{std::clamp(std::stoi(value), 1, 262144)};
+                    // Resizing also empties the table, so we only do it if the size changes
+                    if (megaBytes != HASHSIZEMB)
+                    {
+                        HASHSIZEMB = megaBytes;
+                        globalTT.resize(HASHSIZEMB);
+                    }
+                }
+                else if (name == "Threads")
+                    THREADS = std::clamp(std::stoi(value), 1, 256);
+                // The default is the network embedded in the executable
+                else if (name == "EvalFile")
+                {
+                    // Any architecture, the search is switched to the one in the file's header
+                    bool loaded{(value.empty() || value == "<default>") ? Evaluation::loadDefaultNetwork()
+                                                                         : Evaluation::loadNetwork(value)};
+                    if (loaded)
+                    {
+                        // Accumulators and stored values come from the previous network
+                        Evaluation::initializeNNUEInput(position);
+                        globalTT.clear();
+                        globalEvalCache.clear();
+                        std::cout << "info string EvalFile " << value << " loaded\n" << std::flush;
+                    }
+                    else
+                        std::cout << "info string EvalFile " << value << " not loaded, keeping the current network\n" << std::flush;
+                }
+                // Tunable search parameters
+                else if (not SearchParameters::setUCIOption(name, value))
+                    std::cout << "info string Unknown option " << name << "\n" << std::flush;
+            }
+            catch (const std::exception &)
+            {
+                std::cout << "info string Invalid value " << value << " for option " << name << "\n" << std::flush;
+            }
+        }
         else if (command == "isready")
         {
             std::cout << "readyok\n";
@@ -168,6 +226,11 @@ int main()
         {
             break;
         }
+        // The transposition table is kept between moves of the same game, and only emptied for a new one
+        else if (command == "ucinewgame")
+        {
+            globalTT.clear();
+        }
         // Setting up position
         else if (command == "position")
         {
@@ -186,7 +249,7 @@ int main()
 
             position = BitPosition(fen);
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position);
+            Evaluation::initializeNNUEInput(position);
             
             Move move;
             Move lastMove;
@@ -211,13 +274,15 @@ int main()
                 // the plyInfo (for threefold checking) in position
                 if (reseterMove)
                     position.resetPlyInfo();
-                globalTT.resize(1 << TTSIZE);
             }
             startDepth = 2;
         }
         // Thinking after opponent made move
         else if (inputLine.substr(0, 2) == "go")
         {
+            // Table values are relative to the engine side, so they are useless if we switch sides
+            if (ENGINEISWHITE != position.getTurn())
+                globalTT.clear();
             ENGINEISWHITE = position.getTurn();
             // Get our time left and increment
             while (iss >> command)
@@ -232,11 +297,11 @@ int main()
                     iss >> OURINC;
             }
 
-            //std::cout << "Static Eval Before Move: " << NNUEU::evaluationFunction(true) << "\n";
+            //std::cout << "Static Eval Before Move: " << NNUEU::evaluationFunction(position, true) << "\n";
             // Call the engine
-            STARTTIME = std::chrono::high_resolution_clock::now();
             startDepth = 2;
-            auto [bestMove, bestValue]{iterativeSearch(position, startDepth)};
+            SearchContext context(position, OURTIME, OURINC, THREADS);
+            auto [bestMove, bestValue]{iterativeSearch(context, startDepth)};
 
             // Send our best move through a UCI command
             // std::cout << "Eval: " << bestValue << "\n";
@@ -245,9 +310,9 @@ int main()
 
             // Static eval after making move (testing purposes)
             position.makeMove(bestMove);
-            // std::cout << "Static Eval After Move: " << NNUEU::evaluationFunction(false) << "\n";
-            NNUEU::initializeNNUEInput(position);
-            // std::cout << "Static Eval After Move: " << NNUEU::evaluationFunction(false) << "\n";
+            // std::cout << "Static Eval After Move: " << NNUEU::evaluationFunction(position, false) << "\n";
+            Evaluation::initializeNNUEInput(position);
+            // std::cout << "Static Eval After Move: " << NNUEU::evaluationFunction(position, false) << "\n";
 
             // position.printZobristKeys();
 
@@ -286,7 +351,7 @@ int main()
             // Position 1
             std::cout << "Position 1 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_1);
+            Evaluation::initializeNNUEInput(position_1);
             auto start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -300,7 +365,7 @@ int main()
             // Position 2
             std::cout << "Position 2 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_2);
+            Evaluation::initializeNNUEInput(position_2);
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -313,7 +378,7 @@ int main()
             // Position 3
             std::cout << "Position 3 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_3);
+            Evaluation::initializeNNUEInput(position_3);
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -326,7 +391,7 @@ int main()
             // Position 4
             std::cout << "Position 4 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_4);
+            Evaluation::initializeNNUEInput(position_4);
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -340,7 +405,7 @@ int main()
             // Position 5
             std::cout << "Position 5 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_5);
+            Evaluation::initializeNNUEInput(position_5);
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -354,7 +419,7 @@ int main()
             // Position 6
             std::cout << "Position 6 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_6);
+            Evaluation::initializeNNUEInput(position_6);
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -395,7 +460,7 @@ int main()
             // Position 1
             std::cout << "Position 1 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_1);
+            Evaluation::initializeNNUEInput(position_1);
             auto start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -409,7 +474,7 @@ int main()
             // Position 2
             std::cout << "Position 2 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_2);
+            Evaluation::initializeNNUEInput(position_2);
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -422,7 +487,7 @@ int main()
             // Position 3
             std::cout << "Position 3 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_3);
+            Evaluation::initializeNNUEInput(position_3);
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -436,7 +501,7 @@ int main()
             // Position 4
             std::cout << "Position 4 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_4);
+            Evaluation::initializeNNUEInput(position_4);
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -450,7 +515,7 @@ int main()
             // Position 5
             std::cout << "Position 5 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_5);
+            Evaluation::initializeNNUEInput(position_5);
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -464,7 +529,7 @@ int main()
             // Position 6
             std::cout << "Position 6 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_6);
+            Evaluation::initializeNNUEInput(position_6);
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -504,7 +569,7 @@ int main()
             // Position 1
             std::cout << "Position 1 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_1);
+            Evaluation::initializeNNUEInput(position_1);
             auto start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -518,7 +583,7 @@ int main()
             // Position 2
             std::cout << "Position 2 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_2);
+            Evaluation::initializeNNUEInput(position_2);
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -532,7 +597,7 @@ int main()
             // Position 3
             std::cout << "Position 3 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_3);
+            Evaluation::initializeNNUEInput(position_3);
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -547,7 +612,7 @@ int main()
             // Position 4
             std::cout << "Position 4 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_4);
+            Evaluation::initializeNNUEInput(position_4);
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -561,7 +626,7 @@ int main()
             // Position 5
             std::cout << "Position 5 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_5);
+            Evaluation::initializeNNUEInput(position_5);
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -575,7 +640,7 @@ int main()
             // Position 6
             std::cout << "Position 6 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_6);
+            Evaluation::initializeNNUEInput(position_6);
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -616,7 +681,7 @@ int main()
             // Position 1
             std::cout << "Position 1 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_1);
+            Evaluation::initializeNNUEInput(position_1);
             auto start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -630,7 +695,7 @@ int main()
             // Position 2
             std::cout << "Position 2 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_2);
+            Evaluation::initializeNNUEInput(position_2);
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -643,7 +708,7 @@ int main()
             // Position 3
             std::cout << "Position 3 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_3);
+            Evaluation::initializeNNUEInput(position_3);
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -657,7 +722,7 @@ int main()
             // Position 4
             std::cout << "Position 4 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_4);
+            Evaluation::initializeNNUEInput(position_4);
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -671,7 +736,7 @@ int main()
             // Position 5
             std::cout << "Position 5 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_5);
+            Evaluation::initializeNNUEInput(position_5);
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -685,7 +750,7 @@ int main()
             // Position 6
             std::cout << "Position 6 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_6);
+            Evaluation::initializeNNUEInput(position_6);
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -700,6 +765,61 @@ int main()
         }
 
         // Test setCapturesAndScores and setCapturesInCheck generators efficiency
+        else if (inputLine == "tTConcurrencyTests")
+        {
+            int numThreads;
+            std::cout << "Number of threads: \n";
+            while (!(std::cin >> numThreads))
+            {
+                std::cin.clear();                                                   // clear the error flag
+                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); // discard invalid input
+                std::cout << "Invalid input. Please enter a integer: \n";
+            }
+            uint64_t corrupted{runTTStressTest(numThreads, 2000000)};
+            std::cout << (corrupted == 0 ? "No corrupted entries\n" : "Corrupted entries found\n");
+        }
+        else if (inputLine == "accumulatorTests")
+        {
+            int depth;
+            std::cout << "Depth: \n";
+            while (!(std::cin >> depth))
+            {
+                std::cin.clear();                                                   // clear the error flag
+                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); // discard invalid input
+                std::cout << "Invalid input. Please enter a integer: \n";
+            }
+            const std::vector<std::string> fens{
+                "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+                "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+                "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+                "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+                "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8"};
+            unsigned long long mismatches{0};
+            for (const std::string &fen : fens)
+            {
+                BitPosition testPosition{BitPosition(fen)};
+                NNUEU::initializeNNUEInput(testPosition);
+                mismatches += runAccumulatorStackTest(testPosition, depth);
+            }
+            std::cout << (mismatches == 0 ? "Accumulators match\n" : "Accumulators differ\n");
+        }
+        else if (inputLine == "refreshCacheTests")
+        {
+            // Tested on the HalfKP net in use (loaded with EvalFile), or the default one. Loading the default
+            // while another architecture is in use doesn't change the network of the search.
+            if (Evaluation::getArchitecture() != NNUEFile::HALFKP && not NNUE::initNNUEParameters())
+                continue;
+            unsigned long long mismatches{runRefreshCacheTest(200000)};
+            std::cout << (mismatches == 0 ? "Refreshes match\n" : "Refreshes differ\n");
+        }
+        else if (inputLine == "accumulatorBench")
+        {
+            // Same as refreshCacheTests
+            if (Evaluation::getArchitecture() != NNUEFile::HALFKP && not NNUE::initNNUEParameters())
+                continue;
+            int64_t checksum{runAccumulatorBench(20000000)};
+            std::cout << "Checksum: " << checksum << "\n";
+        }
         else if (inputLine == "capturesPerftTests")
         {
             int maxDepth;
@@ -725,7 +845,7 @@ int main()
             // Position 1
             std::cout << "Position 1 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_1);
+            Evaluation::initializeNNUEInput(position_1);
             auto start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -739,7 +859,7 @@ int main()
             // Position 2
             std::cout << "Position 2 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_2);
+            Evaluation::initializeNNUEInput(position_2);
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -753,7 +873,7 @@ int main()
             // Position 3
             std::cout << "Position 3 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_3);
+            Evaluation::initializeNNUEInput(position_3);
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -767,7 +887,7 @@ int main()
             // Position 4
             std::cout << "Position 4 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_4);
+            Evaluation::initializeNNUEInput(position_4);
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -780,7 +900,7 @@ int main()
             // Position 5
             std::cout << "Position 5 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_5);
+            Evaluation::initializeNNUEInput(position_5);
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -795,7 +915,7 @@ int main()
             // Position 6
             std::cout << "Position 6 \n";
             // Initialize NNUE input std::vec
-            NNUEU::initializeNNUEInput(position_6);
+            Evaluation::initializeNNUEInput(position_6);
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
@@ -839,106 +959,113 @@ int main()
             std::chrono::duration<double> duration{0};
 
             // Position 1
-            NNUEU::initializeNNUEInput(position_1);
-            globalTT.resize(1 << 20);
+            Evaluation::initializeNNUEInput(position_1);
+            globalTT.resize(8);
             std::cout << "Position 1: \n";
             std::cout << "Best move should be a1a6 \n";
             auto start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
-                STARTTIME = std::chrono::high_resolution_clock::now();
                 position_1 = BitPosition("kbK5/pp6/1P6/8/8/8/8/R7 w - - 0 1"); // This is because we are searching moves from start again
-                std::cout << iterativeSearch(position_1, 1, depth).first.toString() << "\n";
+                Evaluation::initializeNNUEInput(position_1);
+                SearchContext context(position_1, OURTIME, OURINC);
+                std::cout << iterativeSearch(context, 1, depth).first.toString() << "\n";
             }
             auto end = std::chrono::high_resolution_clock::now(); // End timing
             duration += (end - start); // Calculate duration
 
             // Position 2
-            NNUEU::initializeNNUEInput(position_2);
-            globalTT.resize(1 << 20);
+            Evaluation::initializeNNUEInput(position_2);
+            globalTT.resize(8);
             std::cout << "Position 2: \n";
             std::cout << "Best move should be c6c7 \n";
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
-                STARTTIME = std::chrono::high_resolution_clock::now();
                 position_2 = BitPosition("rR6/p7/KnPk4/P7/8/8/8/8 w - - 0 1"); // This is because we are searching moves from start again
-                std::cout << iterativeSearch(position_2, 1, depth).first.toString() << "\n";
+                Evaluation::initializeNNUEInput(position_2);
+                SearchContext context(position_2, OURTIME, OURINC);
+                std::cout << iterativeSearch(context, 1, depth).first.toString() << "\n";
             }
             end = std::chrono::high_resolution_clock::now();    // End timing
             duration += (end - start); // Calculate duration
 
             // Position 3
-            NNUEU::initializeNNUEInput(position_3);
-            globalTT.resize(1 << 20);
+            Evaluation::initializeNNUEInput(position_3);
+            globalTT.resize(8);
             std::cout << "Position 3: \n";
             std::cout << "Best move should be b2b4 \n";
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
-                STARTTIME = std::chrono::high_resolution_clock::now();
                 position_3 = BitPosition("1b1q4/8/P2p4/1N1Pp2p/5P1k/7P/1B1P3K/8 w - - 0 1"); // This is because we are searching moves from start again
-                std::cout << iterativeSearch(position_3, 1, depth).first.toString() << "\n";
+                Evaluation::initializeNNUEInput(position_3);
+                SearchContext context(position_3, OURTIME, OURINC);
+                std::cout << iterativeSearch(context, 1, depth).first.toString() << "\n";
             }
             end = std::chrono::high_resolution_clock::now();    // End timing
             duration += (end - start); // Calculate duration
 
             // Position 4
-            NNUEU::initializeNNUEInput(position_4);
-            globalTT.resize(1 << 20);
+            Evaluation::initializeNNUEInput(position_4);
+            globalTT.resize(8);
             std::cout << "Position 4: \n";
             std::cout << "Best move should be c6b6 \n";
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
-                STARTTIME = std::chrono::high_resolution_clock::now();
                 position_4 = BitPosition("2r2rk1/1b3ppp/p1qpp3/1P6/1Pn1P2b/2NB1P1P/1BP1R1P1/R2Q2K1 b - - 0 19"); // This is because we are searching moves from start again
-                std::cout << iterativeSearch(position_4, 1, depth).first.toString() << "\n";
+                Evaluation::initializeNNUEInput(position_4);
+                SearchContext context(position_4, OURTIME, OURINC);
+                std::cout << iterativeSearch(context, 1, depth).first.toString() << "\n";
             }
             end = std::chrono::high_resolution_clock::now();    // End timing
             duration += (end - start); // Calculate duration
 
             // Position 5
-            NNUEU::initializeNNUEInput(position_5);
-            globalTT.resize(1 << 20);
+            Evaluation::initializeNNUEInput(position_5);
+            globalTT.resize(8);
             std::cout << "Position 5: \n";
             std::cout << "Best move should be f4e5 \n";
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
-                STARTTIME = std::chrono::high_resolution_clock::now();
                 position_5 = BitPosition("rn2kb1r/1bq2pp1/pp3n1p/4p3/2PQ1B1P/2N3P1/PP2PPB1/2KR3R w kq - 0 12"); // This is because we are searching moves from start again
-                std::cout << iterativeSearch(position_5, 1, depth).first.toString() << "\n";
+                Evaluation::initializeNNUEInput(position_5);
+                SearchContext context(position_5, OURTIME, OURINC);
+                std::cout << iterativeSearch(context, 1, depth).first.toString() << "\n";
             }
             end = std::chrono::high_resolution_clock::now();    // End timing
             duration += (end - start); // Calculate duration
 
             // Position 6
-            NNUEU::initializeNNUEInput(position_6);
-            globalTT.resize(1 << 20);
+            Evaluation::initializeNNUEInput(position_6);
+            globalTT.resize(8);
             std::cout << "Position 6: \n";
             std::cout << "Best move should be h8h2 \n";
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
-                STARTTIME = std::chrono::high_resolution_clock::now();
                 position_6 = BitPosition("3k2rr/4b3/p3Qpq1/P2pn3/1p1Nb3/6B1/1PP1B2P/3R1RK1 b - - 0 25"); // This is because we are searching moves from start again
-                std::cout << iterativeSearch(position_6, 1, depth).first.toString() << "\n";
+                Evaluation::initializeNNUEInput(position_6);
+                SearchContext context(position_6, OURTIME, OURINC);
+                std::cout << iterativeSearch(context, 1, depth).first.toString() << "\n";
             }
             end = std::chrono::high_resolution_clock::now();    // End timing
             duration += (end - start); // Calculate duration
 
             // Position 7
-            NNUEU::initializeNNUEInput(position_7);
-            globalTT.resize(1 << 20);
+            Evaluation::initializeNNUEInput(position_7);
+            globalTT.resize(8);
             std::cout << "Position 7: \n";
             std::cout << "Best move should be b2b8 \n";
             start = std::chrono::high_resolution_clock::now(); // Start timing
             for (int8_t depth = 1; depth <= maxDepth; ++depth)
             {
-                STARTTIME = std::chrono::high_resolution_clock::now();
                 position_7 = BitPosition("4k3/Q6n/8/8/8/8/PR5P/4K1NR w K - 0 1"); // This is because we are searching moves from start again
-                std::cout << iterativeSearch(position_7, 1, depth).first.toString() << "\n";
+                Evaluation::initializeNNUEInput(position_7);
+                SearchContext context(position_7, OURTIME, OURINC);
+                std::cout << iterativeSearch(context, 1, depth).first.toString() << "\n";
             }
             end = std::chrono::high_resolution_clock::now();    // End timing
             duration += (end - start); // Calculate duration
@@ -946,40 +1073,129 @@ int main()
             std::cout << "Time taken: " << duration.count() << " seconds\n";
         }
         
+        // Test every SIMD backend against the scalar one and time them
+        else if (inputLine == "simdTests")
+        {
+            int numEvals;
+            std::cout << "Number of random evaluations per backend: \n";
+            while (!(std::cin >> numEvals))
+            {
+                std::cin.clear();                                                   // clear the error flag
+                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); // discard invalid input
+                std::cout << "Invalid input. Please enter a integer: \n";
+            }
+            std::cout << "Selected backend: " << getSimdBackend() << "\n";
+            unsigned long long mismatches{runSimdBackendsTest(numEvals)};
+            mismatches += runNnueuLayersTest<NnueuLayers256>(numEvals);
+            mismatches += runNnueuLayersTest<NnueuLayers512>(numEvals);
+            std::cout << (mismatches == 0 ? "All backends match\n" : "Backends differ\n");
+        }
+        // Latency of the NNUEU forward passes
+        else if (inputLine == "forwardPassBench")
+        {
+            int numEvals;
+            std::cout << "Number of evaluations per backend: \n";
+            while (!(std::cin >> numEvals))
+            {
+                std::cin.clear();                                                   // clear the error flag
+                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); // discard invalid input
+                std::cout << "Invalid input. Please enter a integer: \n";
+            }
+            runForwardPassBench(numEvals);
+        }
+        else if (inputLine == "bench")
+        {
+            int hashMB;
+            int depth;
+            std::cout << "Hash size (MB): \n";
+            while (!(std::cin >> hashMB))
+            {
+                std::cin.clear();                                                   // clear the error flag
+                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); // discard invalid input
+                std::cout << "Invalid input. Please enter a integer: \n";
+            }
+            std::cout << "Depth: \n";
+            while (!(std::cin >> depth))
+            {
+                std::cin.clear();                                                   // clear the error flag
+                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); // discard invalid input
+                std::cout << "Invalid input. Please enter a integer: \n";
+            }
+            int threads;
+            std::cout << "Threads: \n";
+            while (!(std::cin >> threads))
+            {
+                std::cin.clear();                                                   // clear the error flag
+                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); // discard invalid input
+                std::cout << "Invalid input. Please enter a integer: \n";
+            }
+            runSearchBench(hashMB, depth, std::max(1, threads));
+            globalTT.resize(HASHSIZEMB);
+        }
         else if (inputLine == "nNTests")
         {
             // Position at initialization
             BitPosition positionAfter_e2e3{BitPosition("rnbqkbnr/pppppppp/8/8/8/4P3/PPPP1PPP/RNBQKBNR b KQkq - 0 1")};
             NNUEU::initializeNNUEInput(positionAfter_e2e3);
-            std::cout << "Eval our turn: " << NNUEU::evaluationFunction(true) << "\n";
-            std::cout << "Eval not our turn: " << NNUEU::evaluationFunction(false) << "\n";
-            // printArray("White turn Accumulator", NNUEU::inputWhiteTurn, 8);
-            // printArray("Black turn Accumulator", NNUEU::inputBlackTurn, 8);
+            std::cout << "Eval our turn: " << NNUEU::evaluationFunction(positionAfter_e2e3, true) << "\n";
+            std::cout << "Eval not our turn: " << NNUEU::evaluationFunction(positionAfter_e2e3, false) << "\n";
+            // printArray("White turn Accumulator", positionAfter_e2e3.getAccumulator().inputWhiteTurn, 8);
+            // printArray("Black turn Accumulator", positionAfter_e2e3.getAccumulator().inputBlackTurn, 8);
 
             // Position accumulated
             BitPosition position_1{BitPosition("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1")};
             NNUEU::initializeNNUEInput(position_1);
             position_1.makeMove(findNormalMoveFromString("e2e3", position_1));
-            std::cout << "Eval our turn: " << NNUEU::evaluationFunction(true) << "\n";
-            std::cout << "Eval not our turn: " << NNUEU::evaluationFunction(false) << "\n";
-            // printArray("White turn Accumulator", NNUEU::inputWhiteTurn, 8);
-            // printArray("Black turn Accumulator", NNUEU::inputBlackTurn, 8);
+            std::cout << "Eval our turn: " << NNUEU::evaluationFunction(position_1, true) << "\n";
+            std::cout << "Eval not our turn: " << NNUEU::evaluationFunction(position_1, false) << "\n";
+            // printArray("White turn Accumulator", position_1.getAccumulator().inputWhiteTurn, 8);
+            // printArray("Black turn Accumulator", position_1.getAccumulator().inputBlackTurn, 8);
 
             // Position at initialization
             BitPosition position2{BitPosition("7r/3qrpbk/1p1p1np1/p1nP3p/P1P1pP2/1P2B2P/3NBRP1/3Q1R1K b - - 2 24")};
             NNUEU::initializeNNUEInput(position2);
-            std::cout << "Eval our turn: " << NNUEU::evaluationFunction(true) << "\n";
-            std::cout << "Eval not our turn: " << NNUEU::evaluationFunction(false) << "\n";
-            // printArray("White turn Accumulator", NNUEU::inputWhiteTurn, 8);
-            // printArray("Black turn Accumulator", NNUEU::inputBlackTurn, 8);
+            std::cout << "Eval our turn: " << NNUEU::evaluationFunction(position2, true) << "\n";
+            std::cout << "Eval not our turn: " << NNUEU::evaluationFunction(position2, false) << "\n";
+            // printArray("White turn Accumulator", position2.getAccumulator().inputWhiteTurn, 8);
+            // printArray("Black turn Accumulator", position2.getAccumulator().inputBlackTurn, 8);
 
             // Position at initialization
             BitPosition position3{BitPosition("4q2k/4rp2/1p1p2p1/p2P2Pn/P1P5/1P1p1Q2/3N1R2/5RK1 b - - 1 33")};
             NNUEU::initializeNNUEInput(position3);
-            std::cout << "Eval our turn: " << NNUEU::evaluationFunction(true) << "\n";
-            std::cout << "Eval not our turn: " << NNUEU::evaluationFunction(false) << "\n";
-            // printArray("White turn Accumulator", NNUEU::inputWhiteTurn, 8);
-            // printArray("Black turn Accumulator", NNUEU::inputBlackTurn, 8);
+            std::cout << "Eval our turn: " << NNUEU::evaluationFunction(position3, true) << "\n";
+            std::cout << "Eval not our turn: " << NNUEU::evaluationFunction(position3, false) << "\n";
+            // printArray("White turn Accumulator", position3.getAccumulator().inputWhiteTurn, 8);
+            // printArray("Black turn Accumulator", position3.getAccumulator().inputBlackTurn, 8);
+        }
+        // Write a network file (.nnue) from the CSV files of a model directory
+        else if (inputLine == "convertNetwork")
+        {
+            std::string architecture, modelDir, outFileName;
+            std::cout << "Architecture (NNUE or NNUEU): \n";
+            std::getline(std::cin, architecture);
+            std::cout << "Model directory: \n";
+            std::getline(std::cin, modelDir);
+            if (not modelDir.empty() && modelDir.back() != '/')
+                modelDir += '/';
+            std::cout << "Name of the network file: \n";
+            std::getline(std::cin, outFileName);
+
+            bool written{false};
+            if (architecture == "NNUE")
+                written = NNUE::convertNetwork(modelDir, outFileName);
+            else if (architecture == "NNUEU")
+                written = NNUEU::convertNetwork(modelDir, outFileName);
+            else
+                std::cout << "Unknown architecture.\n";
+            // Loading the file back checks it, the search then evaluates with it as after setting EvalFile
+            written = written && Evaluation::loadNetwork(outFileName);
+            if (written)
+            {
+                Evaluation::initializeNNUEInput(position);
+                globalTT.clear();
+                globalEvalCache.clear();
+            }
+            std::cout << (written ? "Network written\n" : "Network not written\n");
         }
         // Generate data for NNUE further training
         else if (inputLine == "generateData")
@@ -1062,7 +1278,7 @@ int main()
                 std::cout << "New initial position \n";
                 nnueTT.resize(1 << 21);
                 BitPosition position{"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"};
-                NNUEU::initializeNNUEInput(position);
+                Evaluation::initializeNNUEInput(position);
                 bool gameEnded{false};
                 while (not gameEnded)
                 {
@@ -0,0 +1,246 @@
+#include "nnue_file.h"
+#include <fstream>
+#include <iostream>
+#include <cstring> // For std::memcpy
+#include <cstdlib> // For std::aligned_alloc
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h> // For mmap
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#if defined(__APPLE__)
+#include <mach-o/dyld.h> // For _NSGetExecutablePath
+#endif
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "Network files are read in place, which needs a little endian CPU");
+
+namespace NNUEFile
+{
+    constexpr size_t SECTION_ALIGNMENT = 64;
+
+    static size_t alignUp(size_t size)
+    {
+        return (size + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+    }
+
+    uint64_t computeChecksum(const uint8_t *data, size_t size)
+    {
+        uint64_t hash{0xcbf29ce484222325ULL};
+        for (size_t i = 0; i + 8 <= size; i += 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, data + i, 8);
+            hash = (hash ^ word) * 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    bool writeNetwork(const std::string &path, const Header &layers, const std::vector<SectionData> &sections)
+    {
+        Header header{layers};
+        header.magic = MAGIC;
+        header.version = VERSION;
+        header.hiddenShift = HIDDEN_SHIFT;
+        header.numSections = static_cast<uint32_t>(sections.size());
+        header.reserved = 0;
+
+        // Place the sections after the table, aligned so that the engine can read them in place with aligned loads
+        std::vector<Section> table(sections.size());
+        size_t offset{alignUp(sizeof(Header) + sections.size() * sizeof(Section))};
+        for (size_t i = 0; i < sections.size(); ++i)
+        {
+            table[i] = Section{offset, sections[i].size};
+            offset = alignUp(offset + sections[i].size);
+        }
+        header.fileSize = offset;
+
+        std::vector<uint8_t> file(offset, 0);
+        std::memcpy(file.data() + sizeof(Header), table.data(), table.size() * sizeof(Section));
+        for (size_t i = 0; i < sections.size(); ++i)
+            std::memcpy(file.data() + table[i].offset, sections[i].data, sections[i].size);
+        header.checksum = computeChecksum(file.data() + sizeof(Header), file.size() - sizeof(Header));
+        std::memcpy(file.data(), &header, sizeof(Header));
+
+        std::ofstream out(path, std::ios::binary);
+        out.write(reinterpret_cast<const char *>(file.data()), static_cast<std::streamsize>(file.size()));
+        if (!out)
+        {
+            std::cerr << "Failed to write network file: " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool readHeader(const std::string &path, Header &header)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.read(reinterpret_cast<char *>(&header), sizeof(Header)))
+        {
+            std::cerr << "Failed to open network file: " << path << std::endl;
+            return false;
+        }
+        if (header.magic != MAGIC)
+        {
+            std::cerr << "Invalid network " << path << ": not a network file" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    static std::string executableDirectory()
+    {
+        std::string path;
+#if defined(__linux__)
+        char buffer[4096];
+        ssize_t length{readlink("/proc/self/exe", buffer, sizeof(buffer) - 1)};
+        if (length > 0)
+            path.assign(buffer, static_cast<size_t>(length));
+#elif defined(__APPLE__)
+        char buffer[4096];
+        uint32_t length{sizeof(buffer)};
+        if (_NSGetExecutablePath(buffer, &length) == 0)
+            path = buffer;
+#endif
+        size_t slash{path.find_last_of('/')};
+        return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+    }
+
+    std::string findModel(const std::string &fileName)
+    {
+        const std::string relativePath{"models/" + fileName};
+        if (std::ifstream(relativePath).good())
+            return relativePath;
+
+        const std::string executablePath{executableDirectory() + relativePath};
+        if (std::ifstream(executablePath).good())
+            return executablePath;
+
+        return relativePath;
+    }
+
+    Network &Network::operator=(Network &&other) noexcept
+    {
+        if (this != &other)
+        {
+            close();
+            m_data = other.m_data;
+            m_size = other.m_size;
+            m_storage = other.m_storage;
+            other.m_data = nullptr;
+            other.m_size = 0;
+        }
+        return *this;
+    }
+
+    void Network::close()
+    {
+        if (m_data == nullptr)
+            return;
+#if defined(__unix__) || defined(__APPLE__)
+        if (m_storage == MAPPED)
+            munmap(const_cast<uint8_t *>(m_data), m_size);
+#endif
+        if (m_storage == ALLOCATED)
+            std::free(const_cast<uint8_t *>(m_data));
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    bool Network::open(const std::string &path, const Header &expectedLayers, const std::vector<size_t> &sectionSizes)
+    {
+        close();
+#if defined(__unix__) || defined(__APPLE__)
+        // Shared read only mapping, the pages are the page cache's and are shared by every process using the file
+        int fd{::open(path.c_str(), O_RDONLY)};
+        struct stat fileStat;
+        if (fd < 0 || fstat(fd, &fileStat) != 0 || fileStat.st_size < static_cast<off_t>(sizeof(Header)))
+        {
+            if (fd >= 0)
+                ::close(fd);
+            std::cerr << "Failed to open network file: " << path << std::endl;
+            return false;
+        }
+        m_size = static_cast<size_t>(fileStat.st_size);
+        void *mapping{mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0)};
+        ::close(fd);
+        if (mapping == MAP_FAILED)
+        {
+            std::cerr << "Failed to map network file: " << path << std::endl;
+            m_size = 0;
+            return false;
+        }
+        m_data = static_cast<const uint8_t *>(mapping);
+        m_storage = MAPPED;
+#else
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file || file.tellg() < static_cast<std::streamoff>(sizeof(Header)))
+        {
+            std::cerr << "Failed to open network file: " << path << std::endl;
+            return false;
+        }
+        m_size = static_cast<size_t>(file.tellg());
+        uint8_t *buffer{static_cast<uint8_t *>(std::aligned_alloc(SECTION_ALIGNMENT, alignUp(m_size)))};
+        file.seekg(0);
+        file.read(reinterpret_cast<char *>(buffer), static_cast<std::streamsize>(m_size));
+        m_data = buffer;
+        m_storage = ALLOCATED;
+#endif
+        return validate(path, expectedLayers, sectionSizes);
+    }
+
+    bool Network::open(const uint8_t *data, size_t size, const std::string &name, const Header &expectedLayers,
+                       const std::vector<size_t> &sectionSizes)
+    {
+        close();
+        if (size < sizeof(Header))
+        {
+            std::cerr << "Invalid network " << name << ": truncated file" << std::endl;
+            return false;
+        }
+        m_data = data;
+        m_size = size;
+        m_storage = EMBEDDED;
+        return validate(name, expectedLayers, sectionSizes);
+    }
+
+    bool Network::validate(const std::string &name, const Header &expectedLayers, const std::vector<size_t> &sectionSizes)
+    {
+        const Header &header{getHeader()};
+        const char *error{nullptr};
+        if (header.magic != MAGIC)
+            error = "not a network file";
+        else if (header.version != VERSION)
+            error = "unsupported version";
+        else if (header.fileSize != m_size)
+            error = "truncated file";
+        else if (header.architecture != expectedLayers.architecture)
+            error = "wrong architecture";
+        else if (header.numFeatures != expectedLayers.numFeatures || header.accumulatorSize != expectedLayers.accumulatorSize ||
+                 header.hiddenSize1 != expectedLayers.hiddenSize1 || header.hiddenSize2 != expectedLayers.hiddenSize2 ||
+                 header.outputSize != expectedLayers.outputSize)
+            error = "wrong layer sizes";
+        else if (header.hiddenShift != HIDDEN_SHIFT)
+            error = "unsupported quantization";
+        else if (header.numSections != sectionSizes.size() || sizeof(Header) + header.numSections * sizeof(Section) > m_size)
+            error = "wrong number of sections";
+        else if (computeChecksum(m_data + sizeof(Header), m_size - sizeof(Header)) != header.checksum)
+            error = "checksum mismatch";
+        else
+        {
+            const Section *table{reinterpret_cast<const Section *>(m_data + sizeof(Header))};
+            for (size_t i = 0; i < sectionSizes.size() && error == nullptr; ++i)
+                if (table[i].size != sectionSizes[i] || table[i].offset % SECTION_ALIGNMENT != 0 ||
+                    table[i].offset + table[i].size > m_size)
+                    error = "wrong section sizes";
+        }
+
+        if (error != nullptr)
+        {
+            std::cerr << "Invalid network " << name << ": " << error << std::endl;
+            close();
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,128 @@
+#ifndef NNUE_FILE_H
+#define NNUE_FILE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <utility> // For std::move
+
+// Binary network files (.nnue). The file is mapped read only and the evaluation reads the weights where they lie,
+// so loading costs a checksum pass instead of parsing text, and every engine process on a host shares the same
+// physical pages through the page cache.
+//
+// Layout, little endian:
+//
+// header                                                           64 bytes
+// section table: (offset, size) in bytes for each section          16 bytes per section
+// sections, each starting at a multiple of 64 bytes                (padded with zeros)
+//
+// The sections are the weights and biases of each layer, in the order and shapes given by the architecture (see
+// NNUE::initNNUEParameters and NNUEU::initNNUEParameters), laid out as the engine's arrays. The checksum covers
+// everything after the header. Files are written from the CSV model directories by the convertNetwork command.
+
+namespace NNUEFile
+{
+    constexpr uint32_t MAGIC = 0x4E4E4854; // "THNN"
+    constexpr uint32_t VERSION = 1;
+
+    // Right shift applied after the hidden layers by the forward passes in simd.cpp. Networks quantized with another
+    // shift can't be evaluated by this build, so they are rejected when loading.
+    constexpr uint32_t HIDDEN_SHIFT = 6;
+
+    enum Architecture : uint32_t
+    {
+        HALFKP = 1, // NNUE: king-piece-square features, 40960 per perspective
+        NNUEU = 2   // NNUEU: piece-square features, second layer chosen by the kings' squares
+    };
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t architecture;
+        uint32_t numFeatures;     // First layer inputs
+        uint32_t accumulatorSize; // First layer outputs for each perspective
+        uint32_t hiddenSize1;     // Second layer outputs
+        uint32_t hiddenSize2;     // Third layer outputs
+        uint32_t outputSize;
+        uint32_t hiddenShift;
+        uint32_t numSections;
+        uint64_t fileSize;
+        uint64_t checksum;
+        uint64_t reserved;
+    };
+    static_assert(sizeof(Header) == 64, "The .nnue header must take 64 bytes");
+
+    struct Section
+    {
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    // A section to write: its bytes in memory
+    struct SectionData
+    {
+        const void *data;
+        size_t size;
+    };
+
+    // FNV-1a over 64 bit words, every section is padded to a multiple of 8 bytes
+    uint64_t computeChecksum(const uint8_t *data, size_t size);
+
+    // Writes a network file. Only the architecture and layer sizes of the header are read, the rest is filled in.
+    bool writeNetwork(const std::string &path, const Header &layers, const std::vector<SectionData> &sections);
+
+    // Reads the header of a network file, to tell its architecture before loading it. Prints the reason to std::cerr
+    // and returns false if the file can't be read or is not a network file.
+    bool readHeader(const std::string &path, Header &header);
+
+    // Finds a file of the models directory, next to the working directory or next to the executable
+    std::string findModel(const std::string &fileName);
+
+    // A network file mapped in memory. Moving keeps the mapping alive, the pointers into it stay valid.
+    class Network
+    {
+    public:
+        Network() = default;
+        ~Network() { close(); }
+        Network(const Network &) = delete;
+        Network &operator=(const Network &) = delete;
+        Network(Network &&other) noexcept { *this = std::move(other); }
+        Network &operator=(Network &&other) noexcept;
+
+        // Maps the file and checks it is a valid network of the given architecture, layer sizes and section sizes.
+        // Prints the reason to std::cerr and returns false otherwise.
+        bool open(const std::string &path, const Header &expectedLayers, const std::vector<size_t> &sectionSizes);
+        // Same for a network already in memory, such as the one embedded in the executable (not copied nor freed)
+        bool open(const uint8_t *data, size_t size, const std::string &name, const Header &expectedLayers,
+                  const std::vector<size_t> &sectionSizes);
+        void close();
+
+        const Header &getHeader() const { return *reinterpret_cast<const Header *>(m_data); }
+
+        // Start of a section, of the type the engine reads it as
+        template <typename T>
+        const T *getSection(int index) const
+        {
+            const Section *table{reinterpret_cast<const Section *>(m_data + sizeof(Header))};
+            return reinterpret_cast<const T *>(m_data + table[index].offset);
+        }
+
+    private:
+        enum Storage
+        {
+            MAPPED,    // Mapped from a file
+            ALLOCATED, // Read from a file into an aligned buffer, where mmap isn't available
+            EMBEDDED   // Owned by someone else
+        };
+
+        bool validate(const std::string &name, const Header &expectedLayers, const std::vector<size_t> &sectionSizes);
+
+        const uint8_t *m_data{nullptr};
+        size_t m_size{0};
+        Storage m_storage{EMBEDDED};
+    };
+}
+
+#endif
@@ -5,6 +5,10 @@
 #include <fstream>
 #include <vector>
 #include <cstring> // For std::memset
+#include <cstdint>
+#include <cstdlib> // For std::aligned_alloc
+#include <atomic>
+#include <algorithm> // For std::max
 
 // The NNUE transposition table will store the zobrist keys of seen positions and the NNUE value.
 //
@@ -84,4 +88,65 @@ private:
     TTNNUEEntry *table; // Dynamic array of TTEntry
 };
 
+// The evaluation cache stores the network evaluation of positions evaluated by the search, so that positions
+// reached again through transpositions (frequent in quiescence search) skip the forward pass. Each entry is
+// packed into a 64 bit word:
+//
+// key (upper 32 bits of the zobrist key)                           32 bit
+// evaluation, for the side to move                                 16 bit
+// occupied                                                         16 bit
+//
+// The lower bits of the zobrist key choose the entry, so the 32 bit key only has to tell apart the positions
+// that fall in the same entry. As in the transposition table, entries are read and written as single 64 bit
+// atomic words, so threads share the cache without locks and a probe never mixes the key of one position
+// with the evaluation of another. A new evaluation always replaces the entry.
+
+class EvalCache
+{
+public:
+    EvalCache() : entryCount(0), table(nullptr) {}
+    ~EvalCache() { std::free(table); }
+
+    // Initializes or resizes the cache to at most a number of megabytes, rounded down to a power of two entries
+    void resize(size_t megaBytes)
+    {
+        std::free(table);
+        entryCount = 1;
+        while (entryCount * 2 * sizeof(uint64_t) <= megaBytes * 1024 * 1024)
+            entryCount *= 2;
+        table = static_cast<std::atomic<uint64_t> *>(std::aligned_alloc(64, std::max<size_t>(entryCount * sizeof(uint64_t), 64)));
+        if (table == nullptr)
+        {
+            std::cerr << "Failed to allocate " << megaBytes << "MB for the evaluation cache\n";
+            std::exit(EXIT_FAILURE);
+        }
+        clear();
+    }
+
+    // Empties the cache, needed when another network is loaded
+    void clear() { std::memset(static_cast<void *>(table), 0, entryCount * sizeof(uint64_t)); }
+
+    // Probes the cache for a given key. If found, copies the evaluation into value and returns true.
+    bool probe(uint64_t z_key, int16_t &value) const
+    {
+        uint64_t data = table[z_key & (entryCount - 1)].load(std::memory_order_relaxed);
+        if ((data >> 32) != (z_key >> 32) || (data & OCCUPIED_FLAG) == 0)
+            return false;
+        value = static_cast<int16_t>(data >> 16);
+        return true;
+    }
+
+    void save(uint64_t z_key, int16_t value)
+    {
+        uint64_t data = (z_key & 0xFFFFFFFF00000000ULL) | (static_cast<uint64_t>(static_cast<uint16_t>(value)) << 16) | OCCUPIED_FLAG;
+        table[z_key & (entryCount - 1)].store(data, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr uint64_t OCCUPIED_FLAG = 1;
+
+    size_t entryCount;            // A power of two, so the entry index is a mask of the key
+    std::atomic<uint64_t> *table; // Dynamic array of entries
+};
+
 #endif // NNUE_TTABLE_H
\ No newline at end of file
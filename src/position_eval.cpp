@@ -1,10 +1,15 @@
 #include "position_eval.h"
 #include <fstream>
 #include <sstream>
+#include <cstring> // For std::memcpy
+#include <cstdlib> // For std::aligned_alloc
+#include <memory>
+#include <type_traits>
 #include "bitposition.h"
 #include "bit_utils.h" // Bit utility functions
 #include "precomputed_moves.h"
 #include "simd.h"
+#include "nnue_file.h"
 
 // Function to load a 2D int8_t array from a file
 void load_int16_2D_array(const std::string &file_path, int16_t weights[40960][8])
@@ -28,34 +33,6 @@ void load_int16_2D_array(const std::string &file_path, int16_t weights[40960][8]
     }
 }
 
-void load_inverted_int16_2D_array(const std::string &file_path, int16_t weights[40960][8])
-{
-    std::ifstream file(file_path);
-    std::string line;
-    size_t row = 0;
-
-    while (std::getline(file, line) && row < 8)
-    {
-        std::stringstream ss(line);
-        std::string value;
-        size_t col = 0;
-
-        while (std::getline(ss, value, ',') && col < 40960)
-        {
-            int kingPos = col / 640;
-            int pieceType = (col % 640) / 64;
-            int square = col % 64;
-
-            // Compute the new index after inverting
-            int newPieceType = (pieceType + 5) % 10;
-            int newCol = invertIndex(kingPos) * 640 + newPieceType * 64 + invertIndex(square);
-            weights[newCol][row] = static_cast<int16_t>(std::stoi(value));
-            col++;
-        }
-        row++;
-    }
-}
-
 int8_t *load_int8_1D_array(const std::string &file_path, size_t cols)
 {
     int8_t *arr = new int8_t[cols](); // Zero-initialize the array
@@ -138,7 +115,6 @@ void print_2D_array(const int8_t arr[40960][8], size_t rows, size_t cols)
         std::cout << std::endl;
     }
 }
-extern bool ENGINEISWHITE;
 
 namespace NNUE
 {
@@ -146,125 +122,152 @@ namespace NNUE
     // NNUE Evaluation
     ///////////////////////////
 
-    int16_t whiteInputTurn[8] = {0};
-    int16_t blackInputTurn[8] = {0};
-    int16_t whiteInputNotTurn[8] = {0};
-    int16_t blackInputNotTurn[8] = {0};
+    // The parameters point into the mapped network file
+    NNUEFile::Network network;
+    uint32_t networkGeneration{0}; // Number of networks loaded
+
+    const int16_t (*firstLayer1Weights)[8]{nullptr};
+    const int16_t (*firstLayer2Weights)[8]{nullptr};
 
-    int16_t firstLayer1Weights[40960][8] = {0};
-    int16_t firstLayer2Weights[40960][8] = {0};
-    int16_t firstLayer1InvertedWeights[40960][8] = {0};
-    int16_t firstLayer2InvertedWeights[40960][8] = {0};
+    const int8_t *secondLayerWeights{nullptr};
+    const int8_t *thirdLayerWeights{nullptr};
+    const int8_t *finalLayerWeights{nullptr};
 
-    int8_t secondLayerWeights[16 * 8] = {0};
-    int8_t thirdLayerWeights[8 * 4] = {0};
-    int8_t finalLayerWeights[4] = {0};
+    const int16_t *firstLayer1Biases{nullptr};
+    const int16_t *firstLayer2Biases{nullptr};
+    const int16_t *secondLayerBiases{nullptr};
+    const int16_t *thirdLayerBiases{nullptr};
+    const int16_t *finalLayerBias{nullptr};
 
-    int16_t firstLayer1Biases[8] = {0};
-    int16_t firstLayer2Biases[8] = {0};
-    int16_t secondLayerBiases[8] = {0};
-    int16_t thirdLayerBiases[4] = {0};
-    int16_t finalLayerBias = 0;
+    // Accumulator size and bytes of each HalfKP accumulator
+    constexpr int ACCUMULATOR_SIZE = 8;
+    constexpr size_t INPUT_BYTES = sizeof(int16_t) * ACCUMULATOR_SIZE;
 
-    void initNNUEParameters()
+    const std::string DEFAULT_NETWORK{"small_quantized_model_v1_param_350_epoch_8.nnue"};
+
+    NNUEFile::Header networkLayers()
     {
-        const std::string modelDir = "models/small_quantized_model_v1_param_350_epoch_8/";
+        NNUEFile::Header layers{};
+        layers.architecture = NNUEFile::HALFKP;
+        layers.numFeatures = 40960;
+        layers.accumulatorSize = 8;
+        layers.hiddenSize1 = 8;
+        layers.hiddenSize2 = 4;
+        layers.outputSize = 1;
+        return layers;
+    }
 
-        // Load weights into fixed-size arrays
-        load_int16_2D_array(modelDir + "first_linear1_weights.csv", firstLayer1Weights);
-        load_int16_2D_array(modelDir + "first_linear2_weights.csv", firstLayer2Weights);
+    // Sections of the network file, in order
+    const std::vector<size_t> SECTION_SIZES{
+        sizeof(int16_t) * 40960 * 8, // First layer 1 weights
+        sizeof(int16_t) * 40960 * 8, // First layer 2 weights
+        sizeof(int16_t) * 8,         // First layer 1 biases
+        sizeof(int16_t) * 8,         // First layer 2 biases
+        sizeof(int8_t) * 16 * 8,     // Second layer weights
+        sizeof(int16_t) * 8,         // Second layer biases
+        sizeof(int8_t) * 8 * 4,      // Third layer weights
+        sizeof(int16_t) * 4,         // Third layer biases
+        sizeof(int8_t) * 4,          // Final layer weights
+        sizeof(int16_t)};            // Final layer bias
+
+    bool initNNUEParameters()
+    {
+        return initNNUEParameters(NNUEFile::findModel(DEFAULT_NETWORK));
+    }
+
+    bool initNNUEParameters(const std::string &path)
+    {
+        // Choose the forward pass for this CPU
+        selectSimdBackend();
+
+        // The current network stays loaded if the new one is not valid
+        NNUEFile::Network newNetwork;
+        if (not newNetwork.open(path, networkLayers(), SECTION_SIZES))
+            return false;
+        network = std::move(newNetwork);
+
+        firstLayer1Weights = network.getSection<int16_t[8]>(0);
+        firstLayer2Weights = network.getSection<int16_t[8]>(1);
+        firstLayer1Biases = network.getSection<int16_t>(2);
+        firstLayer2Biases = network.getSection<int16_t>(3);
+        secondLayerWeights = network.getSection<int8_t>(4);
+        secondLayerBiases = network.getSection<int16_t>(5);
+        thirdLayerWeights = network.getSection<int8_t>(6);
+        thirdLayerBiases = network.getSection<int16_t>(7);
+        finalLayerWeights = network.getSection<int8_t>(8);
+        finalLayerBias = network.getSection<int16_t>(9);
+
+        // The refresh caches hold accumulators of the previous network
+        networkGeneration++;
+        return true;
+    }
 
-        // Load inverted weights into fixed-size arrays
-        load_inverted_int16_2D_array(modelDir + "first_linear1_weights.csv", firstLayer1InvertedWeights);
-        load_inverted_int16_2D_array(modelDir + "first_linear2_weights.csv", firstLayer2InvertedWeights);
+    bool convertNetwork(const std::string &modelDir, const std::string &path)
+    // Reads the parameters from the CSV files of a model directory and writes them as a network file
+    {
+        std::vector<int16_t> tempFirstLayer1Weights(40960 * 8);
+        std::vector<int16_t> tempFirstLayer2Weights(40960 * 8);
+        load_int16_2D_array(modelDir + "first_linear1_weights.csv", reinterpret_cast<int16_t(*)[8]>(tempFirstLayer1Weights.data()));
+        load_int16_2D_array(modelDir + "first_linear2_weights.csv", reinterpret_cast<int16_t(*)[8]>(tempFirstLayer2Weights.data()));
 
         auto tempSecondLayerWeights = load_int8_1D_array(modelDir + "second_layer_weights.csv", 16 * 8);
-        std::memcpy(secondLayerWeights, tempSecondLayerWeights, sizeof(int8_t) * 16 * 8);
-        delete[] tempSecondLayerWeights;
-
         auto tempThirdLayerWeights = load_int8_1D_array(modelDir + "third_layer_weights.csv", 8 * 4);
-        std::memcpy(thirdLayerWeights, tempThirdLayerWeights, sizeof(int8_t) * 8 * 4);
-        delete[] tempThirdLayerWeights;
-
         auto tempFinalLayerWeights = load_int8_1D_array(modelDir + "final_layer_weights.csv", 4);
-        std::memcpy(finalLayerWeights, tempFinalLayerWeights, sizeof(int8_t) * 4);
-        delete[] tempFinalLayerWeights;
+        if (tempSecondLayerWeights == nullptr || tempThirdLayerWeights == nullptr || tempFinalLayerWeights == nullptr)
+        {
+            delete[] tempSecondLayerWeights;
+            delete[] tempThirdLayerWeights;
+            delete[] tempFinalLayerWeights;
+            return false;
+        }
 
-        // Load biases
         auto tempFirstLayer1Biases = load_int16_array(modelDir + "first_linear1_biases.csv", 8);
-        std::memcpy(firstLayer1Biases, tempFirstLayer1Biases, sizeof(int16_t) * 8);
-        delete[] tempFirstLayer1Biases;
-
         auto tempFirstLayer2Biases = load_int16_array(modelDir + "first_linear2_biases.csv", 8);
-        std::memcpy(firstLayer2Biases, tempFirstLayer2Biases, sizeof(int16_t) * 8);
-        delete[] tempFirstLayer2Biases;
-
         auto tempSecondLayerBiases = load_int16_array(modelDir + "second_layer_biases.csv", 8);
-        std::memcpy(secondLayerBiases, tempSecondLayerBiases, sizeof(int16_t) * 8);
-        delete[] tempSecondLayerBiases;
-
         auto tempThirdLayerBiases = load_int16_array(modelDir + "third_layer_biases.csv", 4);
-        std::memcpy(thirdLayerBiases, tempThirdLayerBiases, sizeof(int16_t) * 4);
-        delete[] tempThirdLayerBiases;
-
-        finalLayerBias = load_int16(modelDir + "final_layer_biases.csv");
-
-        // Print loaded weights and biases
-        // std::cout << "First Layer 1 Weights:" << std::endl;
-        // print_2D_array(firstLayer1Weights, 40960, 8);
-
-        // std::cout << "First Layer 2 Weights:" << std::endl;
-        // print_2D_array(firstLayer2Weights, 40960, 8);
-
-        // std::cout << "First Layer 1 Inverted Weights:" << std::endl;
-        // print_2D_array(firstLayer1InvertedWeights, 40960, 8);
-
-        // std::cout << "First Layer 2 Inverted Weights:" << std::endl;
-        // print_2D_array(firstLayer2InvertedWeights, 40960, 8);
-
-        // std::cout << "Second Layer Weights:" << std::endl;
-        // print_array(secondLayerWeights);
-
-        // std::cout << "Third Layer Weights:" << std::endl;
-        // print_array(thirdLayerWeights);
-
-        // std::cout << "Final Layer Weights:" << std::endl;
-        // print_array(finalLayerWeights);
-
-        // std::cout << "First Layer 1 Biases:" << std::endl;
-        // print_array(firstLayer1Biases);
-
-        // std::cout << "First Layer 2 Biases:" << std::endl;
-        // print_array(firstLayer2Biases);
-
-        // std::cout << "Second Layer Biases:" << std::endl;
-        // print_array(secondLayerBiases);
+        int16_t tempFinalLayerBias = load_int16(modelDir + "final_layer_biases.csv");
+
+        bool written{NNUEFile::writeNetwork(path, networkLayers(),
+                                            {{tempFirstLayer1Weights.data(), SECTION_SIZES[0]},
+                                             {tempFirstLayer2Weights.data(), SECTION_SIZES[1]},
+                                             {tempFirstLayer1Biases, SECTION_SIZES[2]},
+                                             {tempFirstLayer2Biases, SECTION_SIZES[3]},
+                                             {tempSecondLayerWeights, SECTION_SIZES[4]},
+                                             {tempSecondLayerBiases, SECTION_SIZES[5]},
+                                             {tempThirdLayerWeights, SECTION_SIZES[6]},
+                                             {tempThirdLayerBiases, SECTION_SIZES[7]},
+                                             {tempFinalLayerWeights, SECTION_SIZES[8]},
+                                             {&tempFinalLayerBias, SECTION_SIZES[9]}})};
 
-        // std::cout << "Third Layer Biases:" << std::endl;
-        // print_array(thirdLayerBiases);
-
-        // std::cout << "Final Layer Bias:" << std::endl;
-        // std::cout << finalLayerBias << std::endl;
+        delete[] tempSecondLayerWeights;
+        delete[] tempThirdLayerWeights;
+        delete[] tempFinalLayerWeights;
+        delete[] tempFirstLayer1Biases;
+        delete[] tempFirstLayer2Biases;
+        delete[] tempSecondLayerBiases;
+        delete[] tempThirdLayerBiases;
+        return written;
     }
 
-    int16_t evaluationFunction(bool ourTurn)
+    int16_t evaluationFunction(BitPosition &position, bool ourTurn)
     // The engine is built to get an evaluation of the position with high values being good for the engine.
     // The NNUE is built to give an evaluation of the position with high values being good for whose turn it is.
     // This function gives an evaluation with high values being good for engine.
     {
         int16_t out;
+        updateAccumulator(position);
+        const Accumulator &accumulator{position.getAccumulator()};
 
-        // If its our turn in white, or if its not our turn in black then it is white's turn
-        // So the white vector goes first.
-        if (ourTurn == ENGINEISWHITE)
+        // The side to move's vector goes first, so the engine's colour is not needed
+        if (position.getTurn())
         {
-            out = fullNnuePass(whiteInputTurn, blackInputNotTurn, secondLayerWeights, secondLayerBiases, 
-                            thirdLayerWeights, thirdLayerBiases, finalLayerWeights, &finalLayerBias);
+            out = fullNnuePass(accumulator.inputWhiteTurn, accumulator.inputBlackNotTurn, secondLayerWeights, secondLayerBiases,
+                               thirdLayerWeights, thirdLayerBiases, finalLayerWeights, finalLayerBias);
         }
         else
         {
-            out = fullNnuePass(blackInputTurn, whiteInputNotTurn, secondLayerWeights, secondLayerBiases,
-                                 thirdLayerWeights, thirdLayerBiases, finalLayerWeights, &finalLayerBias);
+            out = fullNnuePass(accumulator.inputBlackTurn, accumulator.inputWhiteNotTurn, secondLayerWeights, secondLayerBiases,
+                               thirdLayerWeights, thirdLayerBiases, finalLayerWeights, finalLayerBias);
         }
         // Change evaluation from player to move perspective to white perspective
         if (ourTurn)
@@ -273,238 +276,261 @@ namespace NNUE
         return 64 * 64 - out;
     }
 
-    void initializeNNUEInput(const BitPosition position)
+    void initializeNNUEInput(BitPosition &position)
     // Initialize the NNUE accumulators.
     {
-        int whiteOffset = position.getWhiteKingPosition() * 64 * 10;
-        int blackOffset = position.getBlackKingPosition() * 64 * 10;
-
-        std::memcpy(whiteInputTurn, firstLayer1Biases, sizeof(firstLayer1Biases));
-        std::memcpy(whiteInputNotTurn, firstLayer2Biases, sizeof(firstLayer2Biases));
-        std::memcpy(blackInputTurn, firstLayer1Biases, sizeof(firstLayer1Biases));
-        std::memcpy(blackInputNotTurn, firstLayer2Biases, sizeof(firstLayer2Biases));
+        position.setAccumulatorSize(ACCUMULATOR_SIZE);
+        Accumulator &accumulator{position.getAccumulator()};
+        int16_t *whiteInputTurn{accumulator.inputWhiteTurn};
+        int16_t *blackInputTurn{accumulator.inputBlackTurn};
+        int16_t *whiteInputNotTurn{accumulator.inputWhiteNotTurn};
+        int16_t *blackInputNotTurn{accumulator.inputBlackNotTurn};
+        int whiteKingSquare = position.getWhiteKingPosition();
+        int blackKingSquare = position.getBlackKingPosition();
+        int whiteOffset = whiteKingSquare * 64 * 10;
+        int blackOffset = blackKingSquare * 64 * 10;
+
+        std::memcpy(whiteInputTurn, firstLayer1Biases, INPUT_BYTES);
+        std::memcpy(whiteInputNotTurn, firstLayer2Biases, sizeof(accumulator.inputWhiteNotTurn));
+        std::memcpy(blackInputTurn, firstLayer1Biases, INPUT_BYTES);
+        std::memcpy(blackInputNotTurn, firstLayer2Biases, sizeof(accumulator.inputBlackNotTurn));
 
         for (unsigned short index : getBitIndices(position.getWhitePawnsBits()))
         {
             add_8_int16(whiteInputTurn, firstLayer1Weights[whiteOffset + index]);
-            add_8_int16(whiteInputNotTurn, firstLayer2InvertedWeights[whiteOffset + index]);
-            add_8_int16(blackInputTurn, firstLayer1InvertedWeights[blackOffset + index]);
+            add_8_int16(whiteInputNotTurn, firstLayer2Weights[mirrorHalfKPFeature(whiteKingSquare, index)]);
+            add_8_int16(blackInputTurn, firstLayer1Weights[mirrorHalfKPFeature(blackKingSquare, index)]);
             add_8_int16(blackInputNotTurn, firstLayer2Weights[blackOffset + index]);
         }
 
         for (unsigned short index : getBitIndices(position.getWhiteKnightsBits()))
         {
             add_8_int16(whiteInputTurn, firstLayer1Weights[whiteOffset + 64 + index]);
-            add_8_int16(whiteInputNotTurn, firstLayer2InvertedWeights[whiteOffset + 64 + index]);
-            add_8_int16(blackInputTurn, firstLayer1InvertedWeights[blackOffset + 64 + index]);
+            add_8_int16(whiteInputNotTurn, firstLayer2Weights[mirrorHalfKPFeature(whiteKingSquare, 64 + index)]);
+            add_8_int16(blackInputTurn, firstLayer1Weights[mirrorHalfKPFeature(blackKingSquare, 64 + index)]);
             add_8_int16(blackInputNotTurn, firstLayer2Weights[blackOffset + 64 + index]);
         }
 
         for (unsigned short index : getBitIndices(position.getWhiteBishopsBits()))
         {
             add_8_int16(whiteInputTurn, firstLayer1Weights[whiteOffset + 64 * 2 + index]);
-            add_8_int16(whiteInputNotTurn, firstLayer2InvertedWeights[whiteOffset + 64 * 2 + index]);
-            add_8_int16(blackInputTurn, firstLayer1InvertedWeights[blackOffset + 64 * 2 + index]);
+            add_8_int16(whiteInputNotTurn, firstLayer2Weights[mirrorHalfKPFeature(whiteKingSquare, 64 * 2 + index)]);
+            add_8_int16(blackInputTurn, firstLayer1Weights[mirrorHalfKPFeature(blackKingSquare, 64 * 2 + index)]);
             add_8_int16(blackInputNotTurn, firstLayer2Weights[blackOffset + 64 * 2 + index]);
         }
 
         for (unsigned short index : getBitIndices(position.getWhiteRooksBits()))
         {
             add_8_int16(whiteInputTurn, firstLayer1Weights[whiteOffset + 64 * 3 + index]);
-            add_8_int16(whiteInputNotTurn, firstLayer2InvertedWeights[whiteOffset + 64 * 3 + index]);
-            add_8_int16(blackInputTurn, firstLayer1InvertedWeights[blackOffset + 64 * 3 + index]);
+            add_8_int16(whiteInputNotTurn, firstLayer2Weights[mirrorHalfKPFeature(whiteKingSquare, 64 * 3 + index)]);
+            add_8_int16(blackInputTurn, firstLayer1Weights[mirrorHalfKPFeature(blackKingSquare, 64 * 3 + index)]);
             add_8_int16(blackInputNotTurn, firstLayer2Weights[blackOffset + 64 * 3 + index]);
         }
 
         for (unsigned short index : getBitIndices(position.getWhiteQueensBits()))
         {
             add_8_int16(whiteInputTurn, firstLayer1Weights[whiteOffset + 64 * 4 + index]);
-            add_8_int16(whiteInputNotTurn, firstLayer2InvertedWeights[whiteOffset + 64 * 4 + index]);
-            add_8_int16(blackInputTurn, firstLayer1InvertedWeights[blackOffset + 64 * 4 + index]);
+            add_8_int16(whiteInputNotTurn, firstLayer2Weights[mirrorHalfKPFeature(whiteKingSquare, 64 * 4 + index)]);
+            add_8_int16(blackInputTurn, firstLayer1Weights[mirrorHalfKPFeature(blackKingSquare, 64 * 4 + index)]);
             add_8_int16(blackInputNotTurn, firstLayer2Weights[blackOffset + 64 * 4 + index]);
         }
 
         for (unsigned short index : getBitIndices(position.getBlackPawnsBits()))
         {
             add_8_int16(whiteInputTurn, firstLayer1Weights[whiteOffset + 64 * 5 + index]);
-            add_8_int16(whiteInputNotTurn, firstLayer2InvertedWeights[whiteOffset + 64 * 5 + index]);
-            add_8_int16(blackInputTurn, firstLayer1InvertedWeights[blackOffset + 64 * 5 + index]);
+            add_8_int16(whiteInputNotTurn, firstLayer2Weights[mirrorHalfKPFeature(whiteKingSquare, 64 * 5 + index)]);
+            add_8_int16(blackInputTurn, firstLayer1Weights[mirrorHalfKPFeature(blackKingSquare, 64 * 5 + index)]);
             add_8_int16(blackInputNotTurn, firstLayer2Weights[blackOffset + 64 * 5 + index]);
         }
 
         for (unsigned short index : getBitIndices(position.getBlackKnightsBits()))
         {
             add_8_int16(whiteInputTurn, firstLayer1Weights[whiteOffset + 64 * 6 + index]);
-            add_8_int16(whiteInputNotTurn, firstLayer2InvertedWeights[whiteOffset + 64 * 6 + index]);
-            add_8_int16(blackInputTurn, firstLayer1InvertedWeights[blackOffset + 64 * 6 + index]);
+            add_8_int16(whiteInputNotTurn, firstLayer2Weights[mirrorHalfKPFeature(whiteKingSquare, 64 * 6 + index)]);
+            add_8_int16(blackInputTurn, firstLayer1Weights[mirrorHalfKPFeature(blackKingSquare, 64 * 6 + index)]);
             add_8_int16(blackInputNotTurn, firstLayer2Weights[blackOffset + 64 * 6 + index]);
         }
 
         for (unsigned short index : getBitIndices(position.getBlackBishopsBits()))
         {
             add_8_int16(whiteInputTurn, firstLayer1Weights[whiteOffset + 64 * 7 + index]);
-            add_8_int16(whiteInputNotTurn, firstLayer2InvertedWeights[whiteOffset + 64 * 7 + index]);
-            add_8_int16(blackInputTurn, firstLayer1InvertedWeights[blackOffset + 64 * 7 + index]);
+            add_8_int16(whiteInputNotTurn, firstLayer2Weights[mirrorHalfKPFeature(whiteKingSquare, 64 * 7 + index)]);
+            add_8_int16(blackInputTurn, firstLayer1Weights[mirrorHalfKPFeature(blackKingSquare, 64 * 7 + index)]);
             add_8_int16(blackInputNotTurn, firstLayer2Weights[blackOffset + 64 * 7 + index]);
         }
 
         for (unsigned short index : getBitIndices(position.getBlackRooksBits()))
         {
             add_8_int16(whiteInputTurn, firstLayer1Weights[whiteOffset + 64 * 8 + index]);
-            add_8_int16(whiteInputNotTurn, firstLayer2InvertedWeights[whiteOffset + 64 * 8 + index]);
-            add_8_int16(blackInputTurn, firstLayer1InvertedWeights[blackOffset + 64 * 8 + index]);
+            add_8_int16(whiteInputNotTurn, firstLayer2Weights[mirrorHalfKPFeature(whiteKingSquare, 64 * 8 + index)]);
+            add_8_int16(blackInputTurn, firstLayer1Weights[mirrorHalfKPFeature(blackKingSquare, 64 * 8 + index)]);
             add_8_int16(blackInputNotTurn, firstLayer2Weights[blackOffset + 64 * 8 + index]);
         }
 
         for (unsigned short index : getBitIndices(position.getBlackQueensBits()))
         {
             add_8_int16(whiteInputTurn, firstLayer1Weights[whiteOffset + 64 * 9 + index]);
-            add_8_int16(whiteInputNotTurn, firstLayer2InvertedWeights[whiteOffset + 64 * 9 + index]);
-            add_8_int16(blackInputTurn, firstLayer1InvertedWeights[blackOffset + 64 * 9 + index]);
+            add_8_int16(whiteInputNotTurn, firstLayer2Weights[mirrorHalfKPFeature(whiteKingSquare, 64 * 9 + index)]);
+            add_8_int16(blackInputTurn, firstLayer1Weights[mirrorHalfKPFeature(blackKingSquare, 64 * 9 + index)]);
             add_8_int16(blackInputNotTurn, firstLayer2Weights[blackOffset + 64 * 9 + index]);
         }
+        accumulator.whiteKingSquare = static_cast<uint8_t>(whiteKingSquare);
+        accumulator.blackKingSquare = static_cast<uint8_t>(blackKingSquare);
+        accumulator.computed = true;
     }
 
-    // Helper functions to update the input vector
-    // They are used in bitposition.cpp inside makeNormalMove, makeCapture, setPiece and removePiece.
-
-    void addOnInput(int whiteKingPosition, int blackKingPosition, int subIndex)
+    // Refresh cache ("Finny table"). A king move changes every feature of its perspective, so instead of rebuilding
+    // the perspective from every piece we keep, for each king square, the accumulators last computed with the king
+    // there and the piece bitboards they were computed from. A refresh then only applies the pieces that changed
+    // since, which is a handful for king walks in endgames and for castling back and forth in the search.
+    struct RefreshEntry
     {
-        // White turn (use normal NNUE)
-        add_8_int16(whiteInputTurn, firstLayer1Weights[whiteKingPosition * 640 + subIndex]);
-        add_8_int16(blackInputNotTurn, firstLayer2Weights[blackKingPosition * 640 + subIndex]);
-        // Black turn (use inverted NNUE)
-        add_8_int16(whiteInputNotTurn, firstLayer2InvertedWeights[whiteKingPosition * 640 + subIndex]);
-        add_8_int16(blackInputTurn, firstLayer1InvertedWeights[blackKingPosition * 640 + subIndex]);
-    }
-
-    void removeOnInput(int whiteKingPosition, int blackKingPosition, int subIndex)
+        int16_t inputTurn[8];
+        int16_t inputNotTurn[8];
+        uint64_t pieces[10]; // Same order as the features: white pawns to queens, then black pawns to queens
+    };
+    // Each search thread refreshes from its own cache, filled from the positions it searches
+    thread_local RefreshEntry whiteKingRefreshCache[64];
+    thread_local RefreshEntry blackKingRefreshCache[64];
+
+    // A thread resets its cache the next time it uses it after a network is loaded
+    thread_local uint32_t refreshCacheGeneration{0};
+
+    void resetRefreshCache()
+    // Every entry starts as an empty board, so it must be reset whenever the biases change
     {
-        // White turn (use normal NNUE)
-        substract_8_int16(whiteInputTurn, firstLayer1Weights[whiteKingPosition * 640 + subIndex]);
-        substract_8_int16(blackInputNotTurn, firstLayer2Weights[blackKingPosition * 640 + subIndex]);
-        // Black turn (use inverted NNUE)
-        substract_8_int16(whiteInputNotTurn, firstLayer2InvertedWeights[whiteKingPosition * 640 + subIndex]);
-        substract_8_int16(blackInputTurn, firstLayer1InvertedWeights[blackKingPosition * 640 + subIndex]);
+        for (int square = 0; square < 64; ++square)
+        {
+            for (RefreshEntry *entry : {&whiteKingRefreshCache[square], &blackKingRefreshCache[square]})
+            {
+                std::memcpy(entry->inputTurn, firstLayer1Biases, sizeof(entry->inputTurn));
+                std::memcpy(entry->inputNotTurn, firstLayer2Biases, sizeof(entry->inputNotTurn));
+                std::memset(entry->pieces, 0, sizeof(entry->pieces));
+            }
+        }
+        refreshCacheGeneration = networkGeneration;
     }
-    // Move King functions to update nnueInput vector
-    void moveWhiteKingNNUEInput(BitPosition &position)
-    {
-        int whiteOffset = position.getWhiteKingPosition() * 640;
 
-        std::memcpy(whiteInputTurn, firstLayer1Biases, 16);
-        std::memcpy(whiteInputNotTurn, firstLayer2Biases, 16);
+    void refreshFromCache(RefreshEntry &entry, const BitPosition &position, int kingSquare, bool whiteKing)
+    // Brings a cache entry up to date with the position, only applying the pieces that changed.
+    // The white king perspective reads the turn weights directly and the black king one through the mirrored features.
+    {
+        const uint64_t pieces[10]{
+            position.getWhitePawnsBits(), position.getWhiteKnightsBits(), position.getWhiteBishopsBits(),
+            position.getWhiteRooksBits(), position.getWhiteQueensBits(), position.getBlackPawnsBits(),
+            position.getBlackKnightsBits(), position.getBlackBishopsBits(), position.getBlackRooksBits(),
+            position.getBlackQueensBits()};
 
-        for (unsigned short index : getBitIndices(position.getWhitePawnsBits()))
-        {
-            add_8_int16(whiteInputTurn, firstLayer1Weights[whiteOffset + index]);
-            add_8_int16(whiteInputNotTurn, firstLayer2InvertedWeights[whiteOffset + index]);
-        }
-        for (unsigned short index : getBitIndices(position.getWhiteKnightsBits()))
-        {
-            add_8_int16(whiteInputTurn, firstLayer1Weights[whiteOffset + 64 + index]);
-            add_8_int16(whiteInputNotTurn, firstLayer2InvertedWeights[whiteOffset + 64 + index]);
-        }
-        for (unsigned short index : getBitIndices(position.getWhiteBishopsBits()))
+        for (int piece = 0; piece < 10; ++piece)
         {
-            add_8_int16(whiteInputTurn, firstLayer1Weights[whiteOffset + 64 * 2 + index]);
-            add_8_int16(whiteInputNotTurn, firstLayer2InvertedWeights[whiteOffset + 64 * 2 + index]);
-        }
-        for (unsigned short index : getBitIndices(position.getWhiteRooksBits()))
-        {
-            add_8_int16(whiteInputTurn, firstLayer1Weights[whiteOffset + 64 * 3 + index]);
-            add_8_int16(whiteInputNotTurn, firstLayer2InvertedWeights[whiteOffset + 64 * 3 + index]);
-        }
-        for (unsigned short index : getBitIndices(position.getWhiteQueensBits()))
-        {
-            add_8_int16(whiteInputTurn, firstLayer1Weights[whiteOffset + 64 * 4 + index]);
-            add_8_int16(whiteInputNotTurn, firstLayer2InvertedWeights[whiteOffset + 64 * 4 + index]);
+            uint64_t removed{entry.pieces[piece] & ~pieces[piece]};
+            uint64_t added{pieces[piece] & ~entry.pieces[piece]};
+            while (removed)
+            {
+                int feature{64 * piece + getLeastSignificantBitIndex(removed)};
+                int index{kingSquare * 640 + feature};
+                int mirroredIndex{mirrorHalfKPFeature(kingSquare, feature)};
+                substract_8_int16(entry.inputTurn, firstLayer1Weights[whiteKing ? index : mirroredIndex]);
+                substract_8_int16(entry.inputNotTurn, firstLayer2Weights[whiteKing ? mirroredIndex : index]);
+                removed &= removed - 1;
+            }
+            while (added)
+            {
+                int feature{64 * piece + getLeastSignificantBitIndex(added)};
+                int index{kingSquare * 640 + feature};
+                int mirroredIndex{mirrorHalfKPFeature(kingSquare, feature)};
+                add_8_int16(entry.inputTurn, firstLayer1Weights[whiteKing ? index : mirroredIndex]);
+                add_8_int16(entry.inputNotTurn, firstLayer2Weights[whiteKing ? mirroredIndex : index]);
+                added &= added - 1;
+            }
+            entry.pieces[piece] = pieces[piece];
         }
+    }
 
-        for (unsigned short index : getBitIndices(position.getBlackPawnsBits()))
-        {
-            add_8_int16(whiteInputTurn, firstLayer1Weights[whiteOffset + 64 * 5 + index]);
-            add_8_int16(whiteInputNotTurn, firstLayer2InvertedWeights[whiteOffset + 64 * 5 + index]);
-        }
-        for (unsigned short index : getBitIndices(position.getBlackKnightsBits()))
-        {
-            add_8_int16(whiteInputTurn, firstLayer1Weights[whiteOffset + 64 * 6 + index]);
-            add_8_int16(whiteInputNotTurn, firstLayer2InvertedWeights[whiteOffset + 64 * 6 + index]);
-        }
-        for (unsigned short index : getBitIndices(position.getBlackBishopsBits()))
-        {
-            add_8_int16(whiteInputTurn, firstLayer1Weights[whiteOffset + 64 * 7 + index]);
-            add_8_int16(whiteInputNotTurn, firstLayer2InvertedWeights[whiteOffset + 64 * 7 + index]);
-        }
-        for (unsigned short index : getBitIndices(position.getBlackRooksBits()))
-        {
-            add_8_int16(whiteInputTurn, firstLayer1Weights[whiteOffset + 64 * 8 + index]);
-            add_8_int16(whiteInputNotTurn, firstLayer2InvertedWeights[whiteOffset + 64 * 8 + index]);
-        }
-        for (unsigned short index : getBitIndices(position.getBlackQueensBits()))
+    void applyChanges(BitPosition &position, int computedPly, int16_t *inputTurn, int16_t *inputNotTurn, int kingSquare,
+                      bool whiteKing)
+    // Applies the features recorded by the moves after computedPly to one king's perspective
+    {
+        for (int i = computedPly + 1; i <= position.getPly(); ++i)
         {
-            add_8_int16(whiteInputTurn, firstLayer1Weights[whiteOffset + 64 * 9 + index]);
-            add_8_int16(whiteInputNotTurn, firstLayer2InvertedWeights[whiteOffset + 64 * 9 + index]);
+            const Accumulator &changes{position.getAccumulator(i)};
+            for (int j = 0; j < changes.numRemoved; ++j)
+            {
+                int index{kingSquare * 640 + changes.removed[j]};
+                int mirroredIndex{mirrorHalfKPFeature(kingSquare, changes.removed[j])};
+                substract_8_int16(inputTurn, firstLayer1Weights[whiteKing ? index : mirroredIndex]);
+                substract_8_int16(inputNotTurn, firstLayer2Weights[whiteKing ? mirroredIndex : index]);
+            }
+            for (int j = 0; j < changes.numAdded; ++j)
+            {
+                int index{kingSquare * 640 + changes.added[j]};
+                int mirroredIndex{mirrorHalfKPFeature(kingSquare, changes.added[j])};
+                add_8_int16(inputTurn, firstLayer1Weights[whiteKing ? index : mirroredIndex]);
+                add_8_int16(inputNotTurn, firstLayer2Weights[whiteKing ? mirroredIndex : index]);
+            }
         }
     }
-    void moveBlackKingNNUEInput(BitPosition &position)
-    {
-        int blackOffset = position.getBlackKingPosition() * 640;
-
-        std::memcpy(blackInputTurn, firstLayer1Biases, 16);
-        std::memcpy(blackInputNotTurn, firstLayer2Biases, 16);
 
-        for (unsigned short index : getBitIndices(position.getWhitePawnsBits()))
-        {
-            add_8_int16(blackInputTurn, firstLayer1InvertedWeights[blackOffset + index]);
-            add_8_int16(blackInputNotTurn, firstLayer2Weights[blackOffset + index]);
-        }
-        for (unsigned short index : getBitIndices(position.getWhiteKnightsBits()))
-        {
-            add_8_int16(blackInputTurn, firstLayer1InvertedWeights[blackOffset + 64 + index]);
-            add_8_int16(blackInputNotTurn, firstLayer2Weights[blackOffset + 64 + index]);
-        }
-        for (unsigned short index : getBitIndices(position.getWhiteBishopsBits()))
-        {
-            add_8_int16(blackInputTurn, firstLayer1InvertedWeights[blackOffset + 64 * 2 + index]);
-            add_8_int16(blackInputNotTurn, firstLayer2Weights[blackOffset + 64 * 2 + index]);
-        }
-        for (unsigned short index : getBitIndices(position.getWhiteRooksBits()))
-        {
-            add_8_int16(blackInputTurn, firstLayer1InvertedWeights[blackOffset + 64 * 3 + index]);
-            add_8_int16(blackInputNotTurn, firstLayer2Weights[blackOffset + 64 * 3 + index]);
-        }
-        for (unsigned short index : getBitIndices(position.getWhiteQueensBits()))
+    void updateAccumulator(BitPosition &position)
+    // Brings the current accumulator up to date from the nearest computed ancestor. A king's perspective applies the
+    // changes recorded by makeMove if the king is on the same square as in the ancestor, otherwise all its features
+    // changed and it is refreshed through the refresh cache. The plies in between are left as they are.
+    {
+        Accumulator &accumulator{position.getAccumulator()};
+        if (accumulator.computed)
+            return;
+        // Inputs allocated by a network of another size have to be initialized again
+        if (position.getAccumulatorSize() != ACCUMULATOR_SIZE)
         {
-            add_8_int16(blackInputTurn, firstLayer1InvertedWeights[blackOffset + 64 * 4 + index]);
-            add_8_int16(blackInputNotTurn, firstLayer2Weights[blackOffset + 64 * 4 + index]);
+            initializeNNUEInput(position);
+            return;
         }
 
-        for (unsigned short index : getBitIndices(position.getBlackPawnsBits()))
+        int computedPly{position.getPly()};
+        while (computedPly > 0 && not position.getAccumulator(computedPly).computed)
+            computedPly--;
+        const Accumulator &ancestor{position.getAccumulator(computedPly)};
+        if (not ancestor.computed)
         {
-            add_8_int16(blackInputTurn, firstLayer1InvertedWeights[blackOffset + 64 * 5 + index]);
-            add_8_int16(blackInputNotTurn, firstLayer2Weights[blackOffset + 64 * 5 + index]);
+            initializeNNUEInput(position);
+            return;
         }
-        for (unsigned short index : getBitIndices(position.getBlackKnightsBits()))
+        if (refreshCacheGeneration != networkGeneration)
+            resetRefreshCache();
+
+        int whiteKingSquare{position.getWhiteKingPosition()};
+        if (whiteKingSquare == ancestor.whiteKingSquare)
         {
-            add_8_int16(blackInputTurn, firstLayer1InvertedWeights[blackOffset + 64 * 6 + index]);
-            add_8_int16(blackInputNotTurn, firstLayer2Weights[blackOffset + 64 * 6 + index]);
+            std::memcpy(accumulator.inputWhiteTurn, ancestor.inputWhiteTurn, INPUT_BYTES);
+            std::memcpy(accumulator.inputWhiteNotTurn, ancestor.inputWhiteNotTurn, sizeof(accumulator.inputWhiteNotTurn));
+            applyChanges(position, computedPly, accumulator.inputWhiteTurn, accumulator.inputWhiteNotTurn, whiteKingSquare, true);
         }
-        for (unsigned short index : getBitIndices(position.getBlackBishopsBits()))
+        else
         {
-            add_8_int16(blackInputTurn, firstLayer1InvertedWeights[blackOffset + 64 * 7 + index]);
-            add_8_int16(blackInputNotTurn, firstLayer2Weights[blackOffset + 64 * 7 + index]);
+            RefreshEntry &entry{whiteKingRefreshCache[whiteKingSquare]};
+            refreshFromCache(entry, position, whiteKingSquare, true);
+            std::memcpy(accumulator.inputWhiteTurn, entry.inputTurn, INPUT_BYTES);
+            std::memcpy(accumulator.inputWhiteNotTurn, entry.inputNotTurn, sizeof(accumulator.inputWhiteNotTurn));
         }
-        for (unsigned short index : getBitIndices(position.getBlackRooksBits()))
+
+        int blackKingSquare{position.getBlackKingPosition()};
+        if (blackKingSquare == ancestor.blackKingSquare)
         {
-            add_8_int16(blackInputTurn, firstLayer1InvertedWeights[blackOffset + 64 * 8 + index]);
-            add_8_int16(blackInputNotTurn, firstLayer2Weights[blackOffset + 64 * 8 + index]);
+            std::memcpy(accumulator.inputBlackTurn, ancestor.inputBlackTurn, INPUT_BYTES);
+            std::memcpy(accumulator.inputBlackNotTurn, ancestor.inputBlackNotTurn, sizeof(accumulator.inputBlackNotTurn));
+            applyChanges(position, computedPly, accumulator.inputBlackTurn, accumulator.inputBlackNotTurn, blackKingSquare, false);
         }
-        for (unsigned short index : getBitIndices(position.getBlackQueensBits()))
+        else
         {
-            add_8_int16(blackInputTurn, firstLayer1InvertedWeights[blackOffset + 64 * 9 + index]);
-            add_8_int16(blackInputNotTurn, firstLayer2Weights[blackOffset + 64 * 9 + index]);
+            RefreshEntry &entry{blackKingRefreshCache[blackKingSquare]};
+            refreshFromCache(entry, position, blackKingSquare, false);
+            std::memcpy(accumulator.inputBlackTurn, entry.inputTurn, INPUT_BYTES);
+            std::memcpy(accumulator.inputBlackNotTurn, entry.inputNotTurn, sizeof(accumulator.inputBlackNotTurn));
         }
+
+        accumulator.whiteKingSquare = static_cast<uint8_t>(whiteKingSquare);
+        accumulator.blackKingSquare = static_cast<uint8_t>(blackKingSquare);
+        accumulator.computed = true;
     }
 } // namespace NNUE
 
@@ -550,32 +576,34 @@ void load_int16_2D_array1(const std::string &file_path, int16_t weights[640][8])
     }
 }
 
-void load_inverted_int16_2D_array1(const std::string &file_path, int16_t weights[640][8])
-{
-    std::ifstream file(file_path);
-    std::string line;
-    size_t row = 0;
-
-    while (std::getline(file, line) && row < 8)
-    {
-        std::stringstream ss(line);
-        std::string value;
-        size_t col = 0;
-
-        while (std::getline(ss, value, ',') && col < 640)
-        {
-            int pieceType = col / 64;
-            int square = col % 64;
-
-            // Compute the new column after inverting color and square
-            int newPieceType = (pieceType + 5) % 10;
-            int newCol =  newPieceType * 64 + invertIndex(square);
-            weights[newCol][row] = static_cast<int16_t>(std::stoi(value));
-            col++;
-        }
-        row++;
-    }
-}
+// The default NNUEU network is embedded in the executable, so that it runs without the models directory and
+// reads no file when starting. The assembler includes the file relative to the directory the engine is compiled
+// from (src/, as for the models directory). Build with -DNNUE_EMBEDDING_OFF to load it from models/ instead,
+// or with -DEMBEDDED_NNUEU='"path"' to embed another network.
+#if !defined(NNUE_EMBEDDING_OFF) && defined(__GNUC__)
+#define HAS_EMBEDDED_NNUEU
+#if !defined(EMBEDDED_NNUEU)
+#define EMBEDDED_NNUEU "models/NNUEU_quantized_model_v1_param_350_epoch_5.nnue"
+#endif
+#if defined(__APPLE__)
+#define EMBEDDED_SECTION ".const_data\n"
+#define EMBEDDED_SYMBOL(name) "_" #name
+#else
+#define EMBEDDED_SECTION ".section .rodata\n"
+#define EMBEDDED_SYMBOL(name) #name
+#endif
+// Aligned as the sections of a mapped file, which start at a multiple of 64 bytes
+asm(EMBEDDED_SECTION
+    ".balign 64\n"
+    ".globl " EMBEDDED_SYMBOL(embeddedNNUEUBegin) "\n"
+    EMBEDDED_SYMBOL(embeddedNNUEUBegin) ":\n"
+    ".incbin \"" EMBEDDED_NNUEU "\"\n"
+    ".globl " EMBEDDED_SYMBOL(embeddedNNUEUEnd) "\n"
+    EMBEDDED_SYMBOL(embeddedNNUEUEnd) ":\n"
+    ".text\n");
+extern "C" const uint8_t embeddedNNUEUBegin[];
+extern "C" const uint8_t embeddedNNUEUEnd[];
+#endif
 
 namespace NNUEU
 {
@@ -629,101 +657,270 @@ namespace NNUEU
         std::cout << std::endl;
     }
 
-    int16_t inputWhiteTurn[8] = {0};
-    int16_t inputBlackTurn[8] = {0};
+    // The parameters point into the mapped network file, laid out for the layer sizes it was loaded with
+    NNUEFile::Network network;
+    LayerSizes layerSizes{LAYERS_8};
+
+    const int16_t *firstLayerWeights{nullptr};
+
+    const int8_t *secondLayer1Weights{nullptr};
+    const int8_t *secondLayer2Weights{nullptr};
+
+    const int8_t *thirdLayerWeights{nullptr};
+    const int8_t *finalLayerWeights{nullptr};
+
+    const int16_t *firstLayerBiases{nullptr};
+    const int16_t *secondLayerBiases{nullptr};
+    const int16_t *thirdLayerBiases{nullptr};
+    const int16_t *finalLayerBias{nullptr};
+
+    // Forward pass of the loaded layer sizes for this CPU
+    NnueuPass forwardPass{nullptr};
+
+    // Second and third layer weights of networks wider than 8-8-4, interleaved for their forward passes when the
+    // network is loaded (see interleaveWeights). The others are read in the file.
+    std::unique_ptr<int8_t[], void (*)(void *)> interleavedWeights{nullptr, std::free};
+
+    const std::string DEFAULT_NETWORK{"NNUEU_quantized_model_v1_param_350_epoch_5.nnue"};
+
+    LayerSizes getLayerSizes()
+    {
+        return layerSizes;
+    }
+
+    template <typename Function>
+    static auto withLayers(LayerSizes sizes, Function &&function)
+    // Calls function with the NnueuLayers of the given sizes
+    {
+        switch (sizes)
+        {
+        case LAYERS_256:
+            return function(NnueuLayers256{});
+        case LAYERS_512:
+            return function(NnueuLayers512{});
+        default:
+            return function(NnueuLayers8{});
+        }
+    }
+
+    template <typename Layers>
+    NNUEFile::Header networkLayers()
+    {
+        NNUEFile::Header layers{};
+        layers.architecture = NNUEFile::NNUEU;
+        layers.numFeatures = 640;
+        layers.accumulatorSize = Layers::ACCUMULATOR_SIZE;
+        layers.hiddenSize1 = Layers::HIDDEN_SIZE_1;
+        layers.hiddenSize2 = Layers::HIDDEN_SIZE_2;
+        layers.outputSize = 1;
+        return layers;
+    }
 
-    int16_t firstLayerWeights[640][8] = {0};
-    int16_t firstLayerInvertedWeights[640][8] = {0};
+    // Sections of the network file, in order
+    template <typename Layers>
+    std::vector<size_t> sectionSizes()
+    {
+        return {
+            sizeof(int16_t) * 640 * Layers::ACCUMULATOR_SIZE,                 // First layer weights
+            sizeof(int16_t) * Layers::ACCUMULATOR_SIZE,                       // First layer biases
+            sizeof(int8_t) * 64 * Layers::KING_BLOCK_SIZE,                    // Second layer turn weights, for each king square
+            sizeof(int8_t) * 64 * Layers::KING_BLOCK_SIZE,                    // Second layer not turn weights, for each king square
+            sizeof(int16_t) * Layers::HIDDEN_SIZE_1,                          // Second layer biases (turn then not turn)
+            sizeof(int8_t) * Layers::HIDDEN_SIZE_2 * Layers::HIDDEN_SIZE_1,   // Third layer weights
+            sizeof(int16_t) * Layers::HIDDEN_SIZE_2,                          // Third layer biases
+            sizeof(int8_t) * Layers::HIDDEN_SIZE_2,                           // Final layer weights
+            sizeof(int16_t)};                                                 // Final layer bias
+    }
 
-    int8_t secondLayer1Weights[64][8 * 4] = {0};
-    int8_t secondLayer2Weights[64][8 * 4] = {0};
+    template <typename Layers>
+    constexpr size_t interleavedSize()
+    // Bytes of the interleaved second and third layer weights, rounded up to whole cache lines
+    {
+        return (2 * 64 * Layers::KING_BLOCK_SIZE + Layers::HIDDEN_SIZE_2 * Layers::HIDDEN_SIZE_1 + 63) / 64 * 64;
+    }
+
+    template <typename Layers>
+    void interleaveLayers(int8_t *weights)
+    // Copies the second and third layer weights of the loaded network into weights (interleavedSize bytes),
+    // interleaved by groups of 4 inputs. Each king square's block is interleaved on its own, so blocks stay
+    // KING_BLOCK_SIZE apart.
+    {
+        constexpr size_t KING_BLOCKS_SIZE{64 * Layers::KING_BLOCK_SIZE};
+        for (int king = 0; king < 64; ++king)
+        {
+            interleaveWeights(secondLayer1Weights + king * Layers::KING_BLOCK_SIZE, weights + king * Layers::KING_BLOCK_SIZE,
+                              Layers::ACCUMULATOR_SIZE, Layers::HIDDEN_SIZE_1 / 2);
+            interleaveWeights(secondLayer2Weights + king * Layers::KING_BLOCK_SIZE, weights + KING_BLOCKS_SIZE + king * Layers::KING_BLOCK_SIZE,
+                              Layers::ACCUMULATOR_SIZE, Layers::HIDDEN_SIZE_1 / 2);
+        }
+        interleaveWeights(thirdLayerWeights, weights + 2 * KING_BLOCKS_SIZE, Layers::HIDDEN_SIZE_1, Layers::HIDDEN_SIZE_2);
 
-    int8_t secondLayer1WeightsBlockWhiteTurn[8 * 4] = {0};
-    int8_t secondLayer2WeightsBlockWhiteTurn[8 * 4] = {0};
-    int8_t secondLayer1WeightsBlockBlackTurn[8 * 4] = {0};
-    int8_t secondLayer2WeightsBlockBlackTurn[8 * 4] = {0};
+        secondLayer1Weights = weights;
+        secondLayer2Weights = weights + KING_BLOCKS_SIZE;
+        thirdLayerWeights = weights + 2 * KING_BLOCKS_SIZE;
+        interleavedWeights.reset(weights);
+    }
 
-    int8_t thirdLayerWeights[8 * 4] = {0};
-    int8_t finalLayerWeights[4] = {0};
+    template <typename Layers>
+    bool useNetwork(NNUEFile::Network &&newNetwork, LayerSizes sizes)
+    // Returns whether the network could be used, the current network stays loaded otherwise
+    {
+        // Wider networks are interleaved into a new buffer, allocated first so that failing leaves everything as it was
+        int8_t *weights{nullptr};
+        if constexpr (not std::is_same_v<Layers, NnueuLayers8>)
+        {
+            weights = static_cast<int8_t *>(std::aligned_alloc(64, interleavedSize<Layers>()));
+            if (weights == nullptr)
+            {
+                std::cerr << "Failed to allocate " << interleavedSize<Layers>() << " bytes for the network weights\n";
+                return false;
+            }
+        }
 
-    int16_t firstLayerBiases[8] = {0};
-    int16_t secondLayerBiases[8] = {0};
-    int16_t thirdLayerBiases[4] = {0};
-    int16_t finalLayerBias = 0;
+        // Choose the forward pass for this CPU
+        selectSimdBackend();
+        forwardPass = getNnueuPass<Layers>(getSimdBackendIndex());
+
+        network = std::move(newNetwork);
+        layerSizes = sizes;
+
+        firstLayerWeights = network.getSection<int16_t>(0);
+        firstLayerBiases = network.getSection<int16_t>(1);
+        secondLayer1Weights = network.getSection<int8_t>(2);
+        secondLayer2Weights = network.getSection<int8_t>(3);
+        secondLayerBiases = network.getSection<int16_t>(4);
+        thirdLayerWeights = network.getSection<int8_t>(5);
+        thirdLayerBiases = network.getSection<int16_t>(6);
+        finalLayerWeights = network.getSection<int8_t>(7);
+        finalLayerBias = network.getSection<int16_t>(8);
+
+        if constexpr (std::is_same_v<Layers, NnueuLayers8>)
+            interleavedWeights.reset();
+        else
+            interleaveLayers<Layers>(weights);
+        return true;
+    }
 
-    void initNNUEParameters()
+    bool initNNUEParameters()
+    // Loads the network embedded in the executable, or the default network file if it was built without one
     {
-        const std::string modelDir = "models/NNUEU_quantized_model_v1_param_350_epoch_5/";
+#if defined(HAS_EMBEDDED_NNUEU)
+        NNUEFile::Network newNetwork;
+        if (not newNetwork.open(embeddedNNUEUBegin, static_cast<size_t>(embeddedNNUEUEnd - embeddedNNUEUBegin),
+                                "embedded in the executable", networkLayers<NnueuLayers8>(), sectionSizes<NnueuLayers8>()))
+            return false;
+        return useNetwork<NnueuLayers8>(std::move(newNetwork), LAYERS_8);
+#else
+        return initNNUEParameters(NNUEFile::findModel(DEFAULT_NETWORK));
+#endif
+    }
 
-        // Load weights into fixed-size arrays
-        load_int16_2D_array1(modelDir + "first_linear_weights.csv", firstLayerWeights);
-        load_inverted_int16_2D_array1(modelDir + "first_linear_weights.csv", firstLayerInvertedWeights);
+    bool initNNUEParameters(const std::string &path)
+    // The header's layer sizes tell which of the compiled in NnueuLayers reads the file
+    {
+        NNUEFile::Header header;
+        if (not NNUEFile::readHeader(path, header))
+            return false;
+
+        LayerSizes sizes;
+        if (header.accumulatorSize == NnueuLayers256::ACCUMULATOR_SIZE && header.hiddenSize1 == NnueuLayers256::HIDDEN_SIZE_1 &&
+            header.hiddenSize2 == NnueuLayers256::HIDDEN_SIZE_2)
+            sizes = LAYERS_256;
+        else if (header.accumulatorSize == NnueuLayers512::ACCUMULATOR_SIZE && header.hiddenSize1 == NnueuLayers512::HIDDEN_SIZE_1 &&
+                 header.hiddenSize2 == NnueuLayers512::HIDDEN_SIZE_2)
+            sizes = LAYERS_512;
+        else
+            sizes = LAYERS_8; // Rejected below as wrong layer sizes if it isn't 8-8-4 either
+
+        // The current network stays loaded if the new one is not valid
+        return withLayers(sizes, [&](auto layers)
+                          {
+                              using Layers = decltype(layers);
+                              NNUEFile::Network newNetwork;
+                              if (not newNetwork.open(path, networkLayers<Layers>(), sectionSizes<Layers>()))
+                                  return false;
+                              return useNetwork<Layers>(std::move(newNetwork), sizes); });
+    }
 
-        load_int8_2D_array1(modelDir + "second_layer_turn_weights.csv", secondLayer1Weights);
-        load_int8_2D_array1(modelDir + "second_layer_not_turn_weights.csv", secondLayer2Weights);
+    bool convertNetwork(const std::string &modelDir, const std::string &path)
+    // Reads the parameters from the CSV files of a model directory and writes them as a network file. The CSV models
+    // are all 8-8-4 networks.
+    {
+        const std::vector<size_t> SECTION_SIZES{sectionSizes<NnueuLayers8>()};
+        int16_t tempFirstLayerWeights[640][8] = {0};
+        int8_t tempSecondLayer1Weights[64][8 * 4] = {0};
+        int8_t tempSecondLayer2Weights[64][8 * 4] = {0};
+        load_int16_2D_array1(modelDir + "first_linear_weights.csv", tempFirstLayerWeights);
+        load_int8_2D_array1(modelDir + "second_layer_turn_weights.csv", tempSecondLayer1Weights);
+        load_int8_2D_array1(modelDir + "second_layer_not_turn_weights.csv", tempSecondLayer2Weights);
 
         auto tempThirdLayerWeights = load_int8_1D_array(modelDir + "third_layer_weights.csv", 8 * 4);
-        std::memcpy(thirdLayerWeights, tempThirdLayerWeights, sizeof(int8_t) * 8 * 4);
-        delete[] tempThirdLayerWeights;
-
         auto tempFinalLayerWeights = load_int8_1D_array(modelDir + "final_layer_weights.csv", 4);
-        std::memcpy(finalLayerWeights, tempFinalLayerWeights, sizeof(int8_t) * 4);
-        delete[] tempFinalLayerWeights;
+        if (tempThirdLayerWeights == nullptr || tempFinalLayerWeights == nullptr)
+        {
+            delete[] tempThirdLayerWeights;
+            delete[] tempFinalLayerWeights;
+            return false;
+        }
 
-        // Load biases
         auto tempFirstLayerBiases = load_int16_array(modelDir + "first_linear_biases.csv", 8);
-        std::memcpy(firstLayerBiases, tempFirstLayerBiases, sizeof(int16_t) * 8);
-        delete[] tempFirstLayerBiases;
-
         auto tempSecondLayer1Biases = load_int16_array(modelDir + "second_layer_turn_biases.csv", 4);
         auto tempSecondLayer2Biases = load_int16_array(modelDir + "second_layer_not_turn_biases.csv", 4);
+        auto tempThirdLayerBiases = load_int16_array(modelDir + "third_layer_biases.csv", 4);
+        int16_t tempFinalLayerBias = load_int16(modelDir + "final_layer_biases.csv");
 
         // Concatenate biases directly
-        std::memcpy(secondLayerBiases, tempSecondLayer1Biases, sizeof(int16_t) * 4);
-        std::memcpy(secondLayerBiases + 4, tempSecondLayer2Biases, sizeof(int16_t) * 4);
+        int16_t tempSecondLayerBiases[8];
+        std::memcpy(tempSecondLayerBiases, tempSecondLayer1Biases, sizeof(int16_t) * 4);
+        std::memcpy(tempSecondLayerBiases + 4, tempSecondLayer2Biases, sizeof(int16_t) * 4);
+
+        bool written{NNUEFile::writeNetwork(path, networkLayers<NnueuLayers8>(),
+                                            {{tempFirstLayerWeights, SECTION_SIZES[0]},
+                                             {tempFirstLayerBiases, SECTION_SIZES[1]},
+                                             {tempSecondLayer1Weights, SECTION_SIZES[2]},
+                                             {tempSecondLayer2Weights, SECTION_SIZES[3]},
+                                             {tempSecondLayerBiases, SECTION_SIZES[4]},
+                                             {tempThirdLayerWeights, SECTION_SIZES[5]},
+                                             {tempThirdLayerBiases, SECTION_SIZES[6]},
+                                             {tempFinalLayerWeights, SECTION_SIZES[7]},
+                                             {&tempFinalLayerBias, SECTION_SIZES[8]}})};
 
+        delete[] tempThirdLayerWeights;
+        delete[] tempFinalLayerWeights;
+        delete[] tempFirstLayerBiases;
         delete[] tempSecondLayer1Biases;
         delete[] tempSecondLayer2Biases;
-
-        auto tempThirdLayerBiases = load_int16_array(modelDir + "third_layer_biases.csv", 4);
-        std::memcpy(thirdLayerBiases, tempThirdLayerBiases, sizeof(int16_t) * 4);
         delete[] tempThirdLayerBiases;
-
-        finalLayerBias = load_int16(modelDir + "final_layer_biases.csv");
-
-        // Print arrays
-        // print2DArray("First Layer Weights", firstLayerWeights, 640);
-        // print2DArray("First Layer Inverted Weights", firstLayerInvertedWeights, 640);
-        // print2DArray("Second Layer 1 Weights", secondLayer1Weights, 64);
-        // print2DArray("Second Layer 2 Weights", secondLayer2Weights, 64);
-
-        // printArray("Third Layer Weights", thirdLayerWeights, 8 * 4);
-        // printArray("Final Layer Weights", finalLayerWeights, 4);
-
-        // printArray("First Layer Biases", firstLayerBiases, 8);
-        // printArray("Second Layer Biases", secondLayerBiases, 8);
-        // printArray("Third Layer Biases", thirdLayerBiases, 4);
-        // std::cout << "Final Layer Bias: " << finalLayerBias << std::endl;
+        return written;
     }
 
     // The engine is built to get an evaluation of the position with high values being good for the engine.
     // The NNUE is built to give an evaluation of the position with high values being good for whose turn it is.
     // This function gives an evaluation with high values being good for engine.
 
-    int16_t evaluationFunction(bool ourTurn)
+    template <typename Layers>
+    int16_t evaluationFunction(BitPosition &position, bool ourTurn)
     {
         int16_t out;
+        updateAccumulator<Layers>(position);
+        Accumulator &accumulator{position.getAccumulator()};
+        int whiteKingPos{position.getWhiteKingPosition()};
+        int blackKingPos{position.getBlackKingPosition()};
 
-        // If its our turn in white, or if its not our turn in black then it is white's turn
-        if (ourTurn == ENGINEISWHITE)
+        // The side to move picks the accumulator, so the engine's colour is not needed.
+        // The second layer weights are chosen by the kings' squares (mirrored for black).
+        constexpr int KING_BLOCK_SIZE{Layers::KING_BLOCK_SIZE};
+        if (position.getTurn())
         {
-            out = fullNnueuPass(inputWhiteTurn, secondLayer1WeightsBlockWhiteTurn, secondLayer2WeightsBlockWhiteTurn, secondLayerBiases,
-                               thirdLayerWeights, thirdLayerBiases, finalLayerWeights, &finalLayerBias);
+            out = forwardPass(accumulator.inputWhiteTurn, secondLayer1Weights + whiteKingPos * KING_BLOCK_SIZE,
+                              secondLayer2Weights + blackKingPos * KING_BLOCK_SIZE, secondLayerBiases,
+                              thirdLayerWeights, thirdLayerBiases, finalLayerWeights, finalLayerBias);
         }
         else
         {
-            out = fullNnueuPass(inputBlackTurn, secondLayer1WeightsBlockBlackTurn, secondLayer2WeightsBlockBlackTurn, secondLayerBiases, 
-                                thirdLayerWeights, thirdLayerBiases, finalLayerWeights, &finalLayerBias);
+            out = forwardPass(accumulator.inputBlackTurn, secondLayer1Weights + invertIndex(blackKingPos) * KING_BLOCK_SIZE,
+                              secondLayer2Weights + invertIndex(whiteKingPos) * KING_BLOCK_SIZE, secondLayerBiases,
+                              thirdLayerWeights, thirdLayerBiases, finalLayerWeights, finalLayerBias);
         }
         // Change evaluation from player to move perspective to white perspective
         if (ourTurn)
@@ -732,107 +929,181 @@ namespace NNUEU
         return 64 * 64 - out;
     }
 
-    void initializeNNUEInput(const BitPosition position)
+    template <typename Layers>
+    static inline void addFeature(Accumulator &accumulator, int feature)
+    // Adds a feature to both perspectives (mirrored for black)
+    {
+        add_int16<Layers::ACCUMULATOR_SIZE>(accumulator.inputWhiteTurn, firstLayerWeights + feature * Layers::ACCUMULATOR_SIZE);
+        add_int16<Layers::ACCUMULATOR_SIZE>(accumulator.inputBlackTurn, firstLayerWeights + mirrorFeature(feature) * Layers::ACCUMULATOR_SIZE);
+    }
+
+    template <typename Layers>
+    static inline void removeFeature(Accumulator &accumulator, int feature)
+    {
+        substract_int16<Layers::ACCUMULATOR_SIZE>(accumulator.inputWhiteTurn, firstLayerWeights + feature * Layers::ACCUMULATOR_SIZE);
+        substract_int16<Layers::ACCUMULATOR_SIZE>(accumulator.inputBlackTurn, firstLayerWeights + mirrorFeature(feature) * Layers::ACCUMULATOR_SIZE);
+    }
+
+    template <typename Layers>
+    void initializeNNUEInput(BitPosition &position)
     // Initialize the NNUE accumulators.
     {
-        std::memcpy(inputWhiteTurn, firstLayerBiases, sizeof(firstLayerBiases));
-        std::memcpy(inputBlackTurn, firstLayerBiases, sizeof(firstLayerBiases));
+        position.setAccumulatorSize(Layers::ACCUMULATOR_SIZE);
+        Accumulator &accumulator{position.getAccumulator()};
+        std::memcpy(accumulator.inputWhiteTurn, firstLayerBiases, sizeof(int16_t) * Layers::ACCUMULATOR_SIZE);
+        std::memcpy(accumulator.inputBlackTurn, firstLayerBiases, sizeof(int16_t) * Layers::ACCUMULATOR_SIZE);
 
         for (unsigned short index : getBitIndices(position.getWhitePawnsBits()))
-        {
-            add_8_int16(inputWhiteTurn, firstLayerWeights[index]);
-            add_8_int16(inputBlackTurn, firstLayerInvertedWeights[index]);
-        }
+            addFeature<Layers>(accumulator, index);
 
         for (unsigned short index : getBitIndices(position.getWhiteKnightsBits()))
-        {
-            add_8_int16(inputWhiteTurn, firstLayerWeights[64 + index]);
-            add_8_int16(inputBlackTurn, firstLayerInvertedWeights[64 + index]);
-        }
+            addFeature<Layers>(accumulator, 64 + index);
 
         for (unsigned short index : getBitIndices(position.getWhiteBishopsBits()))
-        {
-            add_8_int16(inputWhiteTurn, firstLayerWeights[64 * 2 + index]);
-            add_8_int16(inputBlackTurn, firstLayerInvertedWeights[64 * 2 + index]);
-        }
+            addFeature<Layers>(accumulator, 64 * 2 + index);
 
         for (unsigned short index : getBitIndices(position.getWhiteRooksBits()))
-        {
-            add_8_int16(inputWhiteTurn, firstLayerWeights[64 * 3 + index]);
-            add_8_int16(inputBlackTurn, firstLayerInvertedWeights[64 * 3 + index]);
-        }
+            addFeature<Layers>(accumulator, 64 * 3 + index);
 
         for (unsigned short index : getBitIndices(position.getWhiteQueensBits()))
-        {
-            add_8_int16(inputWhiteTurn, firstLayerWeights[64 * 4 + index]);
-            add_8_int16(inputBlackTurn, firstLayerInvertedWeights[64 * 4 + index]);
-        }
+            addFeature<Layers>(accumulator, 64 * 4 + index);
 
         for (unsigned short index : getBitIndices(position.getBlackPawnsBits()))
-        {
-            add_8_int16(inputWhiteTurn, firstLayerWeights[64 * 5 + index]);
-            add_8_int16(inputBlackTurn, firstLayerInvertedWeights[64 * 5 + index]);
-        }
+            addFeature<Layers>(accumulator, 64 * 5 + index);
 
         for (unsigned short index : getBitIndices(position.getBlackKnightsBits()))
-        {
-            add_8_int16(inputWhiteTurn, firstLayerWeights[64 * 6 + index]);
-            add_8_int16(inputBlackTurn, firstLayerInvertedWeights[64 * 6 + index]);
-        }
+            addFeature<Layers>(accumulator, 64 * 6 + index);
 
         for (unsigned short index : getBitIndices(position.getBlackBishopsBits()))
-        {
-            add_8_int16(inputWhiteTurn, firstLayerWeights[64 * 7 + index]);
-            add_8_int16(inputBlackTurn, firstLayerInvertedWeights[64 * 7 + index]);
-        }
+            addFeature<Layers>(accumulator, 64 * 7 + index);
 
         for (unsigned short index : getBitIndices(position.getBlackRooksBits()))
+            addFeature<Layers>(accumulator, 64 * 8 + index);
+
+        for (unsigned short index : getBitIndices(position.getBlackQueensBits()))
+            addFeature<Layers>(accumulator, 64 * 9 + index);
+
+        accumulator.computed = true;
+    }
+
+    template <typename Layers>
+    void updateAccumulator(BitPosition &position)
+    // Brings the current accumulator up to date. makeMove only records the features each move added and removed,
+    // so we start from the nearest computed ancestor and apply the recorded changes ply by ply.
+    {
+        // Inputs allocated by a network of another size have to be initialized again
+        if (position.getAccumulatorSize() != Layers::ACCUMULATOR_SIZE)
         {
-            add_8_int16(inputWhiteTurn, firstLayerWeights[64 * 8 + index]);
-            add_8_int16(inputBlackTurn, firstLayerInvertedWeights[64 * 8 + index]);
+            initializeNNUEInput<Layers>(position);
+            return;
         }
+        int ply{position.getPly()};
+        int computedPly{ply};
+        while (computedPly > 0 && not position.getAccumulator(computedPly).computed)
+            computedPly--;
 
-        for (unsigned short index : getBitIndices(position.getBlackQueensBits()))
+        for (int i = computedPly + 1; i <= ply; ++i)
         {
-            add_8_int16(inputWhiteTurn, firstLayerWeights[64 * 9 + index]);
-            add_8_int16(inputBlackTurn, firstLayerInvertedWeights[64 * 9 + index]);
+            const Accumulator &parent{position.getAccumulator(i - 1)};
+            Accumulator &accumulator{position.getAccumulator(i)};
+            std::memcpy(accumulator.inputWhiteTurn, parent.inputWhiteTurn, sizeof(int16_t) * Layers::ACCUMULATOR_SIZE);
+            std::memcpy(accumulator.inputBlackTurn, parent.inputBlackTurn, sizeof(int16_t) * Layers::ACCUMULATOR_SIZE);
+            for (int j = 0; j < accumulator.numRemoved; ++j)
+                removeFeature<Layers>(accumulator, accumulator.removed[j]);
+            for (int j = 0; j < accumulator.numAdded; ++j)
+                addFeature<Layers>(accumulator, accumulator.added[j]);
+            accumulator.computed = true;
         }
-        int whiteKingPos{position.getWhiteKingPosition()};
-        int blackKingPos{position.getBlackKingPosition()};
+    }
 
-        std::memcpy(secondLayer1WeightsBlockWhiteTurn, secondLayer1Weights[whiteKingPos], sizeof(secondLayer1Weights[whiteKingPos]));
-        std::memcpy(secondLayer1WeightsBlockBlackTurn, secondLayer1Weights[invertIndex(blackKingPos)], sizeof(secondLayer1Weights[invertIndex(blackKingPos)]));
-        std::memcpy(secondLayer2WeightsBlockWhiteTurn, secondLayer2Weights[blackKingPos], sizeof(secondLayer2Weights[blackKingPos]));
-        std::memcpy(secondLayer2WeightsBlockBlackTurn, secondLayer2Weights[invertIndex(whiteKingPos)], sizeof(secondLayer2Weights[invertIndex(whiteKingPos)]));
+    // The layer sizes this build evaluates
+    template int16_t evaluationFunction<NnueuLayers8>(BitPosition &position, bool ourTurn);
+    template int16_t evaluationFunction<NnueuLayers256>(BitPosition &position, bool ourTurn);
+    template int16_t evaluationFunction<NnueuLayers512>(BitPosition &position, bool ourTurn);
+    template void initializeNNUEInput<NnueuLayers8>(BitPosition &position);
+    template void initializeNNUEInput<NnueuLayers256>(BitPosition &position);
+    template void initializeNNUEInput<NnueuLayers512>(BitPosition &position);
+    template void updateAccumulator<NnueuLayers8>(BitPosition &position);
+    template void updateAccumulator<NnueuLayers256>(BitPosition &position);
+    template void updateAccumulator<NnueuLayers512>(BitPosition &position);
+
+    int16_t evaluationFunction(BitPosition &position, bool ourTurn)
+    {
+        return withLayers(layerSizes, [&](auto layers)
+                          { return evaluationFunction<decltype(layers)>(position, ourTurn); });
     }
 
-    // Helper functions to update the input vector
-    // They are used in bitposition.cpp inside makeNormalMove, makeCapture, setPiece and removePiece.
-    void addOnInput(int whiteKingPosition, int blackKingPosition, int subIndex)
+    void initializeNNUEInput(BitPosition &position)
     {
-        // White turn (use normal NNUE)
-        add_8_int16(inputWhiteTurn, firstLayerWeights[subIndex]);
-        // Black turn (use inverted NNUE)
-        add_8_int16(inputBlackTurn, firstLayerInvertedWeights[subIndex]);
+        withLayers(layerSizes, [&](auto layers)
+                   { initializeNNUEInput<decltype(layers)>(position); });
     }
-    void removeOnInput(int whiteKingPosition, int blackKingPosition, int subIndex)
+
+    void updateAccumulator(BitPosition &position)
     {
-        // White turn (use normal NNUE)
-        substract_8_int16(inputWhiteTurn, firstLayerWeights[subIndex]);
-        // Black turn (use inverted NNUE)
-        substract_8_int16(inputBlackTurn, firstLayerInvertedWeights[subIndex]);
+        withLayers(layerSizes, [&](auto layers)
+                   { updateAccumulator<decltype(layers)>(position); });
     }
-    // Move King functions to update nnueInput vector
-    void moveWhiteKingNNUEInput(BitPosition &position)
+} // namespace NNUEU
+
+namespace Evaluation
+{
+    // Architecture of the network the search evaluates with
+    NNUEFile::Architecture architecture{NNUEFile::NNUEU};
+
+    NNUEFile::Architecture getArchitecture()
     {
-        int whiteKingPos{position.getWhiteKingPosition()};
-        std::memcpy(secondLayer1WeightsBlockWhiteTurn, secondLayer1Weights[whiteKingPos], 32);
-        std::memcpy(secondLayer2WeightsBlockBlackTurn, secondLayer2Weights[invertIndex(whiteKingPos)], 32);
+        return architecture;
     }
-    void moveBlackKingNNUEInput(BitPosition &position)
+
+    bool loadDefaultNetwork()
     {
-        int blackKingPos{position.getBlackKingPosition()};
-        std::memcpy(secondLayer2WeightsBlockWhiteTurn, secondLayer2Weights[blackKingPos], 32);
-        std::memcpy(secondLayer1WeightsBlockBlackTurn, secondLayer1Weights[invertIndex(blackKingPos)], 32);
+        if (not NNUEU::initNNUEParameters())
+            return false;
+        architecture = NNUEFile::NNUEU;
+        return true;
     }
-} // namespace NNUEU
+
+    bool loadNetwork(const std::string &path)
+    // The header tells which architecture loads the file. The current network stays in use if it is not valid.
+    {
+        NNUEFile::Header header;
+        if (not NNUEFile::readHeader(path, header))
+            return false;
+
+        switch (header.architecture)
+        {
+        case NNUEFile::HALFKP:
+            if (not NNUE::initNNUEParameters(path))
+                return false;
+            break;
+        case NNUEFile::NNUEU:
+            if (not NNUEU::initNNUEParameters(path))
+                return false;
+            break;
+        default:
+            std::cerr << "Invalid network " << path << ": unknown architecture" << std::endl;
+            return false;
+        }
+        architecture = static_cast<NNUEFile::Architecture>(header.architecture);
+        return true;
+    }
+
+    void initializeNNUEInput(BitPosition &position)
+    {
+        withEvaluator([&](auto evaluator)
+                      { decltype(evaluator)::initializeNNUEInput(position); });
+    }
+
+    void updateAccumulator(BitPosition &position)
+    {
+        withEvaluator([&](auto evaluator)
+                      { decltype(evaluator)::updateAccumulator(position); });
+    }
+
+    int16_t evaluationFunction(BitPosition &position, bool ourTurn)
+    {
+        return withEvaluator([&](auto evaluator)
+                             { return decltype(evaluator)::evaluationFunction(position, ourTurn); });
+    }
+} // namespace Evaluation
@@ -2,89 +2,162 @@
 #define POSITION_EVAL_H
 
 #include <vector>
+#include <string>
 #include "bitposition.h"
+#include "nnue_file.h"
+#include "simd.h"
 #include <cstdint>
 
 
 namespace NNUE
 {
-    // Global variables for NNUE parameters
-    extern int16_t whiteInputTurn[8];
-    extern int16_t blackInputTurn[8];
-    extern int16_t whiteInputNotTurn[8];
-    extern int16_t blackInputNotTurn[8];
-
-    extern int16_t firstLayer1Weights[40960][8];
-    extern int16_t firstLayer2Weights[40960][8];
-    extern int16_t firstLayer1InvertedWeights[40960][8];
-    extern int16_t firstLayer2InvertedWeights[40960][8];
-
-    extern int8_t secondLayerWeights[16 * 8];
-    extern int8_t thirdLayerWeights[8 * 4];
-    extern int8_t finalLayerWeights[4];
-
-    extern int16_t firstLayer1Biases[8];
-    extern int16_t firstLayer2Biases[8];
-    extern int16_t secondLayerBiases[8];
-    extern int16_t thirdLayerBiases[4];
-    extern int16_t finalLayerBias;
-
-    // Declare the initialization function
-    void initNNUEParameters();
+    // Global variables for NNUE parameters, pointing into the network file once it is loaded (read only).
+    // The accumulators live in each BitPosition.
+    extern const int16_t (*firstLayer1Weights)[8];
+    extern const int16_t (*firstLayer2Weights)[8];
 
-    // Declare the neural network processing functions
-    int16_t evaluationFunction(bool ourTurn);
-
-    // Declare function to initialize the whiteInput and blackInput
-    void initializeNNUEInput(const BitPosition position);
-
-    // Declare functions to update efficiently NNUE input
-    void addOnInput(int whiteKingPosition, int blackKingPosition, int subIndex);
-    void removeOnInput(int whiteKingPosition, int blackKingPosition, int subIndex);
-    void moveWhiteKingNNUEInput(BitPosition &position);
-    void moveBlackKingNNUEInput(BitPosition &position);
-}
+    extern const int8_t *secondLayerWeights;
+    extern const int8_t *thirdLayerWeights;
+    extern const int8_t *finalLayerWeights;
 
-namespace NNUEU
-{
-    // Global variables for NNUEU parameters
-    extern int16_t inputWhiteTurn[8];
-    extern int16_t inputBlackTurn[8];
+    extern const int16_t *firstLayer1Biases;
+    extern const int16_t *firstLayer2Biases;
+    extern const int16_t *secondLayerBiases;
+    extern const int16_t *thirdLayerBiases;
+    extern const int16_t *finalLayerBias;
 
-    extern int16_t firstLayerWeights[640][8];
-    extern int16_t firstLayerInvertedWeights[640][8];
+    // Declare the initialization functions, they load the default network or a network file and return
+    // whether it could be loaded
+    bool initNNUEParameters();
+    bool initNNUEParameters(const std::string &path);
 
-    extern int8_t secondLayer1Weights[64][8 * 4];
-    extern int8_t secondLayer2Weights[64][8 * 4];
+    // Declare the function to write a network file from the CSV files of a model directory
+    bool convertNetwork(const std::string &modelDir, const std::string &path);
 
-    extern int8_t secondLayer1WeightsBlockWhiteTurn[8 * 4];
-    extern int8_t secondLayer2WeightsBlockWhiteTurn[8 * 4];
-    extern int8_t secondLayer1WeightsBlockBlackTurn[8 * 4];
-    extern int8_t secondLayer2WeightsBlockBlackTurn[8 * 4];
+    // Declare the neural network processing functions
+    int16_t evaluationFunction(BitPosition &position, bool ourTurn);
 
-    extern int8_t thirdLayerWeights[8 * 4];
-    extern int8_t finalLayerWeights[4];
+    // Declare function to initialize the accumulators of a position
+    void initializeNNUEInput(BitPosition &position);
 
-    extern int16_t firstLayerBiases[8];
-    extern int16_t secondLayer1Biases[4];
-    extern int16_t secondLayer2Biases[4];
-    extern int16_t thirdLayerBiases[4];
-    extern int16_t finalLayerBias;
+    // Declare function to apply the NNUE input changes recorded by makeMove, refreshing the perspective of a king
+    // that moved through the refresh cache
+    void updateAccumulator(BitPosition &position);
+}
 
-    // Declare the initialization function
-    void initNNUEParameters();
+namespace NNUEU
+{
+    // Global variables for NNUEU parameters, pointing into the network file once it is loaded (read only).
+    // The accumulators live in each BitPosition. The arrays are flat, sized by the loaded network's NnueuLayers.
+
+    extern const int16_t *firstLayerWeights; // [640][ACCUMULATOR_SIZE]
+
+    // [64][KING_BLOCK_SIZE], one block for each king square. Interleaved as the third layer weights for networks
+    // wider than 8-8-4 (see interleaveWeights).
+    extern const int8_t *secondLayer1Weights;
+    extern const int8_t *secondLayer2Weights;
+
+    extern const int8_t *thirdLayerWeights;
+    extern const int8_t *finalLayerWeights;
+
+    extern const int16_t *firstLayerBiases;
+    extern const int16_t *secondLayerBiases;
+    extern const int16_t *thirdLayerBiases;
+    extern const int16_t *finalLayerBias;
+
+    // Layer sizes of the loaded network, one of the NnueuLayers in simd.h
+    enum LayerSizes
+    {
+        LAYERS_8,   // NnueuLayers8
+        LAYERS_256, // NnueuLayers256
+        LAYERS_512  // NnueuLayers512
+    };
+    LayerSizes getLayerSizes();
+
+    // Declare the initialization functions, they load the network embedded in the executable (the default network
+    // file if it was built without one) or a network file of any of the layer sizes above, and return whether it
+    // could be loaded
+    bool initNNUEParameters();
+    bool initNNUEParameters(const std::string &path);
+
+    // Declare the function to write a network file from the CSV files of a model directory
+    bool convertNetwork(const std::string &modelDir, const std::string &path);
+
+    // Declare the neural network processing functions, for the layer sizes of the loaded network
+    template <typename Layers>
+    int16_t evaluationFunction(BitPosition &position, bool ourTurn);
+
+    // Declare function to initialize the accumulators of a position
+    template <typename Layers>
+    void initializeNNUEInput(BitPosition &position);
+
+    // Declare function to apply the NNUE input changes recorded by makeMove
+    template <typename Layers>
+    void updateAccumulator(BitPosition &position);
+
+    // Same, choosing the layer sizes of the loaded network at runtime (for tests and tools)
+    int16_t evaluationFunction(BitPosition &position, bool ourTurn);
+    void initializeNNUEInput(BitPosition &position);
+    void updateAccumulator(BitPosition &position);
+}
 
-    // Declare the neural network processing functions
-    int16_t evaluationFunction(bool ourTurn);
+// Evaluators, the search is instantiated once for each (see engine.cpp) so that evaluating is a direct call.
+// makeMove only records feature changes, which both nets read the same way, so it needs no instantiation.
+struct NNUEEvaluator
+{
+    static constexpr NNUEFile::Architecture ARCHITECTURE{NNUEFile::HALFKP};
+    // Whether quiesenceSearch looks evaluations up in the evaluation cache (nnue_ttable.h). The forward pass of an
+    // 8 wide network costs less than the cache miss of a probe, so only wider networks use it.
+    static constexpr bool USE_EVAL_CACHE{false};
+
+    static int16_t evaluationFunction(BitPosition &position, bool ourTurn) { return NNUE::evaluationFunction(position, ourTurn); }
+    static void initializeNNUEInput(BitPosition &position) { NNUE::initializeNNUEInput(position); }
+    static void updateAccumulator(BitPosition &position) { NNUE::updateAccumulator(position); }
+};
+
+// One NNUEU evaluator for each layer sizes, so that the accumulator updates and forward pass are unrolled for them
+template <typename Layers>
+struct NNUEUEvaluator
+{
+    static constexpr NNUEFile::Architecture ARCHITECTURE{NNUEFile::NNUEU};
+    static constexpr bool USE_EVAL_CACHE{Layers::ACCUMULATOR_SIZE > 8};
 
-    // Declare function to initialize the inputWhiteTurn and inputBlackTurn
-    void initializeNNUEInput(const BitPosition position);
+    static int16_t evaluationFunction(BitPosition &position, bool ourTurn) { return NNUEU::evaluationFunction<Layers>(position, ourTurn); }
+    static void initializeNNUEInput(BitPosition &position) { NNUEU::initializeNNUEInput<Layers>(position); }
+    static void updateAccumulator(BitPosition &position) { NNUEU::updateAccumulator<Layers>(position); }
+};
 
-    // Declare functions to update efficiently NNUE input
-    void addOnInput(int whiteKingPosition, int blackKingPosition, int subIndex);
-    void removeOnInput(int whiteKingPosition, int blackKingPosition, int subIndex);
-    void moveWhiteKingNNUEInput(BitPosition &position);
-    void moveBlackKingNNUEInput(BitPosition &position);
+namespace Evaluation
+{
+    // The network in use, chosen from the header of the loaded network file. Outside of the search, positions are
+    // initialized and evaluated through the functions below, which call the evaluator of that architecture.
+
+    NNUEFile::Architecture getArchitecture();
+
+    // Load the default network (NNUEU) or a network file of any architecture, and return whether it could be loaded
+    bool loadDefaultNetwork();
+    bool loadNetwork(const std::string &path);
+
+    void initializeNNUEInput(BitPosition &position);
+    void updateAccumulator(BitPosition &position);
+    int16_t evaluationFunction(BitPosition &position, bool ourTurn);
+
+    // Calls function with the evaluator of the loaded network, e.g. to instantiate the search for it
+    template <typename Function>
+    auto withEvaluator(Function &&function)
+    {
+        if (getArchitecture() == NNUEFile::HALFKP)
+            return function(NNUEEvaluator{});
+        switch (NNUEU::getLayerSizes())
+        {
+        case NNUEU::LAYERS_256:
+            return function(NNUEUEvaluator<NnueuLayers256>{});
+        case NNUEU::LAYERS_512:
+            return function(NNUEUEvaluator<NnueuLayers512>{});
+        default:
+            return function(NNUEUEvaluator<NnueuLayers8>{});
+        }
+    }
 }
 
 #endif // POSITION_EVAL_H
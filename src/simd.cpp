@@ -1,9 +1,13 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <limits.h>
+#include <string.h>
+#include "simd.h"
 
-#ifdef __ARM_NEON
+#if defined(__ARM_NEON)
 #include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <immintrin.h>
 #endif
 
 
@@ -11,6 +15,22 @@
 // NNUE
 ////////////////
 
+// Portable versions of the kernels. They are the reference every SIMD backend is tested against
+// (see runSimdBackendsTest in tests.h) and the fallback on CPUs without a SIMD backend.
+// Casting back to int16_t wraps modulo 2^16 exactly as the NEON lanes do.
+
+static void add_8_int16Scalar(int16_t *a, const int16_t *b)
+{
+    for (int i = 0; i < 8; ++i)
+        a[i] = static_cast<int16_t>(a[i] + b[i]);
+}
+
+static void substract_8_int16Scalar(int16_t *a, const int16_t *b)
+{
+    for (int i = 0; i < 8; ++i)
+        a[i] = static_cast<int16_t>(a[i] - b[i]);
+}
+
 void add_8_int16(int16_t *a, const int16_t *b)
 {
 #if defined(__ARM_NEON)
@@ -19,14 +39,16 @@ void add_8_int16(int16_t *a, const int16_t *b)
 
     vst1q_s16(a, vaddq_s16(v1, v2)); // Store the result back to array a
 
-#elif defined(__AVX512BW__) || defined(__AVX512CD__) || defined(__AVX512DQ__) || defined(__AVX512F__) || defined(__AVX512VL__)
-
-#elif defined(__AVX2__) || defined(__AVX__)
+#elif defined(__SSE2__)
+    // 8 int16_t values fill exactly one 128 bit register, so wider AVX2/AVX-512 registers would only
+    // be half used. The SSE2 add is the fastest choice on every x86 extension (VEX encoded under AVX).
+    __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a)); // Load 8 int16_t values from array a
+    __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b)); // Load 8 int16_t values from array b
 
-#elif defined(__SSSE3__) || defined(__SSE4_1__)
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(a), _mm_add_epi16(v1, v2)); // Wrapping add as vaddq_s16
 
 #else
-
+    add_8_int16Scalar(a, b);
 #endif
 }
 
@@ -38,21 +60,251 @@ void substract_8_int16(int16_t *a, const int16_t *b) // For NNUE accumulation
 
     vst1q_s16(a, vsubq_s16(v1, v2)); // Store the result back to array a
 
-#elif defined(__AVX512BW__) || defined(__AVX512CD__) || defined(__AVX512DQ__) || defined(__AVX512F__) || defined(__AVX512VL__)
-
-#elif defined(__AVX2__) || defined(__AVX__)
+#elif defined(__SSE2__)
+    __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a)); // Load 8 int16_t values from array a
+    __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b)); // Load 8 int16_t values from array b
 
-#elif defined(__SSSE3__) || defined(__SSE4_1__)
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(a), _mm_sub_epi16(v1, v2)); // Wrapping subtract as vsubq_s16
 
 #else
-
+    substract_8_int16Scalar(a, b);
 #endif
 }
 
-int16_t fullNnuePass(int16_t *pInput1, int16_t *pInput2, int8_t *pWeights1, int16_t *pBias1,
-                   int8_t *pWeights2, int16_t *pBias2, int8_t *pWeights3, int16_t *pBias3)
+template <int Size>
+void add_int16(int16_t *a, const int16_t *b)
+{
+    for (int i = 0; i < Size; i += 8)
+        add_8_int16(a + i, b + i);
+}
+
+template <int Size>
+void substract_int16(int16_t *a, const int16_t *b)
+{
+    for (int i = 0; i < Size; i += 8)
+        substract_8_int16(a + i, b + i);
+}
+
+template void add_int16<NnueuLayers8::ACCUMULATOR_SIZE>(int16_t *a, const int16_t *b);
+template void add_int16<NnueuLayers256::ACCUMULATOR_SIZE>(int16_t *a, const int16_t *b);
+template void add_int16<NnueuLayers512::ACCUMULATOR_SIZE>(int16_t *a, const int16_t *b);
+template void substract_int16<NnueuLayers8::ACCUMULATOR_SIZE>(int16_t *a, const int16_t *b);
+template void substract_int16<NnueuLayers256::ACCUMULATOR_SIZE>(int16_t *a, const int16_t *b);
+template void substract_int16<NnueuLayers512::ACCUMULATOR_SIZE>(int16_t *a, const int16_t *b);
+
+////////////////
+// NNUE forward passes
+////////////////
+
+// This function should pass using simd instructions an array of 16 int16's through a neural network.
+// There are two first layers of 8 by 4 each taking the same input, after concatenating the outputs of both first layers, 
+// the second layer is 8 by 4, the third layer is 4 by 1.
+
+// the input is int16, and the weights are int8. So before multiplying we reduce int16 to int8, by clipping to max int8.
+// We also clip negatives to zero before each layer pass.
+
+// Scalar
+
+static int8_t clipToInt8Scalar(int16_t value)
+// Saturating narrow to int8 followed by ReLU, as vmax_s8(vqmovn_s16(value), 0)
+{
+    return static_cast<int8_t>(value < 0 ? 0 : (value > 127 ? 127 : value));
+}
+
+static int16_t secondAndThirdLayersScalar(const int16_t *output1, const int8_t *pWeights2, const int16_t *pBias2,
+                                          const int8_t *pWeights3, const int16_t *pBias3)
+{
+    // Layer 2
+    int8_t input2[8];
+    for (int j = 0; j < 8; ++j)
+        input2[j] = clipToInt8Scalar(output1[j]);
+
+    int8_t input3[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        int sum = 0;
+        for (int j = 0; j < 8; ++j)
+            sum += input2[j] * pWeights2[i * 8 + j];
+        int16_t temp = static_cast<int16_t>(static_cast<int16_t>(sum) + pBias2[i]);
+        input3[i] = clipToInt8Scalar(static_cast<int16_t>(temp >> 6));
+    }
+
+    // Layer 3
+    int sum = 0;
+    for (int j = 0; j < 4; ++j)
+        sum += input3[j] * pWeights3[j];
+
+    return static_cast<int16_t>(static_cast<int16_t>(sum) + pBias3[0]);
+}
+
+static int16_t fullNnuePassScalar(const int16_t *pInput1, const int16_t *pInput2, const int8_t *pWeights1, const int16_t *pBias1,
+                                  const int8_t *pWeights2, const int16_t *pBias2, const int8_t *pWeights3, const int16_t *pBias3)
+{
+    int8_t input[16];
+    for (int j = 0; j < 8; ++j)
+    {
+        input[j] = clipToInt8Scalar(pInput1[j]);
+        input[j + 8] = clipToInt8Scalar(pInput2[j]);
+    }
+
+    // Layer 1
+    int16_t output1[8];
+    for (int i = 0; i < 8; ++i)
+    {
+        int sum = 0;
+        for (int j = 0; j < 16; ++j)
+            sum += input[j] * pWeights1[i * 16 + j];
+        int16_t temp = static_cast<int16_t>(static_cast<int16_t>(sum) + pBias1[i]);
+        output1[i] = static_cast<int16_t>(temp < 0 ? 0 : temp >> 6);
+    }
+
+    // Layers 2 and 3
+    return secondAndThirdLayersScalar(output1, pWeights2, pBias2, pWeights3, pBias3);
+}
+
+static int16_t fullNnueuPassScalar(const int16_t *pInput, const int8_t *pWeights11, const int8_t *pWeights12, const int16_t *pBias1,
+                                   const int8_t *pWeights2, const int16_t *pBias2, const int8_t *pWeights3, const int16_t *pBias3)
 {
+    // Layer 0
+    int8_t input[8];
+    for (int j = 0; j < 8; ++j)
+        input[j] = clipToInt8Scalar(pInput[j]);
+
+    // Layer 1
+    int16_t output1[8];
+    for (int i = 0; i < 8; ++i)
+    {
+        const int8_t *weights = i < 4 ? pWeights11 + i * 8 : pWeights12 + (i - 4) * 8;
+        int sum = 0;
+        for (int j = 0; j < 8; ++j)
+            sum += input[j] * weights[j];
+        int16_t temp = static_cast<int16_t>(static_cast<int16_t>(sum) + pBias1[i]);
+        output1[i] = static_cast<int16_t>(temp < 0 ? 0 : temp >> 6);
+    }
+
+    // Layers 2 and 3
+    return secondAndThirdLayersScalar(output1, pWeights2, pBias2, pWeights3, pBias3);
+}
+
+
+// Generated NNUEU forward passes, for the layer sizes of any NnueuLayers but 8-8-4. Wide layers would overflow the
+// int16 sums of the 8-8-4 kernels, so sums are kept in int32. Each layer adds its biases, shifts right by 6 and
+// clips to [0, 127], and the next layer reads those bytes. Every loop runs a compile time number of times, so the
+// compiler unrolls it for each size.
+//
+// The second and third layers read their weights interleaved by groups of 4 inputs (see interleaveWeights), so
+// that SIMD backends sum every output in its own lane instead of reducing one row at a time.
+
+void interleaveWeights(const int8_t *rows, int8_t *interleaved, int in, int out)
+{
+    for (int i = 0; i < out; ++i)
+        for (int j = 0; j < in; ++j)
+            interleaved[j / 4 * out * 4 + i * 4 + j % 4] = rows[i * in + j];
+}
+
+static inline uint8_t hiddenActivation(int32_t sum)
+{
+    sum >>= 6;
+    return static_cast<uint8_t>(sum < 0 ? 0 : (sum > 127 ? 127 : sum));
+}
+
+static inline int16_t saturateToInt16(int32_t value)
+{
+    return static_cast<int16_t>(value < INT16_MIN ? INT16_MIN : (value > INT16_MAX ? INT16_MAX : value));
+}
+
+template <typename Layers>
+static constexpr bool hasGeneratedKernels()
+{
+    // Kernels clip the accumulator and read the final layer 16 bytes at a time, and write 8 outputs at a time
+    return Layers::ACCUMULATOR_SIZE % 16 == 0 && Layers::HIDDEN_SIZE_1 / 2 % 8 == 0 && Layers::HIDDEN_SIZE_2 % 16 == 0;
+}
+
+// Fully unrolls a loop over the accumulator registers of a layer, so that they stay in registers instead of an
+// array on the stack
+#define UNROLL_REGISTERS _Pragma("GCC unroll 16")
+
+static inline int32_t inputGroup(const uint8_t *input)
+// 4 consecutive inputs as one 32 bit lane
+{
+    int32_t group;
+    memcpy(&group, input, sizeof(group));
+    return group;
+}
+
+template <int In>
+static int32_t dotProductScalar(const uint8_t *input, const int8_t *weights)
+{
+    int32_t sum = 0;
+    for (int j = 0; j < In; ++j)
+        sum += input[j] * weights[j];
+    return sum;
+}
+
+template <int In, int Out>
+static void affineLayerScalar(const uint8_t *input, const int8_t *weights, const int16_t *bias, uint8_t *output)
+// Weights interleaved by groups of 4 inputs, the weights of group j / 4 start at j * Out
+{
+    int32_t sums[Out];
+    for (int i = 0; i < Out; ++i)
+        sums[i] = bias[i];
+    for (int j = 0; j < In; j += 4)
+    {
+        const int8_t *group = weights + j * Out;
+        for (int i = 0; i < Out; ++i)
+            sums[i] += input[j] * group[4 * i] + input[j + 1] * group[4 * i + 1] + input[j + 2] * group[4 * i + 2] +
+                       input[j + 3] * group[4 * i + 3];
+    }
+    for (int i = 0; i < Out; ++i)
+        output[i] = hiddenActivation(sums[i]);
+}
+
+template <typename Layers>
+static int16_t nnueuPassScalar(const int16_t *pInput, const int8_t *pWeights11, const int8_t *pWeights12, const int16_t *pBias1,
+                               const int8_t *pWeights2, const int16_t *pBias2, const int8_t *pWeights3, const int16_t *pBias3)
+{
+    constexpr int ACCUMULATOR_SIZE = Layers::ACCUMULATOR_SIZE;
+    constexpr int HIDDEN_SIZE_1 = Layers::HIDDEN_SIZE_1;
+    constexpr int HIDDEN_SIZE_2 = Layers::HIDDEN_SIZE_2;
+
+    // Layer 0
+    uint8_t input[ACCUMULATOR_SIZE];
+    for (int j = 0; j < ACCUMULATOR_SIZE; ++j)
+        input[j] = static_cast<uint8_t>(clipToInt8Scalar(pInput[j]));
+
+    // Layer 1, each king square gives half of the outputs
+    uint8_t output1[HIDDEN_SIZE_1];
+    affineLayerScalar<ACCUMULATOR_SIZE, HIDDEN_SIZE_1 / 2>(input, pWeights11, pBias1, output1);
+    affineLayerScalar<ACCUMULATOR_SIZE, HIDDEN_SIZE_1 / 2>(input, pWeights12, pBias1 + HIDDEN_SIZE_1 / 2, output1 + HIDDEN_SIZE_1 / 2);
+
+    // Layers 2 and 3
+    uint8_t output2[HIDDEN_SIZE_2];
+    affineLayerScalar<HIDDEN_SIZE_1, HIDDEN_SIZE_2>(output1, pWeights2, pBias2, output2);
+    return saturateToInt16(pBias3[0] + dotProductScalar<HIDDEN_SIZE_2>(output2, pWeights3));
+}
+
 #if defined(__ARM_NEON)
+
+// The 8-8-4 layers are summed with wrapping int16 lanes. Instead of a horizontal add (vaddvq_s16) for each output,
+// which serializes on the reduction unit, rounds of pairwise adds sum every row of a layer at once and leave row
+// i's sum in lane i. Wrapping sums don't depend on the order, so the results are those of the row by row sums.
+
+static inline int16x8_t sumRowsOf8NEON(const int16x8_t rows[8])
+{
+    int16x8_t sums0123 = vpaddq_s16(vpaddq_s16(rows[0], rows[1]), vpaddq_s16(rows[2], rows[3]));
+    int16x8_t sums4567 = vpaddq_s16(vpaddq_s16(rows[4], rows[5]), vpaddq_s16(rows[6], rows[7]));
+    return vpaddq_s16(sums0123, sums4567);
+}
+
+static inline int16x4_t sumRowsOf4NEON(const int16x8_t rows[4])
+{
+    int16x8_t sums = vpaddq_s16(vpaddq_s16(rows[0], rows[1]), vpaddq_s16(rows[2], rows[3]));
+    return vget_low_s16(vpaddq_s16(sums, sums));
+}
+
+static int16_t fullNnuePassNEON(const int16_t *pInput1, const int16_t *pInput2, const int8_t *pWeights1, const int16_t *pBias1,
+                                const int8_t *pWeights2, const int16_t *pBias2, const int8_t *pWeights3, const int16_t *pBias3)
+{
     // Load 8 int16_t elements from the array into a NEON register
     int16x8_t vector1 = vld1q_s16(pInput1);
     int16x8_t vector2 = vld1q_s16(pInput2);
@@ -73,13 +325,13 @@ int16_t fullNnuePass(int16_t *pInput1, int16_t *pInput2, int8_t *pWeights1, int1
         weight1[i][1] = vld1_s8(pWeights1 + i * 16 + 8);
     }
     // Compute first layer output
-    int16x8_t output1 = {0};
+    int16x8_t products1[8];
     for (int i = 0; i < 8; ++i)
     {
-        int16x8_t col = vaddq_s16(vmull_s8(clipped_vector1, weight1[i][0]),
-                                  vmull_s8(clipped_vector2, weight1[i][1]));
-        output1[i] = vaddvq_s16(col); // Horizontal sum of all 8 elements
+        products1[i] = vaddq_s16(vmull_s8(clipped_vector1, weight1[i][0]),
+                                 vmull_s8(clipped_vector2, weight1[i][1]));
     }
+    int16x8_t output1 = sumRowsOf8NEON(products1);
     // Load first layer biases
     int16x8_t bias1 = vld1q_s16(pBias1);
     // Add biases apply 6bit shift and then apply ReLU activation
@@ -97,14 +349,14 @@ int16_t fullNnuePass(int16_t *pInput1, int16_t *pInput2, int8_t *pWeights1, int1
     }
 
     int16x4_t bias2 = vld1_s16(pBias2);
-    int16x4_t output2;
 
     // Perform the computations
+    int16x8_t products2[4];
     for (int i = 0; i < 4; ++i)
     {
-        int16_t temp = vaddvq_s16(vmull_s8(input2, weight2[i])) + bias2[i];
-        output2[i] = temp >> 6; // Store the result in the array
+        products2[i] = vmull_s8(input2, weight2[i]);
     }
+    int16x4_t output2 = vshr_n_s16(vadd_s16(sumRowsOf4NEON(products2), bias2), 6);
 
     // Apply ReLU activation
     output2 = vmax_s16(output2, vdup_n_s16(0));
@@ -119,30 +371,11 @@ int16_t fullNnuePass(int16_t *pInput1, int16_t *pInput2, int8_t *pWeights1, int1
     int16_t output3 = vaddvq_s16(vmull_s8(input3, weight3)) + bias3;
 
     return output3;
-
-#elif defined(__AVX512BW__) || defined(__AVX512CD__) || defined(__AVX512DQ__) || defined(__AVX512F__) || defined(__AVX512VL__)
-
-#elif defined(__AVX2__) || defined(__AVX__)
-
-#elif defined(__SSSE3__) || defined(__SSE4_1__)
-
-#else
-
-#endif
 }
 
-
-int16_t fullNnueuPass(int16_t *pInput, int8_t *pWeights11, int8_t *pWeights12, int16_t *pBias1,
-                     int8_t *pWeights2, int16_t *pBias2, int8_t *pWeights3, int16_t *pBias3)
-
-// This function should pass using simd instructions an array of 16 int16's through a neural network.
-// There are two first layers of 8 by 4 each taking the same input, after concatenating the outputs of both first layers, 
-// the second layer is 8 by 4, the third layer is 4 by 1.
-
-// the input is int16, and the weights are int8. So before multiplying we reduce int16 to int8, by clipping to max int8.
-// We also clip negatives to zero before each layer pass.
+static int16_t fullNnueuPassNEON(const int16_t *pInput, const int8_t *pWeights11, const int8_t *pWeights12, const int16_t *pBias1,
+                                 const int8_t *pWeights2, const int16_t *pBias2, const int8_t *pWeights3, const int16_t *pBias3)
 {
-#if defined(__ARM_NEON)
     // Layer 0
     int16x8_t input_vector = vld1q_s16(pInput);               // Load 8 int16_t elements into an int16x8_t
     int8x8_t narrowed_vector = vqmovn_s16(input_vector);      // Narrow to int8x8_t with saturation
@@ -156,11 +389,12 @@ int16_t fullNnueuPass(int16_t *pInput, int8_t *pWeights11, int8_t *pWeights12, i
         weight1[i + 4] = vld1_s8(pWeights12 + i * 8);
     }
 
-    int16x8_t output1 = {0};
+    int16x8_t products1[8];
     for (int i = 0; i < 8; ++i)
     {
-        output1[i] = vaddvq_s16(vmull_s8(vector, weight1[i]));
+        products1[i] = vmull_s8(vector, weight1[i]);
     }
+    int16x8_t output1 = sumRowsOf8NEON(products1);
 
     int16x8_t bias1 = vld1q_s16(pBias1);
     output1 = vmaxq_s16(vshrq_n_s16(vaddq_s16(bias1, output1), 6), vdupq_n_s16(0));
@@ -176,14 +410,14 @@ int16_t fullNnueuPass(int16_t *pInput, int8_t *pWeights11, int8_t *pWeights12, i
     }
 
     int16x4_t bias2 = vld1_s16(pBias2);
-    int16x4_t output2;
 
     // Perform the computations
+    int16x8_t products2[4];
     for (int i = 0; i < 4; ++i)
     {
-        int16_t temp = vaddvq_s16(vmull_s8(input2, weight2[i])) + bias2[i];
-        output2[i] = temp >> 6; // Store the result in the array
+        products2[i] = vmull_s8(input2, weight2[i]);
     }
+    int16x4_t output2 = vshr_n_s16(vadd_s16(sumRowsOf4NEON(products2), bias2), 6);
 
     // Apply ReLU activation
     output2 = vmax_s16(output2, vdup_n_s16(0));
@@ -195,14 +429,714 @@ int16_t fullNnueuPass(int16_t *pInput, int8_t *pWeights11, int8_t *pWeights12, i
     int16_t output3 = vaddvq_s16(vmull_s8(input3, weight3)) + bias3;
 
     return output3;
+}
 
-#elif defined(__AVX512BW__) || defined(__AVX512CD__) || defined(__AVX512DQ__) || defined(__AVX512F__) || defined(__AVX512VL__)
-
-#elif defined(__AVX2__) || defined(__AVX__)
+// Generated NNUEU forward pass (see nnueuPassScalar)
 
-#elif defined(__SSSE3__) || defined(__SSE4_1__)
+template <int In>
+static inline int32_t dotProductNEON(const uint8_t *input, const int8_t *weights)
+{
+    int32x4_t sum = vdupq_n_s32(0);
+    for (int j = 0; j < In; j += 16)
+    {
+        // Inputs are at most 127, so two products always fit an int16 lane
+        int8x16_t inputs = vreinterpretq_s8_u8(vld1q_u8(input + j));
+        int8x16_t row = vld1q_s8(weights + j);
+        int16x8_t products = vmull_s8(vget_low_s8(inputs), vget_low_s8(row));
+        products = vmlal_high_s8(products, inputs, row);
+        sum = vpadalq_s16(sum, products);
+    }
+    return vaddvq_s32(sum);
+}
 
+template <int In, int Out>
+static inline void affineLayerNEON(const uint8_t *input, const int8_t *weights, const int16_t *bias, uint8_t *output)
+// Each register sums 4 outputs. Without the dot product extension, the products of outputs 0-1 and 2-3 are added
+// pairwise into two registers, whose lane pairs are added once at the end.
+{
+    constexpr int REGISTERS = Out / 4;
+    int32x4_t sums[REGISTERS];
+#if defined(__ARM_FEATURE_DOTPROD)
+    UNROLL_REGISTERS
+    for (int r = 0; r < REGISTERS; ++r)
+        sums[r] = vdupq_n_s32(0);
+    for (int j = 0; j < In; j += 4)
+    {
+        int8x16_t inputs = vreinterpretq_s8_s32(vdupq_n_s32(inputGroup(input + j)));
+        UNROLL_REGISTERS
+        for (int r = 0; r < REGISTERS; ++r)
+            sums[r] = vdotq_s32(sums[r], inputs, vld1q_s8(weights + j * Out + 16 * r));
+    }
 #else
+    int32x4_t low[REGISTERS];
+    int32x4_t high[REGISTERS];
+    UNROLL_REGISTERS
+    for (int r = 0; r < REGISTERS; ++r)
+    {
+        low[r] = vdupq_n_s32(0);
+        high[r] = vdupq_n_s32(0);
+    }
+    for (int j = 0; j < In; j += 4)
+    {
+        // Inputs are at most 127, so they can be read as signed bytes
+        int8x16_t inputs = vreinterpretq_s8_s32(vdupq_n_s32(inputGroup(input + j)));
+        UNROLL_REGISTERS
+        for (int r = 0; r < REGISTERS; ++r)
+        {
+            int8x16_t block = vld1q_s8(weights + j * Out + 16 * r);
+            low[r] = vpadalq_s16(low[r], vmull_s8(vget_low_s8(inputs), vget_low_s8(block)));
+            high[r] = vpadalq_s16(high[r], vmull_high_s8(inputs, block));
+        }
+    }
+    UNROLL_REGISTERS
+    for (int r = 0; r < REGISTERS; ++r)
+        sums[r] = vpaddq_s32(low[r], high[r]);
+#endif
+    for (int r = 0; r < REGISTERS; r += 2)
+    {
+        int32x4_t biased0 = vaddq_s32(sums[r], vmovl_s16(vld1_s16(bias + 4 * r)));
+        int32x4_t biased1 = vaddq_s32(sums[r + 1], vmovl_s16(vld1_s16(bias + 4 * r + 4)));
+        int16x8_t shifted = vcombine_s16(vqshrn_n_s32(biased0, 6), vqshrn_n_s32(biased1, 6));
+        vst1_u8(output + 4 * r, vmin_u8(vqmovun_s16(shifted), vdup_n_u8(127)));
+    }
+}
+
+template <typename Layers>
+static int16_t nnueuPassNEON(const int16_t *pInput, const int8_t *pWeights11, const int8_t *pWeights12, const int16_t *pBias1,
+                             const int8_t *pWeights2, const int16_t *pBias2, const int8_t *pWeights3, const int16_t *pBias3)
+{
+    static_assert(hasGeneratedKernels<Layers>(), "Layer sizes must fill whole registers");
+    constexpr int ACCUMULATOR_SIZE = Layers::ACCUMULATOR_SIZE;
+    constexpr int HIDDEN_SIZE_1 = Layers::HIDDEN_SIZE_1;
+    constexpr int HIDDEN_SIZE_2 = Layers::HIDDEN_SIZE_2;
+
+    // Layer 0
+    alignas(64) uint8_t input[ACCUMULATOR_SIZE];
+    for (int j = 0; j < ACCUMULATOR_SIZE; j += 16)
+    {
+        int8x16_t narrowed = vcombine_s8(vqmovn_s16(vld1q_s16(pInput + j)), vqmovn_s16(vld1q_s16(pInput + j + 8)));
+        vst1q_u8(input + j, vreinterpretq_u8_s8(vmaxq_s8(narrowed, vdupq_n_s8(0))));
+    }
+
+    // Layer 1, each king square gives half of the outputs
+    alignas(64) uint8_t output1[HIDDEN_SIZE_1];
+    affineLayerNEON<ACCUMULATOR_SIZE, HIDDEN_SIZE_1 / 2>(input, pWeights11, pBias1, output1);
+    affineLayerNEON<ACCUMULATOR_SIZE, HIDDEN_SIZE_1 / 2>(input, pWeights12, pBias1 + HIDDEN_SIZE_1 / 2, output1 + HIDDEN_SIZE_1 / 2);
+
+    // Layers 2 and 3
+    alignas(64) uint8_t output2[HIDDEN_SIZE_2];
+    affineLayerNEON<HIDDEN_SIZE_1, HIDDEN_SIZE_2>(output1, pWeights2, pBias2, output2);
+    return saturateToInt16(pBias3[0] + dotProductNEON<HIDDEN_SIZE_2>(output2, pWeights3));
+}
+
+#elif defined(__x86_64__) || defined(__i386__)
+
+// Every x86 backend is compiled with its own target attribute, so a single binary contains all of them and
+// selectSimdBackend picks the widest one the CPU supports.
+//
+// The NEON code sums int8 x int8 products with wrapping int16 lanes, so every x86 reduction below
+// keeps results modulo 2^16 to stay bit-exact. Inputs are clipped to [0, 127] before each layer, so they can be
+// used as the unsigned operand of _mm_maddubs_epi16, whose pair sums (at most 2 * 127 * 128) never saturate.
+
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx2,avx512f,avx512bw")))
+#define TARGET_AVX512VNNI __attribute__((target("avx2,avx512f,avx512bw,avx512vnni")))
+
+static inline TARGET_SSSE3 __m128i clipToInt8(__m128i v)
+// Saturating narrow of 8 int16 to int8 followed by ReLU, as vmax_s8(vqmovn_s16(v), 0). The 8 bytes are
+// duplicated in both halves of the register so they line up with two 8-byte weight rows.
+{
+    return _mm_packs_epi16(_mm_max_epi16(v, _mm_setzero_si128()), _mm_max_epi16(v, _mm_setzero_si128()));
+}
+
+static inline TARGET_SSSE3 __m128i clipToInt8(const int16_t *pInput1, const int16_t *pInput2)
+// Same as above for the two NNUE accumulators, placed side by side in 16 bytes
+{
+    return _mm_packs_epi16(_mm_max_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pInput1)), _mm_setzero_si128()),
+                           _mm_max_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pInput2)), _mm_setzero_si128()));
+}
+
+static inline TARGET_SSSE3 __m128i firstLayerActivation(__m128i output1, const int16_t *pBias1)
+// Add biases, apply 6bit shift and then apply ReLU activation
+{
+    __m128i bias1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pBias1));
+    return _mm_max_epi16(_mm_srai_epi16(_mm_add_epi16(bias1, output1), 6), _mm_setzero_si128());
+}
+
+static inline TARGET_SSSE3 int16_t secondAndThirdLayers(__m128i output1, const int8_t *pWeights2, const int16_t *pBias2,
+                                                        const int8_t *pWeights3, const int16_t *pBias3)
+// Layers 2 (8 -> 4) and 3 (4 -> 1) are too small for wider registers, so every x86 backend uses SSSE3 here.
+{
+    // Layer 2
+    __m128i input2 = _mm_packs_epi16(output1, output1); // output1 is already non negative
+    __m128i rows01 = _mm_maddubs_epi16(input2, _mm_loadu_si128(reinterpret_cast<const __m128i *>(pWeights2)));
+    __m128i rows23 = _mm_maddubs_epi16(input2, _mm_loadu_si128(reinterpret_cast<const __m128i *>(pWeights2 + 16)));
+    __m128i sums = _mm_hadd_epi16(rows01, rows23);
+    sums = _mm_hadd_epi16(sums, sums); // Lanes 0-3 hold the 4 outputs
+
+    __m128i bias2 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(pBias2));
+    __m128i output2 = _mm_max_epi16(_mm_srai_epi16(_mm_add_epi16(sums, bias2), 6), _mm_setzero_si128());
+
+    // Layer 3 (only 4 weights are stored, the rest of the register is zero)
+    int32_t weights3;
+    __builtin_memcpy(&weights3, pWeights3, 4);
+    __m128i input3 = _mm_packs_epi16(output2, output2);
+    __m128i products3 = _mm_maddubs_epi16(input3, _mm_cvtsi32_si128(weights3));
+    products3 = _mm_add_epi16(products3, _mm_srli_epi32(products3, 16));
+
+    return static_cast<int16_t>(_mm_cvtsi128_si32(products3) + pBias3[0]);
+}
+
+static inline TARGET_AVX2 __m128i sumRowsOf4(__m256i rows0123, __m256i rows4567)
+// Each argument holds 4 rows of 4 int16 partial sums (row i in lanes 4i to 4i+3).
+// Returns the 8 row sums in order, with wrapping int16 arithmetic.
+{
+    __m256i sums = _mm256_hadd_epi16(rows0123, rows4567); // 128 bit lanes: [r0 r0 r1 r1 r4 r4 r5 r5], [r2 r2 r3 r3 r6 r6 r7 r7]
+    sums = _mm256_hadd_epi16(sums, sums);                 // 128 bit lanes: [r0 r1 r4 r5 ...], [r2 r3 r6 r7 ...]
+    return _mm_unpacklo_epi32(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+}
+
+static inline TARGET_AVX512 __m512i dotProductsAVX512(__m512i input, __m512i weights)
+// int32 sums of 4 consecutive unsigned by signed byte products
+{
+    return _mm512_madd_epi16(_mm512_maddubs_epi16(input, weights), _mm512_set1_epi16(1));
+}
+
+static inline TARGET_AVX512VNNI __m512i dotProductsAVX512VNNI(__m512i input, __m512i weights)
+// Same as dotProductsAVX512 in a single instruction
+{
+    return _mm512_dpbusd_epi32(_mm512_setzero_si512(), input, weights);
+}
+
+// SSSE3
+
+static TARGET_SSSE3 int16_t fullNnuePassSSSE3(const int16_t *pInput1, const int16_t *pInput2, const int8_t *pWeights1, const int16_t *pBias1,
+                                              const int8_t *pWeights2, const int16_t *pBias2, const int8_t *pWeights3, const int16_t *pBias3)
+{
+    // Layer 1, one weight row of 16 elements per register
+    __m128i input = clipToInt8(pInput1, pInput2);
+    __m128i products[8];
+    for (int i = 0; i < 8; ++i)
+        products[i] = _mm_maddubs_epi16(input, _mm_loadu_si128(reinterpret_cast<const __m128i *>(pWeights1 + i * 16)));
+
+    __m128i sums0123 = _mm_hadd_epi16(_mm_hadd_epi16(products[0], products[1]), _mm_hadd_epi16(products[2], products[3]));
+    __m128i sums4567 = _mm_hadd_epi16(_mm_hadd_epi16(products[4], products[5]), _mm_hadd_epi16(products[6], products[7]));
+    __m128i output1 = firstLayerActivation(_mm_hadd_epi16(sums0123, sums4567), pBias1);
+
+    // Layers 2 and 3
+    return secondAndThirdLayers(output1, pWeights2, pBias2, pWeights3, pBias3);
+}
+
+static TARGET_SSSE3 int16_t fullNnueuPassSSSE3(const int16_t *pInput, const int8_t *pWeights11, const int8_t *pWeights12, const int16_t *pBias1,
+                                               const int8_t *pWeights2, const int16_t *pBias2, const int8_t *pWeights3, const int16_t *pBias3)
+{
+    // Layer 0
+    __m128i vector = clipToInt8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pInput)));
+
+    // Layer 1, two weight rows of 8 elements per register
+    __m128i products[4];
+    for (int i = 0; i < 2; ++i)
+    {
+        products[i] = _mm_maddubs_epi16(vector, _mm_loadu_si128(reinterpret_cast<const __m128i *>(pWeights11 + i * 16)));
+        products[i + 2] = _mm_maddubs_epi16(vector, _mm_loadu_si128(reinterpret_cast<const __m128i *>(pWeights12 + i * 16)));
+    }
+    __m128i sums0123 = _mm_hadd_epi16(products[0], products[1]);
+    __m128i sums4567 = _mm_hadd_epi16(products[2], products[3]);
+    __m128i output1 = firstLayerActivation(_mm_hadd_epi16(sums0123, sums4567), pBias1);
+
+    // Layers 2 and 3
+    return secondAndThirdLayers(output1, pWeights2, pBias2, pWeights3, pBias3);
+}
+
+// AVX2
+
+static TARGET_AVX2 int16_t fullNnuePassAVX2(const int16_t *pInput1, const int16_t *pInput2, const int8_t *pWeights1, const int16_t *pBias1,
+                                            const int8_t *pWeights2, const int16_t *pBias2, const int8_t *pWeights3, const int16_t *pBias3)
+{
+    // Layer 1, the clipped inputs repeated over the 2 128 bit lanes
+    __m256i input = _mm256_broadcastsi128_si256(clipToInt8(pInput1, pInput2));
+
+    // Each 32 byte register holds 2 weight rows of 16 elements, so row 2k lands in the low 128 bit lane
+    __m256i products[4];
+    for (int i = 0; i < 4; ++i)
+        products[i] = _mm256_maddubs_epi16(input, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pWeights1 + i * 32)));
+
+    __m256i sums = _mm256_hadd_epi16(_mm256_hadd_epi16(products[0], products[1]), _mm256_hadd_epi16(products[2], products[3]));
+    sums = _mm256_hadd_epi16(sums, sums); // 128 bit lanes: [r0 r2 r4 r6 ...], [r1 r3 r5 r7 ...]
+    __m128i output1 = _mm_unpacklo_epi16(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+    output1 = firstLayerActivation(output1, pBias1);
+
+    // Layers 2 and 3
+    return secondAndThirdLayers(output1, pWeights2, pBias2, pWeights3, pBias3);
+}
+
+static TARGET_AVX2 int16_t fullNnueuPassAVX2(const int16_t *pInput, const int8_t *pWeights11, const int8_t *pWeights12, const int16_t *pBias1,
+                                             const int8_t *pWeights2, const int16_t *pBias2, const int8_t *pWeights3, const int16_t *pBias3)
+{
+    // Layer 0, the 8 clipped inputs repeated 4 times
+    __m256i input = _mm256_broadcastsi128_si256(clipToInt8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pInput))));
+
+    // Layer 1, each weight block holds 4 rows of 8 elements
+    __m256i products0123 = _mm256_maddubs_epi16(input, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pWeights11)));
+    __m256i products4567 = _mm256_maddubs_epi16(input, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pWeights12)));
+    __m128i output1 = firstLayerActivation(sumRowsOf4(products0123, products4567), pBias1);
+
+    // Layers 2 and 3
+    return secondAndThirdLayers(output1, pWeights2, pBias2, pWeights3, pBias3);
+}
+
+// AVX-512 (with and without VNNI). Intrinsics whose unmasked form passes an undefined register through (e.g.
+// _mm512_cvtepi32_epi16) use their zero masked form with a full mask, which compiles to the same instruction without
+// GCC warning that the undefined register is used uninitialized.
+
+static inline TARGET_AVX512 __m128i firstLayerNnueAVX512(__m512i sums0123, __m512i sums4567)
+// Each argument holds 4 rows split over 4 int32 lanes. Truncating the int32 sums keeps them equal modulo 2^16
+{
+    return sumRowsOf4(_mm512_maskz_cvtepi32_epi16(0xFFFF, sums0123), _mm512_maskz_cvtepi32_epi16(0xFFFF, sums4567));
+}
+
+static inline TARGET_AVX512 __m128i firstLayerNnueuAVX512(__m512i sums)
+// Row i is split over int32 lanes 2i and 2i + 1. Truncating to int16 keeps them equal modulo 2^16
+{
+    __m256i halves = _mm512_maskz_cvtepi32_epi16(0xFFFF, sums);
+    halves = _mm256_hadd_epi16(halves, halves); // 128 bit lanes: [r0 r1 r2 r3 r0 r1 r2 r3], [r4 r5 r6 r7 ...]
+    return _mm256_castsi256_si128(_mm256_permute4x64_epi64(halves, 0b1000));
+}
+
+static inline TARGET_AVX512 __m512i nnueuInputAVX512(const int16_t *pInput)
+// The 8 clipped inputs repeated over the whole register
+{
+    return _mm512_set1_epi64(_mm_cvtsi128_si64(clipToInt8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pInput)))));
+}
+
+static inline TARGET_AVX512 __m512i nnueuWeightsAVX512(const int8_t *pWeights11, const int8_t *pWeights12)
+// The 8 weight rows of 8 elements fit in one 64 byte register
+{
+    return _mm512_maskz_inserti64x4(0xFF, _mm512_maskz_loadu_epi64(0x0F, pWeights11),
+                                    _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pWeights12)), 1);
+}
+
+static TARGET_AVX512 int16_t fullNnuePassAVX512(const int16_t *pInput1, const int16_t *pInput2, const int8_t *pWeights1, const int16_t *pBias1,
+                                                const int8_t *pWeights2, const int16_t *pBias2, const int8_t *pWeights3, const int16_t *pBias3)
+{
+    // Layer 1, each 64 byte register holds 4 weight rows of 16 elements
+    __m512i input = _mm512_maskz_broadcast_i32x4(0xFFFF, clipToInt8(pInput1, pInput2));
+    __m512i sums0123 = dotProductsAVX512(input, _mm512_loadu_si512(pWeights1));
+    __m512i sums4567 = dotProductsAVX512(input, _mm512_loadu_si512(pWeights1 + 64));
+    __m128i output1 = firstLayerActivation(firstLayerNnueAVX512(sums0123, sums4567), pBias1);
+
+    // Layers 2 and 3
+    return secondAndThirdLayers(output1, pWeights2, pBias2, pWeights3, pBias3);
+}
+
+static TARGET_AVX512 int16_t fullNnueuPassAVX512(const int16_t *pInput, const int8_t *pWeights11, const int8_t *pWeights12, const int16_t *pBias1,
+                                                 const int8_t *pWeights2, const int16_t *pBias2, const int8_t *pWeights3, const int16_t *pBias3)
+{
+    // Layers 0 and 1
+    __m512i sums = dotProductsAVX512(nnueuInputAVX512(pInput), nnueuWeightsAVX512(pWeights11, pWeights12));
+    __m128i output1 = firstLayerActivation(firstLayerNnueuAVX512(sums), pBias1);
+
+    // Layers 2 and 3
+    return secondAndThirdLayers(output1, pWeights2, pBias2, pWeights3, pBias3);
+}
+
+static TARGET_AVX512VNNI int16_t fullNnuePassAVX512VNNI(const int16_t *pInput1, const int16_t *pInput2, const int8_t *pWeights1, const int16_t *pBias1,
+                                                        const int8_t *pWeights2, const int16_t *pBias2, const int8_t *pWeights3, const int16_t *pBias3)
+{
+    // Layer 1, each 64 byte register holds 4 weight rows of 16 elements
+    __m512i input = _mm512_maskz_broadcast_i32x4(0xFFFF, clipToInt8(pInput1, pInput2));
+    __m512i sums0123 = dotProductsAVX512VNNI(input, _mm512_loadu_si512(pWeights1));
+    __m512i sums4567 = dotProductsAVX512VNNI(input, _mm512_loadu_si512(pWeights1 + 64));
+    __m128i output1 = firstLayerActivation(firstLayerNnueAVX512(sums0123, sums4567), pBias1);
+
+    // Layers 2 and 3
+    return secondAndThirdLayers(output1, pWeights2, pBias2, pWeights3, pBias3);
+}
+
+static TARGET_AVX512VNNI int16_t fullNnueuPassAVX512VNNI(const int16_t *pInput, const int8_t *pWeights11, const int8_t *pWeights12, const int16_t *pBias1,
+                                                         const int8_t *pWeights2, const int16_t *pBias2, const int8_t *pWeights3, const int16_t *pBias3)
+{
+    // Layers 0 and 1
+    __m512i sums = dotProductsAVX512VNNI(nnueuInputAVX512(pInput), nnueuWeightsAVX512(pWeights11, pWeights12));
+    __m128i output1 = firstLayerActivation(firstLayerNnueuAVX512(sums), pBias1);
+
+    // Layers 2 and 3
+    return secondAndThirdLayers(output1, pWeights2, pBias2, pWeights3, pBias3);
+}
+
+// Generated NNUEU forward passes (see nnueuPassScalar). Inputs are at most 127, so the pair sums of
+// _mm_maddubs_epi16 never saturate and every backend gives the scalar results. The second and third layer weights
+// are interleaved (see interleaveWeights): each group of 4 inputs is broadcast to every 32 bit lane and multiplied
+// with the weights of as many outputs as the register holds, so each output sums in its own lane.
 
+template <int Size>
+static inline TARGET_SSSE3 void clipInputSSSE3(const int16_t *pInput, uint8_t *input)
+// Layer 0 of every x86 backend, clips the accumulator to [0, 127] bytes
+{
+    for (int j = 0; j < Size; j += 16)
+    {
+        __m128i low = _mm_max_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pInput + j)), _mm_setzero_si128());
+        __m128i high = _mm_max_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pInput + j + 8)), _mm_setzero_si128());
+        _mm_store_si128(reinterpret_cast<__m128i *>(input + j), _mm_packs_epi16(low, high));
+    }
+}
+
+static inline TARGET_SSSE3 __m128i clipActivations(__m128i sums)
+// Shifts and clips 8 int16 saturated sums to [0, 127], as hiddenActivation. The bytes are in the low 8 bytes.
+{
+    __m128i activations = _mm_min_epi16(_mm_max_epi16(sums, _mm_setzero_si128()), _mm_set1_epi16(127));
+    return _mm_packs_epi16(activations, activations);
+}
+
+template <int In>
+static inline TARGET_SSSE3 __m128i dotProductsSSSE3(const uint8_t *input, const int8_t *weights)
+// int32 partial sums of the products of the input with one weight row, for the final layer
+{
+    __m128i sum = _mm_setzero_si128();
+    for (int j = 0; j < In; j += 16)
+    {
+        __m128i products = _mm_maddubs_epi16(_mm_load_si128(reinterpret_cast<const __m128i *>(input + j)),
+                                             _mm_loadu_si128(reinterpret_cast<const __m128i *>(weights + j)));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(products, _mm_set1_epi16(1)));
+    }
+    return sum;
+}
+
+static inline TARGET_SSSE3 int32_t horizontalSumSSSE3(__m128i sum)
+{
+    sum = _mm_hadd_epi32(sum, sum);
+    return _mm_cvtsi128_si32(_mm_hadd_epi32(sum, sum));
+}
+
+template <int In, int Out>
+static inline TARGET_SSSE3 void affineLayerSSSE3(const uint8_t *input, const int8_t *weights, const int16_t *bias, uint8_t *output)
+{
+    constexpr int REGISTERS = Out / 4;
+    __m128i sums[REGISTERS];
+    UNROLL_REGISTERS
+    for (int r = 0; r < REGISTERS; ++r)
+        sums[r] = _mm_setzero_si128();
+    for (int j = 0; j < In; j += 4)
+    {
+        __m128i inputs = _mm_set1_epi32(inputGroup(input + j));
+        UNROLL_REGISTERS
+        for (int r = 0; r < REGISTERS; ++r)
+        {
+            __m128i products = _mm_maddubs_epi16(inputs, _mm_loadu_si128(reinterpret_cast<const __m128i *>(weights + j * Out + 16 * r)));
+            sums[r] = _mm_add_epi32(sums[r], _mm_madd_epi16(products, _mm_set1_epi16(1)));
+        }
+    }
+    for (int r = 0; r < REGISTERS; r += 2)
+    {
+        __m128i biases = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bias + 4 * r));
+        __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(biases, biases), 16); // Sign extended to int32
+        __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(biases, biases), 16);
+        low = _mm_srai_epi32(_mm_add_epi32(sums[r], low), 6);
+        high = _mm_srai_epi32(_mm_add_epi32(sums[r + 1], high), 6);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(output + 4 * r), clipActivations(_mm_packs_epi32(low, high)));
+    }
+}
+
+template <typename Layers>
+static TARGET_SSSE3 int16_t nnueuPassSSSE3(const int16_t *pInput, const int8_t *pWeights11, const int8_t *pWeights12, const int16_t *pBias1,
+                                           const int8_t *pWeights2, const int16_t *pBias2, const int8_t *pWeights3, const int16_t *pBias3)
+{
+    static_assert(hasGeneratedKernels<Layers>(), "Layer sizes must fill whole registers");
+    constexpr int ACCUMULATOR_SIZE = Layers::ACCUMULATOR_SIZE;
+    constexpr int HIDDEN_SIZE_1 = Layers::HIDDEN_SIZE_1;
+    constexpr int HIDDEN_SIZE_2 = Layers::HIDDEN_SIZE_2;
+
+    // Layer 0
+    alignas(64) uint8_t input[ACCUMULATOR_SIZE];
+    clipInputSSSE3<ACCUMULATOR_SIZE>(pInput, input);
+
+    // Layer 1, each king square gives half of the outputs
+    alignas(64) uint8_t output1[HIDDEN_SIZE_1];
+    affineLayerSSSE3<ACCUMULATOR_SIZE, HIDDEN_SIZE_1 / 2>(input, pWeights11, pBias1, output1);
+    affineLayerSSSE3<ACCUMULATOR_SIZE, HIDDEN_SIZE_1 / 2>(input, pWeights12, pBias1 + HIDDEN_SIZE_1 / 2, output1 + HIDDEN_SIZE_1 / 2);
+
+    // Layers 2 and 3
+    alignas(64) uint8_t output2[HIDDEN_SIZE_2];
+    affineLayerSSSE3<HIDDEN_SIZE_1, HIDDEN_SIZE_2>(output1, pWeights2, pBias2, output2);
+    return saturateToInt16(pBias3[0] + horizontalSumSSSE3(dotProductsSSSE3<HIDDEN_SIZE_2>(output2, pWeights3)));
+}
+
+static inline TARGET_AVX2 void storeActivationsAVX2(__m256i sums, const int16_t *bias, uint8_t *output)
+// Adds the biases of 8 outputs to their sums and writes their activations
+{
+    __m256i biases = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(bias)));
+    sums = _mm256_srai_epi32(_mm256_add_epi32(sums, biases), 6);
+    __m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(output), clipActivations(packed));
+}
+
+template <int In, int Out>
+static inline TARGET_AVX2 void affineLayerAVX2(const uint8_t *input, const int8_t *weights, const int16_t *bias, uint8_t *output)
+{
+    constexpr int REGISTERS = Out / 8;
+    __m256i sums[REGISTERS];
+    UNROLL_REGISTERS
+    for (int r = 0; r < REGISTERS; ++r)
+        sums[r] = _mm256_setzero_si256();
+    for (int j = 0; j < In; j += 4)
+    {
+        __m256i inputs = _mm256_set1_epi32(inputGroup(input + j));
+        UNROLL_REGISTERS
+        for (int r = 0; r < REGISTERS; ++r)
+        {
+            __m256i products = _mm256_maddubs_epi16(inputs, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(weights + j * Out + 32 * r)));
+            sums[r] = _mm256_add_epi32(sums[r], _mm256_madd_epi16(products, _mm256_set1_epi16(1)));
+        }
+    }
+    UNROLL_REGISTERS
+    for (int r = 0; r < REGISTERS; ++r)
+        storeActivationsAVX2(sums[r], bias + 8 * r, output + 8 * r);
+}
+
+template <typename Layers>
+static TARGET_AVX2 int16_t nnueuPassAVX2(const int16_t *pInput, const int8_t *pWeights11, const int8_t *pWeights12, const int16_t *pBias1,
+                                         const int8_t *pWeights2, const int16_t *pBias2, const int8_t *pWeights3, const int16_t *pBias3)
+{
+    static_assert(hasGeneratedKernels<Layers>(), "Layer sizes must fill whole registers");
+    constexpr int ACCUMULATOR_SIZE = Layers::ACCUMULATOR_SIZE;
+    constexpr int HIDDEN_SIZE_1 = Layers::HIDDEN_SIZE_1;
+    constexpr int HIDDEN_SIZE_2 = Layers::HIDDEN_SIZE_2;
+
+    // Layer 0
+    alignas(64) uint8_t input[ACCUMULATOR_SIZE];
+    clipInputSSSE3<ACCUMULATOR_SIZE>(pInput, input);
+
+    // Layer 1, each king square gives half of the outputs
+    alignas(64) uint8_t output1[HIDDEN_SIZE_1];
+    affineLayerAVX2<ACCUMULATOR_SIZE, HIDDEN_SIZE_1 / 2>(input, pWeights11, pBias1, output1);
+    affineLayerAVX2<ACCUMULATOR_SIZE, HIDDEN_SIZE_1 / 2>(input, pWeights12, pBias1 + HIDDEN_SIZE_1 / 2, output1 + HIDDEN_SIZE_1 / 2);
+
+    // Layers 2 and 3
+    alignas(64) uint8_t output2[HIDDEN_SIZE_2];
+    affineLayerAVX2<HIDDEN_SIZE_1, HIDDEN_SIZE_2>(output1, pWeights2, pBias2, output2);
+    return saturateToInt16(pBias3[0] + horizontalSumSSSE3(dotProductsSSSE3<HIDDEN_SIZE_2>(output2, pWeights3)));
+}
+
+// AVX-512, with and without VNNI. A register holds 16 outputs of a group of inputs, or 8 outputs of two groups
+// (lanes 0-7 and 8-15) when a layer only has 8 outputs, whose halves are added at the end. Layers of few outputs
+// sum consecutive groups in up to 4 independent chains of registers, so that the latency of VPDPBUSD doesn't
+// stall the loop. Casts, extracts and permutes use zero masked forms, as in the 8-wide kernels.
+
+static inline TARGET_AVX512 __m512i twoInputGroupsAVX512(const uint8_t *input)
+// Inputs 0-3 in lanes 0-7 and inputs 4-7 in lanes 8-15
+{
+    const __m512i spread = _mm512_set_epi32(1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0);
+    return _mm512_maskz_permutexvar_epi32(0xFFFF, spread, _mm512_maskz_loadu_epi64(0x01, input));
+}
+
+static inline TARGET_AVX512 void storeActivationsAVX512(const __m512i *sums, int registers, int outputs, const int16_t *bias, uint8_t *output)
+{
+    if (outputs == 8)
+    {
+        storeActivationsAVX2(_mm256_add_epi32(_mm512_maskz_extracti64x4_epi64(0xFF, sums[0], 0), _mm512_maskz_extracti64x4_epi64(0xFF, sums[0], 1)), bias, output);
+        return;
+    }
+    for (int r = 0; r < registers; ++r)
+    {
+        storeActivationsAVX2(_mm512_maskz_extracti64x4_epi64(0xFF, sums[r], 0), bias + 16 * r, output + 16 * r);
+        storeActivationsAVX2(_mm512_maskz_extracti64x4_epi64(0xFF, sums[r], 1), bias + 16 * r + 8, output + 16 * r + 8);
+    }
+}
+
+template <int In, int Out>
+static inline TARGET_AVX512 void affineLayerAVX512(const uint8_t *input, const int8_t *weights, const int16_t *bias, uint8_t *output)
+{
+    static_assert(Out == 8 || Out % 16 == 0, "Outputs must fill whole registers");
+    constexpr int REGISTERS = (Out + 15) / 16;
+    constexpr int INPUTS_PER_STEP = Out == 8 ? 8 : 4;
+    constexpr int CHAINS = REGISTERS >= 4 ? 1 : 4 / REGISTERS;
+    __m512i sums[CHAINS][REGISTERS];
+    UNROLL_REGISTERS
+    for (int c = 0; c < CHAINS; ++c)
+        UNROLL_REGISTERS
+        for (int r = 0; r < REGISTERS; ++r)
+            sums[c][r] = _mm512_setzero_si512();
+    for (int j = 0; j < In; j += CHAINS * INPUTS_PER_STEP)
+        UNROLL_REGISTERS
+        for (int c = 0; c < CHAINS; ++c)
+        {
+            const uint8_t *group = input + j + c * INPUTS_PER_STEP;
+            __m512i inputs = Out == 8 ? twoInputGroupsAVX512(group) : _mm512_set1_epi32(inputGroup(group));
+            UNROLL_REGISTERS
+            for (int r = 0; r < REGISTERS; ++r)
+                sums[c][r] = _mm512_add_epi32(sums[c][r], dotProductsAVX512(inputs, _mm512_loadu_si512(weights + (j + c * INPUTS_PER_STEP) * Out + 64 * r)));
+        }
+    for (int c = 1; c < CHAINS; ++c)
+        UNROLL_REGISTERS
+        for (int r = 0; r < REGISTERS; ++r)
+            sums[0][r] = _mm512_add_epi32(sums[0][r], sums[c][r]);
+    storeActivationsAVX512(sums[0], REGISTERS, Out, bias, output);
+}
+
+template <int In, int Out>
+static inline TARGET_AVX512VNNI void affineLayerAVX512VNNI(const uint8_t *input, const int8_t *weights, const int16_t *bias, uint8_t *output)
+{
+    static_assert(Out == 8 || Out % 16 == 0, "Outputs must fill whole registers");
+    constexpr int REGISTERS = (Out + 15) / 16;
+    constexpr int INPUTS_PER_STEP = Out == 8 ? 8 : 4;
+    constexpr int CHAINS = REGISTERS >= 4 ? 1 : 4 / REGISTERS;
+    __m512i sums[CHAINS][REGISTERS];
+    UNROLL_REGISTERS
+    for (int c = 0; c < CHAINS; ++c)
+        UNROLL_REGISTERS
+        for (int r = 0; r < REGISTERS; ++r)
+            sums[c][r] = _mm512_setzero_si512();
+    for (int j = 0; j < In; j += CHAINS * INPUTS_PER_STEP)
+        UNROLL_REGISTERS
+        for (int c = 0; c < CHAINS; ++c)
+        {
+            const uint8_t *group = input + j + c * INPUTS_PER_STEP;
+            __m512i inputs = Out == 8 ? twoInputGroupsAVX512(group) : _mm512_set1_epi32(inputGroup(group));
+            UNROLL_REGISTERS
+            for (int r = 0; r < REGISTERS; ++r)
+                sums[c][r] = _mm512_dpbusd_epi32(sums[c][r], inputs, _mm512_loadu_si512(weights + (j + c * INPUTS_PER_STEP) * Out + 64 * r));
+        }
+    for (int c = 1; c < CHAINS; ++c)
+        UNROLL_REGISTERS
+        for (int r = 0; r < REGISTERS; ++r)
+            sums[0][r] = _mm512_add_epi32(sums[0][r], sums[c][r]);
+    storeActivationsAVX512(sums[0], REGISTERS, Out, bias, output);
+}
+
+template <typename Layers>
+static TARGET_AVX512 int16_t nnueuPassAVX512(const int16_t *pInput, const int8_t *pWeights11, const int8_t *pWeights12, const int16_t *pBias1,
+                                             const int8_t *pWeights2, const int16_t *pBias2, const int8_t *pWeights3, const int16_t *pBias3)
+{
+    static_assert(hasGeneratedKernels<Layers>(), "Layer sizes must fill whole registers");
+    constexpr int ACCUMULATOR_SIZE = Layers::ACCUMULATOR_SIZE;
+    constexpr int HIDDEN_SIZE_1 = Layers::HIDDEN_SIZE_1;
+    constexpr int HIDDEN_SIZE_2 = Layers::HIDDEN_SIZE_2;
+
+    // Layer 0
+    alignas(64) uint8_t input[ACCUMULATOR_SIZE];
+    clipInputSSSE3<ACCUMULATOR_SIZE>(pInput, input);
+
+    // Layer 1, each king square gives half of the outputs
+    alignas(64) uint8_t output1[HIDDEN_SIZE_1];
+    affineLayerAVX512<ACCUMULATOR_SIZE, HIDDEN_SIZE_1 / 2>(input, pWeights11, pBias1, output1);
+    affineLayerAVX512<ACCUMULATOR_SIZE, HIDDEN_SIZE_1 / 2>(input, pWeights12, pBias1 + HIDDEN_SIZE_1 / 2, output1 + HIDDEN_SIZE_1 / 2);
+
+    // Layers 2 and 3
+    alignas(64) uint8_t output2[HIDDEN_SIZE_2];
+    affineLayerAVX512<HIDDEN_SIZE_1, HIDDEN_SIZE_2>(output1, pWeights2, pBias2, output2);
+    return saturateToInt16(pBias3[0] + horizontalSumSSSE3(dotProductsSSSE3<HIDDEN_SIZE_2>(output2, pWeights3)));
+}
+
+template <typename Layers>
+static TARGET_AVX512VNNI int16_t nnueuPassAVX512VNNI(const int16_t *pInput, const int8_t *pWeights11, const int8_t *pWeights12, const int16_t *pBias1,
+                                                     const int8_t *pWeights2, const int16_t *pBias2, const int8_t *pWeights3, const int16_t *pBias3)
+{
+    static_assert(hasGeneratedKernels<Layers>(), "Layer sizes must fill whole registers");
+    constexpr int ACCUMULATOR_SIZE = Layers::ACCUMULATOR_SIZE;
+    constexpr int HIDDEN_SIZE_1 = Layers::HIDDEN_SIZE_1;
+    constexpr int HIDDEN_SIZE_2 = Layers::HIDDEN_SIZE_2;
+
+    // Layer 0
+    alignas(64) uint8_t input[ACCUMULATOR_SIZE];
+    clipInputSSSE3<ACCUMULATOR_SIZE>(pInput, input);
+
+    // Layer 1, each king square gives half of the outputs
+    alignas(64) uint8_t output1[HIDDEN_SIZE_1];
+    affineLayerAVX512VNNI<ACCUMULATOR_SIZE, HIDDEN_SIZE_1 / 2>(input, pWeights11, pBias1, output1);
+    affineLayerAVX512VNNI<ACCUMULATOR_SIZE, HIDDEN_SIZE_1 / 2>(input, pWeights12, pBias1 + HIDDEN_SIZE_1 / 2, output1 + HIDDEN_SIZE_1 / 2);
+
+    // Layers 2 and 3
+    alignas(64) uint8_t output2[HIDDEN_SIZE_2];
+    affineLayerAVX512VNNI<HIDDEN_SIZE_1, HIDDEN_SIZE_2>(output1, pWeights2, pBias2, output2);
+    return saturateToInt16(pBias3[0] + horizontalSumSSSE3(dotProductsSSSE3<HIDDEN_SIZE_2>(output2, pWeights3)));
+}
+
+#endif
+
+////////////////
+// Runtime backend selection
+////////////////
+
+#if defined(__x86_64__) || defined(__i386__)
+static bool hasSSSE3() { return __builtin_cpu_supports("ssse3"); }
+static bool hasAVX2() { return __builtin_cpu_supports("avx2"); }
+static bool hasAVX512() { return __builtin_cpu_supports("avx512bw"); }
+static bool hasAVX512VNNI() { return __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vnni"); }
+#endif
+static bool alwaysSupported() { return true; }
+
+// Ordered from the widest to the narrowest, the scalar backend goes last
+const SimdBackend simdBackends[] = {
+#if defined(__ARM_NEON)
+    {"NEON", alwaysSupported, add_8_int16, substract_8_int16, fullNnuePassNEON, fullNnueuPassNEON},
+#elif defined(__x86_64__) || defined(__i386__)
+    {"AVX-512 VNNI", hasAVX512VNNI, add_8_int16, substract_8_int16, fullNnuePassAVX512VNNI, fullNnueuPassAVX512VNNI},
+    {"AVX-512", hasAVX512, add_8_int16, substract_8_int16, fullNnuePassAVX512, fullNnueuPassAVX512},
+    {"AVX2", hasAVX2, add_8_int16, substract_8_int16, fullNnuePassAVX2, fullNnueuPassAVX2},
+    {"SSSE3", hasSSSE3, add_8_int16, substract_8_int16, fullNnuePassSSSE3, fullNnueuPassSSSE3},
+#endif
+    {"Scalar", alwaysSupported, add_8_int16Scalar, substract_8_int16Scalar, fullNnuePassScalar, fullNnueuPassScalar},
+};
+const int numSimdBackends = sizeof(simdBackends) / sizeof(simdBackends[0]);
+
+template <typename Layers>
+NnueuPass getNnueuPass(int backend)
+{
+    // Same order as simdBackends
+    static const NnueuPass passes[] = {
+#if defined(__ARM_NEON)
+        nnueuPassNEON<Layers>,
+#elif defined(__x86_64__) || defined(__i386__)
+        nnueuPassAVX512VNNI<Layers>,
+        nnueuPassAVX512<Layers>,
+        nnueuPassAVX2<Layers>,
+        nnueuPassSSSE3<Layers>,
 #endif
-}
\ No newline at end of file
+        nnueuPassScalar<Layers>};
+    static_assert(sizeof(passes) / sizeof(passes[0]) == sizeof(simdBackends) / sizeof(simdBackends[0]),
+                  "Every backend needs a forward pass");
+    return passes[backend];
+}
+
+template <>
+NnueuPass getNnueuPass<NnueuLayers8>(int backend)
+{
+    return simdBackends[backend].fullNnueuPass;
+}
+
+template NnueuPass getNnueuPass<NnueuLayers256>(int backend);
+template NnueuPass getNnueuPass<NnueuLayers512>(int backend);
+
+static int selectedBackendIndex = 0;
+static const SimdBackend *selectedBackend = &simdBackends[0];
+int16_t (*fullNnuePass)(const int16_t *, const int16_t *, const int8_t *, const int16_t *, const int8_t *, const int16_t *,
+                        const int8_t *, const int16_t *) = fullNnuePassScalar;
+
+const char *selectSimdBackend()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+#endif
+    for (int i = 0; i < numSimdBackends; ++i)
+    {
+        if (simdBackends[i].isSupported())
+        {
+            selectedBackendIndex = i;
+            selectedBackend = &simdBackends[i];
+            break;
+        }
+    }
+    fullNnuePass = selectedBackend->fullNnuePass;
+    return selectedBackend->name;
+}
+
+const char *getSimdBackend()
+{
+    return selectedBackend->name;
+}
+
+int getSimdBackendIndex()
+{
+    return selectedBackendIndex;
+}
@@ -4,8 +4,76 @@
 
 void add_8_int16(int16_t *a, const int16_t *b);
 void substract_8_int16(int16_t *a, const int16_t *b);
-int16_t fullNnuePass(int16_t *pInput1, int16_t *pInput2, int8_t *pWeights1, int16_t *pBias1,
-                     int8_t *pWeights2, int16_t *pBias2, int8_t *pWeights3, int16_t *pBias3);
-int16_t fullNnueuPass(int16_t *pInput, int8_t *pWeights11, int8_t *pWeights12, int16_t *pBias1,
-                      int8_t *pWeights2, int16_t *pBias2, int8_t *pWeights3, int16_t *pBias3);
+
+// Same for accumulators of any size handled by the NNUEU (see NnueuLayers below)
+template <int Size>
+void add_int16(int16_t *a, const int16_t *b);
+template <int Size>
+void substract_int16(int16_t *a, const int16_t *b);
+
+// Layer sizes of an NNUEU. The accumulator of the side to move (AccumulatorSize wide, one is kept for each side)
+// goes through a layer of HiddenSize1 outputs, whose first half of weights is chosen by the side to move's king
+// square and second half by the other king's square, then through a layer of HiddenSize2 outputs and the output.
+//
+// The forward passes are generated from these sizes at compile time, so each supported size gets fully unrolled
+// kernels for every backend. The 8-8-4 networks keep their hand-written kernels.
+template <int AccumulatorSize, int HiddenSize1, int HiddenSize2>
+struct NnueuLayers
+{
+    static constexpr int ACCUMULATOR_SIZE = AccumulatorSize;
+    static constexpr int HIDDEN_SIZE_1 = HiddenSize1;
+    static constexpr int HIDDEN_SIZE_2 = HiddenSize2;
+
+    // Second layer weights for one king square, HiddenSize1 / 2 rows of AccumulatorSize
+    static constexpr int KING_BLOCK_SIZE = HiddenSize1 / 2 * AccumulatorSize;
+
+    static_assert(AccumulatorSize % 8 == 0 && HiddenSize1 % 2 == 0, "Layers must fill whole registers");
+};
+
+// Layer sizes the NNUEU is compiled for, network files of other sizes are rejected when loading
+using NnueuLayers8 = NnueuLayers<8, 8, 4>;        // 8-8-4-1, the networks in models/
+using NnueuLayers256 = NnueuLayers<256, 32, 32>;  // 256-32-32-1
+using NnueuLayers512 = NnueuLayers<512, 16, 32>;  // 512-16-32-1
+
+// Forward pass of an NNUEU: the side to move's accumulator, the second layer weights of both kings' squares, and
+// the rest of the layers
+using NnueuPass = int16_t (*)(const int16_t *pInput, const int8_t *pWeights11, const int8_t *pWeights12, const int16_t *pBias1,
+                              const int8_t *pWeights2, const int16_t *pBias2, const int8_t *pWeights3, const int16_t *pBias3);
+
+// The forward passes of every NnueuLayers but 8-8-4 read the second and third layer weights interleaved by groups
+// of 4 inputs, [In / 4][Out][4] instead of the [Out][In] rows of the network file: a group of inputs is broadcast
+// and multiplied with the weights of many outputs at once, each output summing in its own lane, so no output needs
+// a horizontal sum. Reorders one matrix, done once when loading a network (in must be a multiple of 4).
+void interleaveWeights(const int8_t *rows, int8_t *interleaved, int in, int out);
+
+// The NNUEU forward pass of the given layer sizes for simdBackends[backend], for the layer sizes above
+template <typename Layers>
+NnueuPass getNnueuPass(int backend);
+template <>
+NnueuPass getNnueuPass<NnueuLayers8>(int backend);
+
+// The forward passes are chosen at runtime by selectSimdBackend, so a single x86 binary
+// uses the widest SIMD extension of the CPU it runs on. The NNUEU one is chosen when loading a network, by its
+// layer sizes (see getNnueuPass).
+extern int16_t (*fullNnuePass)(const int16_t *pInput1, const int16_t *pInput2, const int8_t *pWeights1, const int16_t *pBias1,
+                               const int8_t *pWeights2, const int16_t *pBias2, const int8_t *pWeights3, const int16_t *pBias3);
+
+// Every backend compiled in this binary, from the widest to the portable scalar one
+struct SimdBackend
+{
+    const char *name;
+    bool (*isSupported)(); // Whether the running CPU can execute it
+    void (*add_8_int16)(int16_t *a, const int16_t *b);
+    void (*substract_8_int16)(int16_t *a, const int16_t *b);
+    int16_t (*fullNnuePass)(const int16_t *pInput1, const int16_t *pInput2, const int8_t *pWeights1, const int16_t *pBias1,
+                            const int8_t *pWeights2, const int16_t *pBias2, const int8_t *pWeights3, const int16_t *pBias3);
+    NnueuPass fullNnueuPass; // 8-8-4 networks
+};
+extern const SimdBackend simdBackends[];
+extern const int numSimdBackends;
+
+// Detects the CPU features, sets the forward passes and returns the backend name (e.g. "AVX2")
+const char *selectSimdBackend();
+const char *getSimdBackend();
+int getSimdBackendIndex(); // Index of the selected backend in simdBackends
 #endif
\ No newline at end of file
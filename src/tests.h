@@ -3,6 +3,16 @@
 #include "bitposition.h"
 #include <vector>
 #include <iostream> // For printing
+#include <random>
+#include <chrono>
+#include <cstring> // For std::memcpy
+#include <fstream>
+#include "simd.h"
+#include "ttable.h"
+#include <thread>
+#include <atomic>
+#include "engine.h"
+#include "position_eval.h"
 
 
 // Additional helper function for printing moves
@@ -769,4 +779,528 @@ unsigned long long runNonPVMovesPerftTest(BitPosition &position, int depth, int
     }
     return moveCount;
 }
+
+// Random inputs of a single NNUE forward pass, both network layouts read from the same arrays
+struct SimdTestCase
+{
+    int16_t input1[8];
+    int16_t input2[8];
+    int8_t weights1[16 * 8];
+    int8_t weights2[8 * 4];
+    int8_t weights3[8]; // Only the first 4 are used, NEON loads 8
+    int16_t bias1[8];
+    int16_t bias2[4];
+    int16_t bias3;
+};
+
+unsigned long long runSimdBackendsTest(int numEvals)
+// Feeds random accumulators and weights through every backend this CPU supports and checks that they give the
+// same int16_t outputs as the scalar backend. Then reports the time per evaluation of each backend.
+// Returns the number of mismatches.
+{
+    const SimdBackend &scalar = simdBackends[numSimdBackends - 1];
+    std::mt19937 generator(12345);
+    std::uniform_int_distribution<int> int16Distribution(-32768, 32767);
+    std::uniform_int_distribution<int> int8Distribution(-128, 127);
+    std::uniform_int_distribution<int> accumulatorDistribution(-200, 400); // Values seen during search
+
+    // A batch of random cases, reused until numEvals evaluations are done
+    std::vector<SimdTestCase> cases(4096);
+    for (std::size_t n = 0; n < cases.size(); ++n)
+    {
+        SimdTestCase &c = cases[n];
+        // Half of the cases use the full int16 range to test saturation and wrapping
+        bool fullRange = n % 2 == 0;
+        for (int i = 0; i < 8; ++i)
+        {
+            c.input1[i] = fullRange ? int16Distribution(generator) : accumulatorDistribution(generator);
+            c.input2[i] = fullRange ? int16Distribution(generator) : accumulatorDistribution(generator);
+            c.bias1[i] = fullRange ? int16Distribution(generator) : accumulatorDistribution(generator) * 8;
+        }
+        for (int i = 0; i < 16 * 8; ++i)
+            c.weights1[i] = int8Distribution(generator);
+        for (int i = 0; i < 8 * 4; ++i)
+            c.weights2[i] = int8Distribution(generator);
+        for (int i = 0; i < 8; ++i)
+            c.weights3[i] = i < 4 ? int8Distribution(generator) : 0;
+        for (int i = 0; i < 4; ++i)
+            c.bias2[i] = fullRange ? int16Distribution(generator) : accumulatorDistribution(generator) * 8;
+        c.bias3 = int16Distribution(generator);
+    }
+
+    unsigned long long mismatches = 0;
+    for (int b = 0; b < numSimdBackends; ++b)
+    {
+        const SimdBackend &backend = simdBackends[b];
+        if (not backend.isSupported())
+        {
+            std::cout << backend.name << ": not supported by this CPU\n";
+            continue;
+        }
+        unsigned long long backendMismatches = 0;
+        for (int n = 0; n < numEvals; ++n)
+        {
+            SimdTestCase &c = cases[n % cases.size()];
+
+            // Accumulator updates
+            int16_t expected[8];
+            int16_t accumulator[8];
+            std::memcpy(expected, c.input1, sizeof(expected));
+            std::memcpy(accumulator, c.input1, sizeof(accumulator));
+            scalar.add_8_int16(expected, c.input2);
+            backend.add_8_int16(accumulator, c.input2);
+            scalar.substract_8_int16(expected, c.bias1);
+            backend.substract_8_int16(accumulator, c.bias1);
+            if (std::memcmp(expected, accumulator, sizeof(expected)) != 0)
+                backendMismatches++;
+
+            // Forward passes
+            if (backend.fullNnuePass(c.input1, c.input2, c.weights1, c.bias1, c.weights2, c.bias2, c.weights3, &c.bias3) !=
+                scalar.fullNnuePass(c.input1, c.input2, c.weights1, c.bias1, c.weights2, c.bias2, c.weights3, &c.bias3))
+                backendMismatches++;
+            if (backend.fullNnueuPass(c.input1, c.weights1, c.weights1 + 32, c.bias1, c.weights2, c.bias2, c.weights3, &c.bias3) !=
+                scalar.fullNnueuPass(c.input1, c.weights1, c.weights1 + 32, c.bias1, c.weights2, c.bias2, c.weights3, &c.bias3))
+                backendMismatches++;
+        }
+
+        // Timing, the checksum keeps the calls from being optimized away
+        int checksum = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int n = 0; n < numEvals; ++n)
+        {
+            SimdTestCase &c = cases[n % cases.size()];
+            checksum += backend.fullNnueuPass(c.input1, c.weights1, c.weights1 + 32, c.bias1, c.weights2, c.bias2, c.weights3, &c.bias3);
+        }
+        auto middle = std::chrono::high_resolution_clock::now();
+        for (int n = 0; n < numEvals; ++n)
+        {
+            SimdTestCase &c = cases[n % cases.size()];
+            checksum += backend.fullNnuePass(c.input1, c.input2, c.weights1, c.bias1, c.weights2, c.bias2, c.weights3, &c.bias3);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        std::chrono::duration<double, std::nano> nnueuDuration = middle - start;
+        std::chrono::duration<double, std::nano> nnueDuration = end - middle;
+        std::cout << backend.name << ": " << backendMismatches << " mismatches, "
+                  << nnueuDuration.count() / numEvals << " ns/eval NNUEU, "
+                  << nnueDuration.count() / numEvals << " ns/eval NNUE (checksum " << checksum << ")\n";
+        mismatches += backendMismatches;
+    }
+    return mismatches;
+}
+
+template <typename Layers>
+unsigned long long runNnueuLayersTest(int numEvals)
+// Same as runSimdBackendsTest for the generated NNUEU forward passes of the given layer sizes. Returns the number
+// of mismatches.
+{
+    constexpr int ACCUMULATOR_SIZE = Layers::ACCUMULATOR_SIZE;
+    constexpr int HIDDEN_SIZE_1 = Layers::HIDDEN_SIZE_1;
+    constexpr int HIDDEN_SIZE_2 = Layers::HIDDEN_SIZE_2;
+    std::mt19937 generator(12345);
+    std::uniform_int_distribution<int> int16Distribution(-32768, 32767);
+    std::uniform_int_distribution<int> int8Distribution(-128, 127);
+    std::uniform_int_distribution<int> accumulatorDistribution(-200, 400);
+
+    // One set of weights, a batch of random accumulators reused until numEvals evaluations are done
+    std::vector<int8_t> weights1(2 * Layers::KING_BLOCK_SIZE);
+    std::vector<int8_t> weights2(HIDDEN_SIZE_2 * HIDDEN_SIZE_1);
+    std::vector<int8_t> weights3(HIDDEN_SIZE_2);
+    std::vector<int16_t> bias1(HIDDEN_SIZE_1);
+    std::vector<int16_t> bias2(HIDDEN_SIZE_2);
+    int16_t bias3 = static_cast<int16_t>(int16Distribution(generator));
+    for (int8_t &weight : weights1)
+        weight = static_cast<int8_t>(int8Distribution(generator));
+    for (int8_t &weight : weights2)
+        weight = static_cast<int8_t>(int8Distribution(generator));
+    for (int8_t &weight : weights3)
+        weight = static_cast<int8_t>(int8Distribution(generator));
+    for (int16_t &bias : bias1)
+        bias = static_cast<int16_t>(accumulatorDistribution(generator) * 64);
+    for (int16_t &bias : bias2)
+        bias = static_cast<int16_t>(accumulatorDistribution(generator) * 8);
+
+    std::vector<int16_t> inputs(256 * ACCUMULATOR_SIZE);
+    for (std::size_t i = 0; i < inputs.size(); ++i)
+        inputs[i] = static_cast<int16_t>(i / ACCUMULATOR_SIZE % 2 == 0 ? int16Distribution(generator) : accumulatorDistribution(generator));
+
+    auto pass = [&](NnueuPass forwardPass, int n)
+    {
+        return forwardPass(inputs.data() + n % 256 * ACCUMULATOR_SIZE, weights1.data(), weights1.data() + Layers::KING_BLOCK_SIZE,
+                           bias1.data(), weights2.data(), bias2.data(), weights3.data(), &bias3);
+    };
+
+    const NnueuPass scalar = getNnueuPass<Layers>(numSimdBackends - 1);
+    unsigned long long mismatches = 0;
+    for (int b = 0; b < numSimdBackends; ++b)
+    {
+        if (not simdBackends[b].isSupported())
+            continue;
+        const NnueuPass forwardPass = getNnueuPass<Layers>(b);
+        unsigned long long backendMismatches = 0;
+        for (int n = 0; n < numEvals; ++n)
+            backendMismatches += pass(forwardPass, n) != pass(scalar, n);
+
+        int checksum = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int n = 0; n < numEvals; ++n)
+            checksum += pass(forwardPass, n);
+        std::chrono::duration<double, std::nano> duration = std::chrono::high_resolution_clock::now() - start;
+        std::cout << simdBackends[b].name << " " << ACCUMULATOR_SIZE << "-" << HIDDEN_SIZE_1 << "-" << HIDDEN_SIZE_2 << ": "
+                  << backendMismatches << " mismatches, " << duration.count() / numEvals << " ns/eval (checksum " << checksum << ")\n";
+        mismatches += backendMismatches;
+    }
+    return mismatches;
+}
+
+template <typename Layers>
+double measureNnueuPassLatency(int backend, int numEvals)
+// Nanoseconds per NNUEU forward pass of a backend when each pass waits for the previous one: the accumulator read
+// is chosen by the previous output, as in a search where the next node depends on the last evaluation.
+{
+    constexpr int ACCUMULATOR_SIZE = Layers::ACCUMULATOR_SIZE;
+    std::mt19937 generator(2024);
+    std::uniform_int_distribution<int> int8Distribution(-128, 127);
+    std::uniform_int_distribution<int> accumulatorDistribution(-200, 400);
+
+    // Padded, some 8-8-4 kernels load whole 8 byte rows
+    std::vector<int8_t> weights1(2 * Layers::KING_BLOCK_SIZE + 64);
+    std::vector<int8_t> weights2(Layers::HIDDEN_SIZE_2 * Layers::HIDDEN_SIZE_1 + 64);
+    std::vector<int8_t> weights3(Layers::HIDDEN_SIZE_2 + 64);
+    std::vector<int16_t> bias1(Layers::HIDDEN_SIZE_1, 0);
+    std::vector<int16_t> bias2(Layers::HIDDEN_SIZE_2, 0);
+    int16_t bias3 = 0;
+    for (std::vector<int8_t> *weights : {&weights1, &weights2, &weights3})
+        for (int8_t &weight : *weights)
+            weight = static_cast<int8_t>(int8Distribution(generator));
+    std::vector<int16_t> inputs(64 * ACCUMULATOR_SIZE);
+    for (int16_t &input : inputs)
+        input = static_cast<int16_t>(accumulatorDistribution(generator));
+
+    const NnueuPass forwardPass = getNnueuPass<Layers>(backend);
+    int16_t output = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int n = 0; n < numEvals; ++n)
+        output = forwardPass(inputs.data() + (n + (output & 1)) % 64 * ACCUMULATOR_SIZE, weights1.data(),
+                             weights1.data() + Layers::KING_BLOCK_SIZE, bias1.data(), weights2.data(), bias2.data(),
+                             weights3.data(), &bias3);
+    std::chrono::duration<double, std::nano> duration = std::chrono::high_resolution_clock::now() - start;
+    if (output == INT16_MIN) // Keeps the chain from being optimized away
+        std::cout << "";
+    return duration.count() / numEvals;
+}
+
+void runForwardPassBench(int numEvals)
+// Latency of the NNUEU forward pass of every supported backend, for each layer sizes this build evaluates
+{
+    for (int b = 0; b < numSimdBackends; ++b)
+    {
+        if (not simdBackends[b].isSupported())
+            continue;
+        std::cout << simdBackends[b].name << ": "
+                  << measureNnueuPassLatency<NnueuLayers8>(b, numEvals) << " ns/eval 8-8-4, "
+                  << measureNnueuPassLatency<NnueuLayers256>(b, numEvals) << " ns/eval 256-32-32, "
+                  << measureNnueuPassLatency<NnueuLayers512>(b, numEvals) << " ns/eval 512-16-32\n";
+    }
+}
+
+// Walks the move tree like runNormalPerftTest but only evaluates at the leaves (after each capture, like the
+// quiescence search does), so inner accumulators are only computed lazily from their ancestors. Each evaluation
+// is compared with one from an accumulator computed from scratch. Returns the number of mismatches.
+unsigned long long runAccumulatorStackTest(BitPosition &position, int depth)
+{
+    if (depth == 0)
+    {
+        unsigned long long mismatches = 0;
+        BitPosition refreshed{position};
+        NNUEU::initializeNNUEInput(refreshed);
+        mismatches += NNUEU::evaluationFunction(position, true) != NNUEU::evaluationFunction(refreshed, true);
+
+        if (not position.getIsCheck())
+        {
+            ScoredMove captures[64];
+            ScoredMove *currMove = captures;
+            ScoredMove *endMove = position.setCapturesAndScores(currMove);
+            ScoredMove move = position.nextScoredMove(currMove, endMove);
+            while (move.getData() != 0)
+            {
+                position.makeCapture(move);
+                BitPosition refreshedCapture{position};
+                NNUEU::initializeNNUEInput(refreshedCapture);
+                mismatches += NNUEU::evaluationFunction(position, true) != NNUEU::evaluationFunction(refreshedCapture, true);
+                position.unmakeCapture(move);
+                move = position.nextScoredMove(currMove, endMove);
+            }
+        }
+        return mismatches;
+    }
+    unsigned long long mismatches = 0;
+    if (not position.getIsCheck())
+    {
+        ScoredMove moves[256];
+        ScoredMove *currMove = moves;
+        ScoredMove *endMove = position.setMovesAndScores(currMove);
+        ScoredMove move = position.nextScoredMove(currMove, endMove, Move(0));
+        while (move.getData() != 0)
+        {
+            position.makeMove(move);
+            mismatches += runAccumulatorStackTest(position, depth - 1);
+            position.unmakeMove(move);
+            move = position.nextScoredMove(currMove, endMove, Move(0));
+        }
+    }
+    else
+    {
+        Move moves[64];
+        Move *currMove = moves;
+        Move *endMove = position.setMovesInCheck(currMove);
+        Move move = position.nextMove(currMove, endMove, Move(0));
+        while (move.getData() != 0)
+        {
+            position.makeMove(move);
+            mismatches += runAccumulatorStackTest(position, depth - 1);
+            position.unmakeMove(move);
+            move = position.nextMove(currMove, endMove, Move(0));
+        }
+    }
+    return mismatches;
+}
+
+// Plays random games biased towards king moves and, after each move, brings the HalfKP NNUE accumulators up to date
+// through updateAccumulator, which refreshes the perspective of a king that moved through the refresh cache. Each
+// update is compared with the accumulators rebuilt from every piece by initializeNNUEInput. Needs the NNUE parameters
+// loaded. Returns the number of mismatching updates.
+unsigned long long runRefreshCacheTest(int numMoves)
+{
+    const std::vector<std::string> fens{
+        "8/5pk1/6p1/3R4/7P/6P1/r4PK1/8 w - - 0 40",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"};
+
+    std::mt19937 rng(2024);
+    unsigned long long mismatches = 0;
+    std::chrono::duration<double> cachedTime{0};
+    std::chrono::duration<double> rebuildTime{0};
+    for (int i = 0; i < numMoves;)
+    {
+        BitPosition position{BitPosition(fens[rng() % fens.size()])};
+        NNUE::initializeNNUEInput(position);
+        // Plies are limited by the ply info arrays
+        for (int ply = 0; ply < 40 && i < numMoves; ++ply, ++i)
+        {
+            std::vector<Move> moves{position.getIsCheck() ? position.inCheckAllMoves() : position.allMoves()};
+            if (moves.empty())
+                break;
+            unsigned short kingSquare{position.getTurn() ? position.getWhiteKingPosition() : position.getBlackKingPosition()};
+            std::vector<Move> kingMoves;
+            for (Move move : moves)
+                if (move.getOriginSquare() == kingSquare)
+                    kingMoves.push_back(move);
+            if (not kingMoves.empty() && rng() % 4 != 0)
+                position.makeMove(kingMoves[rng() % kingMoves.size()]);
+            else
+                position.makeMove(moves[rng() % moves.size()]);
+
+            auto start = std::chrono::high_resolution_clock::now();
+            NNUE::updateAccumulator(position);
+            cachedTime += std::chrono::high_resolution_clock::now() - start;
+
+            // The inputs are shared with the position, so they are copied before the rebuild overwrites them
+            Accumulator updated{position.getAccumulator()};
+            int16_t updatedWhiteTurn[8];
+            int16_t updatedBlackTurn[8];
+            std::memcpy(updatedWhiteTurn, updated.inputWhiteTurn, sizeof(updatedWhiteTurn));
+            std::memcpy(updatedBlackTurn, updated.inputBlackTurn, sizeof(updatedBlackTurn));
+
+            start = std::chrono::high_resolution_clock::now();
+            NNUE::initializeNNUEInput(position);
+            rebuildTime += std::chrono::high_resolution_clock::now() - start;
+
+            const Accumulator &rebuilt{position.getAccumulator()};
+            if (std::memcmp(updatedWhiteTurn, rebuilt.inputWhiteTurn, sizeof(updatedWhiteTurn)) != 0 ||
+                std::memcmp(updated.inputWhiteNotTurn, rebuilt.inputWhiteNotTurn, sizeof(rebuilt.inputWhiteNotTurn)) != 0 ||
+                std::memcmp(updatedBlackTurn, rebuilt.inputBlackTurn, sizeof(updatedBlackTurn)) != 0 ||
+                std::memcmp(updated.inputBlackNotTurn, rebuilt.inputBlackNotTurn, sizeof(rebuilt.inputBlackNotTurn)) != 0)
+                mismatches++;
+        }
+    }
+    std::cout << "Updates: " << cachedTime.count() << " seconds\n";
+    std::cout << "Full rebuilds: " << rebuildTime.count() << " seconds\n";
+    return mismatches;
+}
+
+// Resident memory of the process in kilobytes as reported by the OS, or -1 where it isn't available
+long readResidentKilobytes()
+{
+#if defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+        if (line.rfind("VmRSS:", 0) == 0)
+            return std::stol(line.substr(6));
 #endif
+    return -1;
+}
+
+// Measures the accumulator update throughput of both nets. The accumulators of a random game are recomputed from
+// the root over and over through updateAccumulator. The NNUEU computes every ply, the HalfKP NNUE applies all the
+// changes to the last ply at once and refreshes a king that moved through its refresh cache.
+// Needs both nets loaded. Returns a checksum of the accumulators so that the work can't be optimized away.
+int64_t runAccumulatorBench(int numUpdates)
+{
+    const std::string fen{"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"};
+    std::mt19937 rng(2024);
+    BitPosition position{BitPosition(fen)};
+    NNUEU::initializeNNUEInput(position);
+    std::vector<Move> game;
+    for (int ply = 0; ply < 40; ++ply)
+    {
+        std::vector<Move> moves{position.getIsCheck() ? position.inCheckAllMoves() : position.allMoves()};
+        if (moves.empty())
+            break;
+        game.push_back(moves[rng() % moves.size()]);
+        position.makeMove(game.back());
+    }
+    int plies{position.getPly()};
+
+    int64_t checksum{0};
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < numUpdates; i += plies)
+    {
+        for (int ply = 1; ply <= plies; ++ply)
+            position.getAccumulator(ply).computed = false;
+        NNUEU::updateAccumulator(position);
+        checksum += position.getAccumulator().inputWhiteTurn[0] + position.getAccumulator().inputBlackTurn[0];
+    }
+    std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+    std::cout << "NNUEU updates per second: " << static_cast<uint64_t>(numUpdates / duration.count()) << "\n";
+
+    // Same game, each ply counts as an update
+    BitPosition halfKPPosition{BitPosition(fen)};
+    NNUE::initializeNNUEInput(halfKPPosition);
+    for (Move move : game)
+        halfKPPosition.makeMove(move);
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < numUpdates; i += plies)
+    {
+        halfKPPosition.getAccumulator().computed = false;
+        NNUE::updateAccumulator(halfKPPosition);
+        checksum += halfKPPosition.getAccumulator().inputWhiteTurn[0] + halfKPPosition.getAccumulator().inputBlackTurn[0];
+    }
+    duration = std::chrono::high_resolution_clock::now() - start;
+    std::cout << "HalfKP NNUE updates per second: " << static_cast<uint64_t>(numUpdates / duration.count()) << "\n";
+    std::cout << "Resident memory: " << readResidentKilobytes() << " kB\n";
+    return checksum;
+}
+
+// Searches a fixed set of positions to a fixed depth and reports the nodes per second. The tables are emptied
+// before each position so that node counts are reproducible, while the hash size sets how many cache and TLB
+// misses the table probes cost.
+uint64_t runSearchBench(int hashMB, int depth, int threads)
+{
+    const std::vector<std::string> fens{
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+        "r2q1rk1/pp2bppp/2n1pn2/3p4/3P4/2NBPN2/PP3PPP/R2Q1RK1 w - - 0 10",
+        "1b1q4/8/P2p4/1N1Pp2p/5P1k/7P/1B1P3K/8 w - - 0 1",
+        "2r2rk1/1b3ppp/p1qpp3/1P6/1Pn1P2b/2NB1P1P/1BP1R1P1/R2Q2K1 b - - 0 19",
+        "rn2kb1r/1bq2pp1/pp3n1p/4p3/2PQ1B1P/2N3P1/PP2PPB1/2KR3R w kq - 0 12",
+        "3k2rr/4b3/p3Qpq1/P2pn3/1p1Nb3/6B1/1PP1B2P/3R1RK1 b - - 0 25",
+        "8/5pk1/6p1/3R4/7P/6P1/r4PK1/8 w - - 0 40"};
+
+    globalTT.resize(hashMB);
+
+    uint64_t totalNodes{0};
+    uint64_t evalCacheProbes{0};
+    uint64_t evalCacheHits{0};
+    std::chrono::duration<double> duration{0};
+    for (const std::string &fen : fens)
+    {
+        BitPosition position{BitPosition(fen)};
+        Evaluation::initializeNNUEInput(position);
+        globalTT.clear();
+        globalEvalCache.clear();
+
+        // Setting the time to not be the limit
+        SearchContext context(position, 8000000, 0, threads);
+        Move bestMove{iterativeSearch(context, 1, depth).first};
+        duration += std::chrono::high_resolution_clock::now() - context.startTime;
+
+        totalNodes += context.nodes;
+        evalCacheProbes += context.evalCacheProbes;
+        evalCacheHits += context.evalCacheHits;
+        std::cout << fen << ": " << bestMove.toString() << " (" << context.nodes << " nodes)\n";
+    }
+    std::cout << "Nodes: " << totalNodes << "\n";
+    std::cout << "Time taken: " << duration.count() << " seconds\n";
+    std::cout << "Nodes per second: " << static_cast<uint64_t>(totalNodes / duration.count()) << "\n";
+    if (evalCacheProbes == 0)
+        std::cout << "Eval cache: not used by this network\n";
+    else
+        std::cout << "Eval cache hit rate: " << 100.0 * evalCacheHits / evalCacheProbes << "% of " << evalCacheProbes << " evaluations\n";
+    return totalNodes;
+}
+// Hammers save and probe of a small shared transposition table from numThreads threads. The data saved for a
+// key is derived from its 16 bit key, so every probe hit can be checked: a hit whose data doesn't match its key
+// would be an entry torn by racing writes. Returns the number of such corrupted hits.
+uint64_t runTTStressTest(int numThreads, int operationsPerThread)
+{
+    TranspositionTable table;
+    table.resize(1); // Small table so that threads keep colliding on the same clusters
+
+    auto expectedValue = [](uint16_t key16) { return static_cast<int16_t>(key16 ^ 0x5A5A); };
+    auto expectedDepth = [](uint16_t key16) { return static_cast<uint8_t>(1 + key16 % 60); };
+    auto expectedMove = [](uint16_t key16) { return Move(static_cast<uint16_t>((key16 * 40503u) | 1)); };
+    auto expectedIsExact = [](uint16_t key16) { return (key16 & 1) != 0; };
+
+    // More keys than entries, so that threads keep replacing each other's entries
+    std::vector<uint64_t> keys(1 << 18);
+    std::mt19937_64 keyRng(2024);
+    for (uint64_t &key : keys)
+        key = keyRng();
+
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> corrupted{0};
+    std::vector<std::thread> threads;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int t = 0; t < numThreads; ++t)
+    {
+        threads.emplace_back([&, t]()
+        {
+            std::mt19937_64 rng(12345 + t);
+            uint64_t threadHits{0};
+            uint64_t threadCorrupted{0};
+            for (int i = 0; i < operationsPerThread; ++i)
+            {
+                // Keys from a shared pool, so that the same positions are saved and probed by all threads
+                uint64_t z_key{keys[rng() % keys.size()]};
+                uint16_t key16{static_cast<uint16_t>(z_key)};
+                if (i & 1)
+                    table.save(z_key, expectedValue(key16), expectedDepth(key16), expectedMove(key16), expectedIsExact(key16));
+                else
+                {
+                    TTEntry entry;
+                    if (table.probe(z_key, entry))
+                    {
+                        threadHits++;
+                        if (entry.getValue() != expectedValue(key16) || entry.getDepth() != expectedDepth(key16) ||
+                            entry.getMove().getData() != expectedMove(key16).getData() || entry.getIsExact() != expectedIsExact(key16))
+                            threadCorrupted++;
+                    }
+                }
+            }
+            hits += threadHits;
+            corrupted += threadCorrupted;
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+    std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+
+    std::cout << "Threads: " << numThreads << ", operations: " << static_cast<uint64_t>(numThreads) * operationsPerThread << "\n";
+    std::cout << "Probe hits: " << hits << ", corrupted hits: " << corrupted << "\n";
+    std::cout << "Time taken: " << duration.count() << " seconds\n";
+    return corrupted;
+}
+#endif
\ No newline at end of file
@@ -3,11 +3,20 @@
 #include "move.h"
 #include <vector>
 #include <cstring> // For std::memset
+#include <cstdint>
+#include <algorithm> // For std::max
+#include <iostream>
+#include <cstdlib> // For std::aligned_alloc
+#include <thread>
+#include <atomic>
+#if defined(__linux__)
+#include <sys/mman.h> // For mmap and madvise
+#endif
 
 // The transposition table will store the zobrist keys of seen positions, the depth reached starting from that position, the
 // best move found, the value found and the value type.
-// 
-// Value types can either be exact (no cutoff produced when the position was searched previously), 
+//
+// Value types can either be exact (no cutoff produced when the position was searched previously),
 // lower bounds (a beta cutoof was done when searching this position previously), or upper bounds
 // (a alpha cutoff was done when searching this position previously).
 
@@ -15,114 +24,282 @@
 // + If the depth  is more than the one in the table, we return the best move found previously to start searching on that move.
 // + If the depth we are going to search (from the position) is less or equal than the one in the table. We have three options:
 //  - If the valueType is exact, return value and dont search anymore.
-//  - If valueType is a lower bound,
-//  - If valueType is a upper bound, 
+//  - If valueType is a lower bound, raise alpha to the value (return it if that produces a cutoff).
+//  - If valueType is a upper bound, return the value if it is no better than alpha.
+//
+// Values are stored good for the engine. Bounds are bounds for the side to move in the position.
 
-// TTEntry struct is the transposition table entry, defined as below:
+// TTEntry struct is the transposition table entry, packed into 8 bytes as below:
 //
-// key                                                              16 bit
-// depth (max depth - current depth)                                8 bit
-// value                                                            16 bit
+// key (lower 16 bits of the zobrist key)                           16 bit
 // best move                                                        16 bit
-// is exact (otherwise the turn determines if it lower or upper)    8 or 4 bit (boolean)
+// value                                                            16 bit
+// depth (max depth - current depth)                                8 bit
+// generation (5 bit), is upper bound (1 bit), is exact (1 bit),
+// occupied (1 bit)                                                 8 bit
+//
+// The upper bits of the zobrist key choose the cluster, so the 16 bit key only has to tell apart the
+// positions that fall in the same cluster. A false match is rare but possible, so the tt move must be
+// checked for legality before making it.
+//
+// The table is shared by all search threads without locks. Each entry (key included) is read and written
+// as a single 64 bit atomic word, so racing saves can overwrite each other but never leave an entry mixing
+// the key of one position with the data of another. Probes return a copy of the entry for the same reason.
 
 struct TTEntry
 {
-
     Move getMove() const { return Move(move); }
     int16_t getValue() const { return value; }
     uint8_t getDepth() const { return depth; }
-    int16_t getIsExact() const { return isExact; }
+    int16_t getIsExact() const { return (genBound & EXACT_FLAG) != 0; }
+    bool getIsUpperBound() const { return (genBound & UPPER_BOUND_FLAG) != 0; }
+    uint8_t getGeneration() const { return genBound & GENERATION_MASK; }
+    bool isEmpty() const { return genBound == 0; }
+
+    // Conversion to and from the 64 bit word stored in the table
+    uint64_t toData() const
+    {
+        uint64_t data;
+        std::memcpy(&data, this, sizeof(data));
+        return data;
+    }
+    static TTEntry fromData(uint64_t data)
+    {
+        TTEntry entry;
+        // Copied through void * since the default member initializers make TTEntry non trivial
+        std::memcpy(static_cast<void *>(&entry), &data, sizeof(entry));
+        return entry;
+    }
+
     // Implementation of TTEntry::save
-    void save(uint64_t z_k, int16_t v, uint8_t d, Move m, bool type)
+    void save(uint16_t k, int16_t v, uint8_t d, Move m, bool type, bool upperBound, uint8_t generation)
     {
-        z_key = z_k;
+        key16 = k;
+        move = m.getData();
         value = v;
         depth = d;
-        move = m;
-        isExact = type;
+        genBound = generation | (type ? EXACT_FLAG : 0) | (upperBound ? UPPER_BOUND_FLAG : 0) | OCCUPIED_FLAG;
     }
 
+    static constexpr uint8_t OCCUPIED_FLAG = 1;
+    static constexpr uint8_t EXACT_FLAG = 2;
+    static constexpr uint8_t UPPER_BOUND_FLAG = 4;
+    static constexpr uint8_t GENERATION_DELTA = 8;   // Generation lives in the upper 5 bits
+    static constexpr uint8_t GENERATION_MASK = 0xF8;
+
 private:
     friend class TranspositionTable;
 
-    uint64_t z_key;
-    uint8_t depth;
-    Move move;
-    int16_t value;
-    bool isExact;
+    uint16_t key16{0};
+    uint16_t move{0};
+    int16_t value{0};
+    uint8_t depth{0};
+    uint8_t genBound{0};
 };
 
+static_assert(sizeof(TTEntry) == 8, "TTEntry must be packed into 8 bytes");
+
+// A cluster fills exactly one cache line, so a probe costs at most one cache miss
+struct alignas(64) TTCluster
+{
+    static constexpr int SIZE = 8;
+    std::atomic<uint64_t> entry[SIZE];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Transposition table entries must be lock free");
+
+static_assert(sizeof(TTCluster) == 64, "TTCluster must fill one cache line");
 
 class TranspositionTable
 {
 public:
-    TranspositionTable() : tableSize(0), table(nullptr) {}
-    ~TranspositionTable() { delete[] table; }
+    TranspositionTable() : clusterCount(0), table(nullptr), generation(0), allocatedBytes(0), hugeTLB(false) {}
+    ~TranspositionTable() { freeTable(); }
 
-    // Initializes or resizes the table to a number of entries, which is a power of two
-    void resize(size_t newSize)
+    // Initializes or resizes the table to a number of megabytes (not necessarily a power of two)
+    void resize(size_t megaBytes)
     {
-        delete[] table;
-        tableSize = newSize;
-        table = new TTEntry[newSize];
-        std::memset(table, 0, newSize * sizeof(TTEntry));
+        freeTable();
+        clusterCount = std::max<size_t>(megaBytes * 1024 * 1024 / sizeof(TTCluster), 1);
+        allocateTable(clusterCount * sizeof(TTCluster));
+        clear();
     }
 
-    // Probes the table for a given key. Returns a pointer to the TTEntry if found, otherwise nullptr.
-    TTEntry *probe(uint64_t z_key) const
+    // Empties the table without reallocating it (new game). Each thread zeroes its own slice of the table,
+    // this also spreads the page faults of a freshly allocated table over all threads.
+    void clear()
+    {
+        size_t numThreads = std::max(1u, std::thread::hardware_concurrency());
+        size_t sliceSize = (clusterCount + numThreads - 1) / numThreads;
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < numThreads; ++i)
+        {
+            size_t start = std::min(i * sliceSize, clusterCount);
+            size_t count = std::min(sliceSize, clusterCount - start);
+            threads.emplace_back([this, start, count]()
+                                 { std::memset(static_cast<void *>(table + start), 0, count * sizeof(TTCluster)); });
+        }
+        for (std::thread &thread : threads)
+            thread.join();
+        generation = 0;
+    }
+
+    // Called once per search, so that entries from previous searches are replaced first
+    void newSearch() { generation += TTEntry::GENERATION_DELTA; }
+
+    // Probes the table for a given key. If found, copies the entry into ttEntry and returns true.
+    bool probe(uint64_t z_key, TTEntry &ttEntry) const
     {
         if (table == nullptr)
-            return nullptr;
+            return false;
 
-        size_t index = z_key % tableSize;
-        return (table[index].z_key == z_key) ? &table[index] : nullptr;
+        TTCluster &cluster = table[clusterIndex(z_key)];
+        uint16_t key16 = static_cast<uint16_t>(z_key);
+        for (std::atomic<uint64_t> &slot : cluster.entry)
+        {
+            uint64_t data = slot.load(std::memory_order_relaxed);
+            TTEntry entry = TTEntry::fromData(data);
+            if (entry.key16 == key16 && not entry.isEmpty())
+            {
+                // Refresh the generation, so that entries still in use are not aged out. Entries already from this
+                // search are left untouched, so probes don't write to the shared cache line.
+                ttEntry = entry;
+                if (entry.getGeneration() != generation)
+                {
+                    entry.genBound = static_cast<uint8_t>(generation | (entry.genBound & ~TTEntry::GENERATION_MASK));
+                    slot.store(entry.toData(), std::memory_order_relaxed);
+                }
+                return true;
+            }
+        }
+        return false;
     }
 
-    // Save a new entry to the table
-    void save(uint64_t z_key, int16_t value, uint8_t depth, Move move, bool isExact)
+    // Starts loading the cluster of a key into cache, so that a later probe doesn't stall on memory
+    void prefetch(uint64_t z_key) const
     {
-        size_t index = z_key % tableSize;
+        __builtin_prefetch(&table[clusterIndex(z_key)]);
+    }
+
+    // Save a new entry to the table. An entry that is neither exact nor an upper bound is a lower bound.
+    void save(uint64_t z_key, int16_t value, uint8_t depth, Move move, bool isExact, bool isUpperBound = false)
+    {
+        TTCluster &cluster = table[clusterIndex(z_key)];
+        uint16_t key16 = static_cast<uint16_t>(z_key);
+        std::atomic<uint64_t> *replace = &cluster.entry[0];
+        TTEntry replaced = TTEntry::fromData(replace->load(std::memory_order_relaxed));
 
-        // If the position was already stored we only replace by a deeper depth
-        if (table[index].z_key != 0 && table[index].depth < depth) 
+        for (std::atomic<uint64_t> &slot : cluster.entry)
+        {
+            TTEntry entry = TTEntry::fromData(slot.load(std::memory_order_relaxed));
+            // If the position was already stored we only replace by a deeper depth, an exact value or
+            // when the stored value comes from a previous search
+            if (entry.key16 == key16 && not entry.isEmpty())
             {
-                table[index].z_key = z_key;
-                table[index].depth = depth;
-                table[index].value = value;
-                table[index].move = move;
-                table[index].isExact = isExact;
+                if (isExact || depth >= entry.depth || entry.getGeneration() != generation)
+                {
+                    entry.save(key16, value, depth, (move.getData() != 0) ? move : entry.getMove(), isExact, isUpperBound,
+                               generation);
+                    slot.store(entry.toData(), std::memory_order_relaxed);
+                }
+                return;
+            }
+            // If there is a free slot, we store it regardless the depth
+            if (entry.isEmpty())
+            {
+                replace = &slot;
+                break;
+            }
+            // Otherwise we replace the entry that is worth the least: shallow entries and entries from old searches
+            if (replacementWorth(entry) < replacementWorth(replaced))
+            {
+                replace = &slot;
+                replaced = entry;
             }
-        // If the position was not stored, we store it regardless the depth
-        else if (table[index].z_key == 0)
-        {
-            table[index].z_key = z_key;
-            table[index].depth = depth;
-            table[index].value = value;
-            table[index].move = move;
-            table[index].isExact = isExact;
         }
+        TTEntry newEntry;
+        newEntry.save(key16, value, depth, move, isExact, isUpperBound, generation);
+        replace->store(newEntry.toData(), std::memory_order_relaxed);
     }
 
     void printTableMemory() const
     {
         size_t entriesInUse = 0;
-        for (size_t i = 0; i < tableSize; ++i)
-        {
-            if (table[i].z_key != 0)
-            { // Assuming an unused entry has a key of 0
-                ++entriesInUse;
-            }
-        }
+        for (size_t i = 0; i < clusterCount; ++i)
+            for (const std::atomic<uint64_t> &slot : table[i].entry)
+                if (not TTEntry::fromData(slot.load(std::memory_order_relaxed)).isEmpty())
+                    ++entriesInUse;
 
-        std::cout << "Table memory: " << tableSize * sizeof(TTEntry) << " bytes\n";
-        std::cout << "Entries in use: " << entriesInUse << " out of " << tableSize << "\n";
+        std::cout << "Table memory: " << clusterCount * sizeof(TTCluster) << " bytes\n";
+        std::cout << "Entries in use: " << entriesInUse << " out of " << clusterCount * TTCluster::SIZE << "\n";
         std::cout << "Active memory usage: " << entriesInUse * sizeof(TTEntry) << " bytes\n";
     }
 
 private:
-    size_t tableSize; // The total number of entries in the table
-    TTEntry *table;   // Dynamic array of TTEntry
+    // Multiply-shift maps the key uniformly onto [0, clusterCount) for any table size, using the upper key bits
+    size_t clusterIndex(uint64_t z_key) const
+    {
+        return static_cast<size_t>((static_cast<unsigned __int128>(z_key) * clusterCount) >> 64);
+    }
+
+    // Large tables are backed by 2MB pages where the OS allows it, to cut TLB misses on probes.
+    // Explicit huge pages (MAP_HUGETLB) need pages reserved by the administrator, so we fall back
+    // to transparent huge pages (madvise) and otherwise to normal pages.
+    void allocateTable(size_t bytes)
+    {
+        constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+#if defined(__linux__) && defined(MAP_HUGETLB)
+        size_t hugeBytes = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+        void *mem = mmap(nullptr, hugeBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (mem != MAP_FAILED)
+        {
+            table = static_cast<TTCluster *>(mem);
+            allocatedBytes = hugeBytes;
+            hugeTLB = true;
+            return;
+        }
+#endif
+        size_t alignment = (bytes >= HUGE_PAGE_SIZE) ? HUGE_PAGE_SIZE : alignof(TTCluster);
+        // aligned_alloc needs the size to be a multiple of the alignment
+        size_t paddedBytes = (bytes + alignment - 1) / alignment * alignment;
+        table = static_cast<TTCluster *>(std::aligned_alloc(alignment, paddedBytes));
+        if (table == nullptr)
+        {
+            std::cerr << "Failed to allocate " << bytes / (1024 * 1024) << "MB for the transposition table\n";
+            std::exit(EXIT_FAILURE);
+        }
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+        madvise(table, paddedBytes, MADV_HUGEPAGE);
+#endif
+        allocatedBytes = paddedBytes;
+        hugeTLB = false;
+    }
+
+    void freeTable()
+    {
+        if (table == nullptr)
+            return;
+#if defined(__linux__)
+        if (hugeTLB)
+            munmap(table, allocatedBytes);
+        else
+#endif
+            std::free(table);
+        table = nullptr;
+    }
+
+    // Each search of age costs as much as 8 plies of depth
+    int replacementWorth(const TTEntry &entry) const
+    {
+        int age = static_cast<uint8_t>(generation - entry.getGeneration()) / TTEntry::GENERATION_DELTA;
+        return entry.depth - 8 * age;
+    }
+
+    size_t clusterCount; // The total number of clusters in the table
+    TTCluster *table;    // Dynamic array of TTCluster
+    uint8_t generation;  // Age of the current search, in steps of GENERATION_DELTA
+    size_t allocatedBytes;
+    bool hugeTLB;        // Whether the table was mapped with explicit huge pages (freed with munmap)
 };
 
-#endif
\ No newline at end of file
+#endif